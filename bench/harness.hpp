@@ -0,0 +1,111 @@
+#ifndef MIZU_BENCH_HARNESS_HPP
+#define MIZU_BENCH_HARNESS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fmt/format.h>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace bench {
+// Incremented by the global operator new of the benchmark executable
+extern std::atomic<std::size_t> allocations;
+
+template<typename T>
+void do_not_optimize(T &&value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile auto sink = &value;
+    sink = &value;
+#endif
+}
+
+struct Result {
+    std::string name;
+    std::size_t n;
+    std::size_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+};
+
+struct Config {
+    std::chrono::nanoseconds min_sample_time{std::chrono::milliseconds(20)};
+    std::size_t samples{5};
+};
+
+class Harness {
+public:
+    explicit Harness(Config config)
+        : config_(config) {}
+
+    // make(n) sets up a fixture for input size n and returns the operation to time.
+    // Each size is one point on the scaling curve for name.
+    template<typename Make>
+    void run(const std::string &name, std::span<const std::size_t> sizes, Make &&make);
+
+    template<typename Make>
+    void run(const std::string &name, Make &&make) {
+        constexpr std::size_t single[] = {1};
+        run(name, single, [&](std::size_t) { return make(); });
+    }
+
+    const std::vector<Result> &results() const { return results_; }
+
+private:
+    Config config_;
+    std::vector<Result> results_{};
+};
+
+template<typename Make>
+void Harness::run(const std::string &name, std::span<const std::size_t> sizes, Make &&make) {
+    using clock = std::chrono::steady_clock;
+
+    for (const auto n: sizes) {
+        auto op = make(n);
+
+        // Double the iteration count until one sample takes long enough to time reliably
+        std::size_t iterations = 1;
+        for (;;) {
+            const auto start = clock::now();
+            for (std::size_t i = 0; i < iterations; ++i)
+                op();
+            if (clock::now() - start >= config_.min_sample_time || iterations >= (std::size_t(1) << 30))
+                break;
+            iterations *= 2;
+        }
+
+        std::vector<double> ns_per_op{};
+        std::size_t allocs = 0;
+        for (std::size_t s = 0; s < config_.samples; ++s) {
+            const auto allocs_before = allocations.load(std::memory_order_relaxed);
+            const auto start = clock::now();
+            for (std::size_t i = 0; i < iterations; ++i)
+                op();
+            const auto elapsed = clock::now() - start;
+            allocs += allocations.load(std::memory_order_relaxed) - allocs_before;
+
+            ns_per_op.push_back(
+                    static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+                    static_cast<double>(iterations));
+        }
+
+        std::ranges::sort(ns_per_op);
+        results_.push_back(Result{
+                .name = name,
+                .n = n,
+                .iterations = iterations,
+                .ns_per_op = ns_per_op[ns_per_op.size() / 2],
+                .allocs_per_op =
+                        static_cast<double>(allocs) / static_cast<double>(iterations * config_.samples),
+        });
+
+        const auto &r = results_.back();
+        fmt::print("{:<40} n={:<8} {:>14.2f} ns/op {:>10.2f} allocs/op\n", r.name, r.n, r.ns_per_op, r.allocs_per_op);
+    }
+}
+} // namespace bench
+
+#endif // MIZU_BENCH_HARNESS_HPP
@@ -0,0 +1,283 @@
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include "harness.hpp"
+#include "mizu/core/callback_mgr.hpp"
+#include "mizu/core/input_mgr.hpp"
+#include "mizu/core/payloads.hpp"
+#include "mizu/ds/priority_queue.hpp"
+#include "mizu/gui/gui.hpp"
+#include "mizu/gui/layout.hpp"
+#include "mizu/util/averagers.hpp"
+#include "mizu/util/class_helpers.hpp"
+#include "mizu/util/io.hpp"
+#include "mizu/util/rng.hpp"
+#include "mizu/util/time.hpp"
+
+// CPU-only microbenchmarks, nothing here needs a window or a GL context.
+// Prints a table and writes the results as JSON for regression tracking.
+//
+// usage: mizu_bench_micro [--quick] [--assets DIR] [--out FILE]
+
+std::atomic<std::size_t> bench::allocations{0};
+
+void *operator new(std::size_t size) {
+    bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace mgui = mizu::gui;
+
+constexpr std::size_t SIZES[] = {1, 16, 256, 4096};
+// Buffered events past CallbackMgr::MAX_BUFFER_SIZE are dropped
+constexpr std::size_t EVENT_SIZES[] = {1, 16, 256, 1024};
+constexpr std::size_t FANOUTS[] = {2, 4, 8, 16};
+
+// Subscribes n callbacks and unsubscribes them again when destroyed, the
+// callback tables are static so leftovers would leak into later benchmarks
+struct CallbackFixture {
+    mizu::CallbackMgr callbacks{};
+    std::vector<std::size_t> ids{};
+    std::size_t hits{0};
+
+    explicit CallbackFixture(std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto id = callbacks.reg();
+            callbacks.sub<mizu::PUpdate>(id, [&](const auto &p) { hits += p.dt > 0.0; });
+            callbacks.sub<mizu::PEventKeyDown>(id, [&](const auto &p) { hits += p.repeat; });
+            ids.push_back(id);
+        }
+    }
+
+    ~CallbackFixture() {
+        for (const auto id: ids) {
+            callbacks.unsub<mizu::PEventKeyDown>(id);
+            callbacks.unsub<mizu::PUpdate>(id);
+            callbacks.unreg(id);
+        }
+    }
+
+    NO_COPY(CallbackFixture)
+    NO_MOVE(CallbackFixture)
+};
+
+void bench_callback_mgr(bench::Harness &h) {
+    h.run("callback_mgr/pub_nowait", SIZES, [](std::size_t n) {
+        return [f = std::make_shared<CallbackFixture>(n)] { f->callbacks.pub_nowait<mizu::PUpdate>(1.0 / 60.0); };
+    });
+
+    h.run("callback_mgr/pub_then_poll", EVENT_SIZES, [](std::size_t n) {
+        return [f = std::make_shared<CallbackFixture>(n)] {
+            f->callbacks.pub<mizu::PEventKeyDown>(0ul, SDL_SCANCODE_A, SDLK_A, SDL_KMOD_NONE, true);
+            for (const auto id: f->ids)
+                f->callbacks.poll<mizu::PEventKeyDown>(id);
+        };
+    });
+}
+
+void bench_input_mgr(bench::Harness &h) {
+    // One frame with n key events, then a query for each key
+    h.run("input_mgr/key_frame", EVENT_SIZES, [](std::size_t n) {
+        struct Fixture {
+            mizu::CallbackMgr callbacks{};
+            mizu::InputMgr input{callbacks, nullptr};
+        };
+        return [f = std::make_shared<Fixture>(), n] {
+            for (std::size_t i = 0; i < n; ++i) {
+                const auto key = static_cast<SDL_Keycode>(SDLK_A + i % 26);
+                f->callbacks.pub<mizu::PEventKeyDown>(0ul, SDL_SCANCODE_UNKNOWN, key, SDL_KMOD_NONE, false);
+            }
+            f->callbacks.pub_nowait<mizu::PPreUpdate>(1.0 / 60.0);
+
+            bool any = false;
+            for (std::size_t i = 0; i < n; ++i)
+                any |= f->input.pressed(static_cast<mizu::Key>(SDLK_A + i % 26));
+            bench::do_not_optimize(any);
+        };
+    });
+}
+
+// Alternating vertical and horizontal stacks, fanout children per stack
+std::unique_ptr<mgui::Gui> build_stack_tree(std::size_t depth, std::size_t fanout) {
+    auto builder = mgui::GuiBuilder();
+    const auto add_level = [&](auto &self, std::size_t level) -> void {
+        if (level % 2 == 0)
+            builder.start<mgui::VStack>({.outer_pad = mgui::Padding(1.0f), .inner_pad = 1.0f});
+        else
+            builder.start<mgui::HStack>({.outer_pad = mgui::Padding(1.0f), .inner_pad = 1.0f});
+
+        if (level + 1 < depth) {
+            for (std::size_t i = 0; i < fanout; ++i)
+                self(self, level + 1);
+        }
+        builder.end();
+    };
+    add_level(add_level, 0);
+    return builder.build();
+}
+
+void bench_gui(bench::Harness &h) {
+    h.run("gui/stack_resize_depth4", FANOUTS, [](std::size_t fanout) {
+        return [gui = std::shared_ptr(build_stack_tree(4, fanout))] {
+            gui->resize({1920.0f, 1080.0f}, {0.0f, 0.0f});
+            bench::do_not_optimize(gui->size());
+        };
+    });
+}
+
+void bench_priority_queue(bench::Harness &h) {
+    h.run("priority_queue/push_pop_all", SIZES, [](std::size_t n) {
+        std::vector<std::size_t> priorities(n);
+        for (auto &p: priorities)
+            p = mizu::rng::get<std::size_t>(0, 1'000'000);
+
+        return [priorities = std::move(priorities)] {
+            mizu::ds::PriorityQueue<int> pq{};
+            for (std::size_t i = 0; i < priorities.size(); ++i)
+                pq.push(i, priorities[i], static_cast<int>(i));
+            while (!pq.empty())
+                pq.pop();
+            bench::do_not_optimize(pq);
+        };
+    });
+
+    h.run("priority_queue/update", SIZES, [](std::size_t n) {
+        auto pq = std::make_shared<mizu::ds::PriorityQueue<int>>();
+        for (std::size_t i = 0; i < n; ++i)
+            pq->push(i, mizu::rng::get<std::size_t>(0, 1'000'000), static_cast<int>(i));
+
+        return [pq, n, i = std::size_t(0)] mutable {
+            pq->update(i++ % n, mizu::rng::get<std::size_t>(0, 1'000'000));
+        };
+    });
+}
+
+void bench_rng(bench::Harness &h) {
+    h.run("rng/get_int", [] { return [] { bench::do_not_optimize(mizu::rng::get<int>(0, 100)); }; });
+    h.run("rng/get_float", [] { return [] { bench::do_not_optimize(mizu::rng::get<float>(0.0f, 1.0f)); }; });
+}
+
+void bench_time(bench::Harness &h) {
+    // n distinct values cycling through the window
+    h.run("max_period/update_value", SIZES, [](std::size_t n) {
+        return [mp = std::make_shared<mizu::MaxPeriod<std::size_t>>(std::chrono::seconds(1)), n, i = std::size_t(0)] mutable {
+            mp->update(i++ % n);
+            bench::do_not_optimize(mp->value());
+        };
+    });
+}
+
+void bench_averagers(bench::Harness &h) {
+    h.run("sma/update", SIZES, [](std::size_t n) {
+        return [sma = std::make_shared<mizu::SMA>(n), v = 0.0] mutable {
+            sma->update(v += 1.0);
+            bench::do_not_optimize(sma->value());
+        };
+    });
+
+    h.run("ema/update", [] {
+        return [ema = std::make_shared<mizu::EMA>(0.1), v = 0.0] mutable {
+            ema->update(v += 1.0);
+            bench::do_not_optimize(ema->value());
+        };
+    });
+}
+
+void bench_io(bench::Harness &h, const std::filesystem::path &assets) {
+    for (const auto &name: {"arbok.png", "milotic-f.png", "serperior.png", "seviper.png"}) {
+        const auto path = assets / "img" / name;
+        if (!std::filesystem::exists(path)) {
+            fmt::print("skipping read_image_data/{}, '{}' not found\n", name, path.string());
+            continue;
+        }
+
+        h.run(fmt::format("read_image_data/{}", name), [&] {
+            return [path] {
+                auto data = mizu::read_image_data(path);
+                bench::do_not_optimize(data);
+            };
+        });
+    }
+}
+
+std::string to_json(const std::vector<bench::Result> &results) {
+    std::string json = "{\"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto &r = results[i];
+        json += fmt::format(
+                R"(  {{"name": "{}", "n": {}, "iterations": {}, "ns_per_op": {:.3f}, "allocs_per_op": {:.3f}}}{})",
+                r.name,
+                r.n,
+                r.iterations,
+                r.ns_per_op,
+                r.allocs_per_op,
+                i + 1 < results.size() ? ",\n" : "\n");
+    }
+    return json + "]}\n";
+}
+
+int main(int argc, char *argv[]) {
+    bench::Config config{};
+    std::filesystem::path assets{"example"};
+    std::filesystem::path out{"mizu_bench_micro.json"};
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--quick") {
+            // Shorter samples for CI smoke runs
+            config.min_sample_time = std::chrono::milliseconds(2);
+            config.samples = 3;
+        } else if (arg == "--assets" && i + 1 < argc)
+            assets = argv[++i];
+        else if (arg == "--out" && i + 1 < argc)
+            out = argv[++i];
+        else {
+            fmt::print(stderr, "Unknown argument '{}'\n", arg);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Fixed seed so fixtures are the same between runs
+    mizu::rng::seed(0x6d697a75);
+
+    auto harness = bench::Harness(config);
+    bench_callback_mgr(harness);
+    bench_input_mgr(harness);
+    bench_gui(harness);
+    bench_priority_queue(harness);
+    bench_rng(harness);
+    bench_time(harness);
+    bench_averagers(harness);
+    bench_io(harness, assets);
+
+    std::ofstream file(out);
+    if (!file.is_open()) {
+        fmt::print(stderr, "Failed to open '{}' for writing\n", out.string());
+        return EXIT_FAILURE;
+    }
+    file << to_json(harness.results());
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <fmt/ranges.h>
+#include <fstream>
+#include <functional>
+#include <type_traits>
+#include "mizu/mizu.hpp"
+#include "stats.hpp"
+
+namespace mgui = mizu::gui;
+
+// Runs each scenario in a headless engine for a fixed number of frames and
+// writes CPU frame time percentiles, draw calls and upload volume as JSON.
+//
+// usage: mizu_bench_render [--frames N] [--warmup N] [--width W] [--height H]
+//                          [--assets DIR] [--only NAME] [--out FILE]
+//
+// Logging goes to stdout, so the results are written to a file instead.
+
+struct Options {
+    std::size_t frames{300};
+    std::size_t warmup{30};
+    glm::ivec2 resolution{1280, 720};
+    std::filesystem::path assets{"example"};
+    std::optional<std::string> only{std::nullopt};
+    std::filesystem::path out{"mizu_bench_render.json"};
+};
+
+struct Scenario {
+    std::string name;
+    // Called once the engine exists, returns the per-frame draw function
+    std::function<std::function<void(std::size_t)>(mizu::Engine &, const Options &)> setup;
+};
+
+struct Samples {
+    std::vector<double> frame_ms{};
+    std::vector<gloo::DrawStats> stats{};
+};
+
+class BenchApp final : public mizu::Application {
+public:
+    BenchApp(mizu::Engine *engine, const Scenario &scenario, const Options &opts, Samples &samples);
+
+    void update(double dt) override;
+
+    void draw() override;
+
+private:
+    const Options &opts_;
+    Samples &samples_;
+    std::function<void(std::size_t)> draw_fn_;
+
+    std::size_t frame_{0};
+    std::chrono::steady_clock::time_point last_draw_{};
+};
+
+BenchApp::BenchApp(mizu::Engine *engine, const Scenario &scenario, const Options &opts, Samples &samples)
+    : Application(engine), opts_(opts), samples_(samples), draw_fn_(scenario.setup(*engine, opts)) {}
+
+void BenchApp::update(double) {}
+
+// Frame time is measured draw to draw, so it covers the batcher flush, present and event polling
+void BenchApp::draw() {
+    const auto now = std::chrono::steady_clock::now();
+    if (frame_ > opts_.warmup) {
+        samples_.frame_ms.push_back(std::chrono::duration<double, std::milli>(now - last_draw_).count());
+        samples_.stats.push_back(engine->gl.draw_stats());
+    }
+    engine->gl.reset_draw_stats();
+    last_draw_ = now;
+
+    engine->g2d->clear(mizu::rgb(0x000000));
+    draw_fn_(frame_++);
+}
+
+std::vector<glm::vec2> random_points(std::size_t count, glm::vec2 max) {
+    std::vector<glm::vec2> points(count);
+    for (auto &p: points)
+        p = {mizu::rng::get<float>(0.0f, max.x), mizu::rng::get<float>(0.0f, max.y)};
+    return points;
+}
+
+Scenario opaque_rects() {
+    return {"opaque_rects_100k", [](mizu::Engine &engine, const Options &opts) {
+                auto points = std::make_shared<std::vector<glm::vec2>>(random_points(100'000, opts.resolution));
+                return [&g2d = *engine.g2d, points](std::size_t) {
+                    for (std::size_t i = 0; i < points->size(); ++i)
+                        g2d.fill_rect((*points)[i], {8.0f, 8.0f}, mizu::rgb(0x4080c0));
+                };
+            }};
+}
+
+Scenario alpha_sprites() {
+    return {"alpha_sprites_50k_2tex", [](mizu::Engine &engine, const Options &opts) {
+                std::shared_ptr<mizu::Texture> textures[2] = {
+                        engine.g2d->load_texture(opts.assets / "img" / "arbok.png"),
+                        engine.g2d->load_texture(opts.assets / "img" / "seviper.png")};
+                auto points = std::make_shared<std::vector<glm::vec2>>(random_points(50'000, opts.resolution));
+                return [&g2d = *engine.g2d, textures, points](std::size_t) {
+                    // Alternating textures is the worst case for the transparent batch list
+                    for (std::size_t i = 0; i < points->size(); ++i) {
+                        const auto &tex = *textures[i % 2];
+                        g2d.texture(tex, (*points)[i], glm::vec2(32.0f), glm::vec3(0.0f), mizu::rgba(0xffffff80));
+                    }
+                };
+            }};
+}
+
+Scenario lines() {
+    return {"lines_20k", [](mizu::Engine &engine, const Options &opts) {
+                auto points = std::make_shared<std::vector<glm::vec2>>(random_points(40'000, opts.resolution));
+                return [&g2d = *engine.g2d, points](std::size_t) {
+                    for (std::size_t i = 0; i + 1 < points->size(); i += 2)
+                        g2d.line((*points)[i], (*points)[i + 1], mizu::rgb(0x80c0ff));
+                };
+            }};
+}
+
+Scenario text() {
+    return {"text_heavy", [](mizu::Engine &engine, const Options &opts) {
+                auto font = std::make_shared<mizu::Font>(*engine.g2d, opts.assets / "font" / "ter-u16n.bdf");
+                return [font, height = opts.resolution.y](std::size_t frame) {
+                    const auto line_height = font->line_height();
+                    std::size_t line = 0;
+                    for (float y = 0.0f; y + line_height <= height; y += line_height, ++line) {
+                        font->draw(
+                                fmt::format(
+                                        "frame {:>6} line {:>3}: the quick brown fox jumps over the lazy dog 0123456789",
+                                        frame,
+                                        line),
+                                {0.0f, y});
+                    }
+                };
+            }};
+}
+
+Scenario gui_tree() {
+    return {"gui_tree_400", [](mizu::Engine &engine, const Options &opts) {
+                auto font = std::make_shared<mizu::Font>(*engine.g2d, opts.assets / "font" / "ter-u12n.bdf");
+
+                auto builder = mgui::GuiBuilder();
+                builder.start<mgui::VStack>({.border = mgui::PxBorder{mizu::rgb(0xffffff)}, .inner_pad = 2.0f});
+                for (int row = 0; row < 40; ++row) {
+                    builder.start<mgui::HStack>({.inner_pad = 2.0f});
+                    for (int col = 0; col < 10; ++col)
+                        builder.add<mgui::Button>({.font = font.get(), .text = fmt::format("Button {}.{}", row, col)});
+                    builder.end();
+                }
+                std::shared_ptr gui = builder.build();
+
+                return [&engine, font, gui, size = glm::vec2(opts.resolution)](std::size_t) {
+                    gui->resize(size, {0, 0});
+                    gui->update(*engine.input);
+                    gui->draw(*engine.g2d);
+                };
+            }};
+}
+
+std::string to_json(const Scenario &scenario, const Samples &samples) {
+    return fmt::format(
+            R"({{"name": "{}", "frames": {}, "frame_ms": {}, {}}})",
+            scenario.name,
+            samples.frame_ms.size(),
+            bench::summary_json(samples.frame_ms),
+            bench::draw_stats_json(samples.stats));
+}
+
+std::optional<Options> parse_args(int argc, char *argv[]) {
+    Options opts{};
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            MIZU_LOG_ERROR("Missing value for '{}'", arg);
+            return std::nullopt;
+        }
+
+        const std::string value = argv[++i];
+        const auto parse = [&](auto &out) {
+            const auto n = bench::parse_number<std::remove_reference_t<decltype(out)>>(value);
+            if (!n) {
+                MIZU_LOG_ERROR("Invalid value '{}' for '{}'", value, arg);
+                return false;
+            }
+            out = *n;
+            return true;
+        };
+
+        bool valid = true;
+        if (arg == "--frames")
+            valid = parse(opts.frames);
+        else if (arg == "--warmup")
+            valid = parse(opts.warmup);
+        else if (arg == "--width")
+            valid = parse(opts.resolution.x);
+        else if (arg == "--height")
+            valid = parse(opts.resolution.y);
+        else if (arg == "--assets")
+            opts.assets = value;
+        else if (arg == "--only")
+            opts.only = value;
+        else if (arg == "--out")
+            opts.out = value;
+        else {
+            MIZU_LOG_ERROR("Unknown argument '{}'", arg);
+            return std::nullopt;
+        }
+
+        if (!valid)
+            return std::nullopt;
+    }
+    return opts;
+}
+
+int main(int argc, char *argv[]) {
+    const auto opts = parse_args(argc, argv);
+    if (!opts)
+        return EXIT_FAILURE;
+
+    auto engine_result = mizu::Engine::headless(
+            "mizu_bench_render",
+            {.resolution = opts->resolution,
+             .fixed_dt = 1.0 / 60.0,
+             .max_frames = opts->warmup + opts->frames + 1});
+    if (!engine_result) {
+        MIZU_LOG_ERROR("Failed to create headless engine: {}", engine_result.error());
+        return EXIT_FAILURE;
+    }
+    auto &engine = **engine_result;
+
+    const std::vector scenarios{opaque_rects(), alpha_sprites(), lines(), text(), gui_tree()};
+
+    std::vector<std::string> results{};
+    for (const auto &scenario: scenarios) {
+        if (opts->only && *opts->only != scenario.name)
+            continue;
+
+        // Same seed per scenario so runs are comparable against a baseline
+        mizu::rng::seed(0x6d697a75);
+
+        MIZU_LOG_INFO("Running {}", scenario.name);
+        Samples samples{};
+        engine.mainloop<BenchApp>(scenario, *opts, samples);
+        results.push_back(to_json(scenario, samples));
+    }
+
+    const auto renderer = reinterpret_cast<const char *>(engine.gl.ctx.GetString(GL_RENDERER));
+    const auto json = fmt::format(
+            "{{\"renderer\": \"{}\", \"resolution\": [{}, {}], \"warmup\": {}, \"scenarios\": [\n  {}\n]}}\n",
+            bench::json_escape(renderer ? renderer : ""),
+            opts->resolution.x,
+            opts->resolution.y,
+            opts->warmup,
+            fmt::join(results, ",\n  "));
+
+    std::ofstream out(opts->out);
+    if (!out.is_open()) {
+        MIZU_LOG_ERROR("Failed to open '{}' for writing", opts->out);
+        return EXIT_FAILURE;
+    }
+    out << json;
+    MIZU_LOG_INFO("Wrote results to '{}'", opts->out);
+
+    return EXIT_SUCCESS;
+}
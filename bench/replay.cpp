@@ -0,0 +1,158 @@
+#include <fstream>
+#include <unordered_map>
+#include "mizu/core/draw_recorder.hpp"
+#include "mizu/mizu.hpp"
+#include "stats.hpp"
+
+// Feeds a recording made with G2d::record_draws() back through a Batcher in a
+// headless engine, timing the add and draw phases separately.
+//
+// usage: mizu_replay RECORDING [--iterations N] [--finish] [--out FILE]
+//
+// --finish waits for the GPU after each draw so the draw phase includes GPU time.
+// Recorded textures are replaced by uninitialized textures of the same size.
+
+struct Options {
+    std::filesystem::path recording;
+    std::size_t iterations{10};
+    bool finish{false};
+    std::filesystem::path out{"mizu_replay.json"};
+};
+
+struct Samples {
+    std::vector<double> add_ms{};
+    std::vector<double> draw_ms{};
+    std::vector<gloo::DrawStats> stats{};
+};
+
+class Replay final : public mizu::Application {
+public:
+    Replay(mizu::Engine *engine, const mizu::DrawRecording &recording, const Options &opts, Samples &samples);
+
+    void update(double dt) override;
+
+    void draw() override;
+
+private:
+    const mizu::DrawRecording &recording_;
+    const Options &opts_;
+    Samples &samples_;
+
+    mizu::Batcher batcher_;
+    std::vector<std::unique_ptr<gloo::Texture>> textures_{};
+    std::unordered_map<GLuint, GLuint> texture_ids_{};
+
+    std::size_t frame_{0};
+};
+
+Replay::Replay(mizu::Engine *engine, const mizu::DrawRecording &recording, const Options &opts, Samples &samples)
+    : Application(engine), recording_(recording), opts_(opts), samples_(samples), batcher_(engine->gl) {
+    for (const auto &[id, size]: recording_.textures) {
+        textures_.push_back(std::make_unique<gloo::Texture>(engine->gl, size, gloo::TextureDesc{}));
+        texture_ids_[id] = textures_.back()->id;
+    }
+}
+
+void Replay::update(double) {}
+
+void Replay::draw() {
+    using clock = std::chrono::steady_clock;
+    const auto &frame = recording_.frames[frame_++ % recording_.frames.size()];
+
+    engine->gl.reset_draw_stats();
+
+    const auto add_start = clock::now();
+    for (const auto &add: frame.adds) {
+        const auto texture_id = add.texture_id == 0 ? 0 : texture_ids_[add.texture_id];
+        batcher_.add(add.type, add.trans, texture_id, std::span(frame.vertices).subspan(add.offset, add.count));
+    }
+
+    const auto draw_start = clock::now();
+    batcher_.draw(frame.uniforms);
+    if (opts_.finish)
+        engine->gl.ctx.Finish();
+    const auto draw_end = clock::now();
+
+    batcher_.clear();
+
+    samples_.add_ms.push_back(std::chrono::duration<double, std::milli>(draw_start - add_start).count());
+    samples_.draw_ms.push_back(std::chrono::duration<double, std::milli>(draw_end - draw_start).count());
+    samples_.stats.push_back(engine->gl.draw_stats());
+}
+
+std::optional<Options> parse_args(int argc, char *argv[]) {
+    Options opts{};
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--finish")
+            opts.finish = true;
+        else if (arg == "--iterations" && i + 1 < argc) {
+            const std::string_view value = argv[++i];
+            const auto n = bench::parse_number<std::size_t>(value);
+            if (!n) {
+                MIZU_LOG_ERROR("Invalid value '{}' for '{}'", value, arg);
+                return std::nullopt;
+            }
+            opts.iterations = *n;
+        } else if (arg == "--out" && i + 1 < argc)
+            opts.out = argv[++i];
+        else if (!arg.starts_with("--") && opts.recording.empty())
+            opts.recording = arg;
+        else {
+            MIZU_LOG_ERROR("Unknown argument '{}'", arg);
+            return std::nullopt;
+        }
+    }
+
+    if (opts.recording.empty()) {
+        MIZU_LOG_ERROR("usage: mizu_replay RECORDING [--iterations N] [--finish] [--out FILE]");
+        return std::nullopt;
+    }
+    return opts;
+}
+
+int main(int argc, char *argv[]) {
+    const auto opts = parse_args(argc, argv);
+    if (!opts)
+        return EXIT_FAILURE;
+
+    const auto recording = mizu::DrawRecording::load(opts->recording);
+    if (!recording || recording->frames.empty()) {
+        MIZU_LOG_ERROR("No frames to replay in '{}'", opts->recording);
+        return EXIT_FAILURE;
+    }
+
+    // The recorded projection already maps to the recorded viewport size
+    const auto viewport = recording->frames.front().uniforms.viewport;
+    auto engine_result = mizu::Engine::headless(
+            "mizu_replay",
+            {.resolution = {std::max(1, static_cast<int>(viewport.z)), std::max(1, static_cast<int>(viewport.w))},
+             .fixed_dt = 1.0 / 60.0,
+             .max_frames = opts->iterations * recording->frames.size()});
+    if (!engine_result) {
+        MIZU_LOG_ERROR("Failed to create headless engine: {}", engine_result.error());
+        return EXIT_FAILURE;
+    }
+
+    Samples samples{};
+    (*engine_result)->mainloop<Replay>(*recording, *opts, samples);
+
+    std::ofstream out(opts->out);
+    if (!out.is_open()) {
+        MIZU_LOG_ERROR("Failed to open '{}' for writing", opts->out);
+        return EXIT_FAILURE;
+    }
+    out << fmt::format(
+            R"({{"recording": "{}", "frames": {}, "iterations": {}, "finish": {}, "add_ms": {}, "draw_ms": {}, {}}})"
+            "\n",
+            bench::json_escape(opts->recording.generic_string()),
+            recording->frames.size(),
+            opts->iterations,
+            opts->finish,
+            bench::summary_json(samples.add_ms),
+            bench::summary_json(samples.draw_ms),
+            bench::draw_stats_json(samples.stats));
+    MIZU_LOG_INFO("Wrote results to '{}'", opts->out);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+#ifndef MIZU_BENCH_STATS_HPP
+#define MIZU_BENCH_STATS_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <fmt/format.h>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "gloo/context.hpp"
+
+namespace bench {
+// Empty unless the whole of text is a number that fits in T
+template<typename T>
+std::optional<T> parse_number(std::string_view text) {
+    T value{};
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size())
+        return std::nullopt;
+    return value;
+}
+
+// For strings from outside the benchmark, like the GL renderer name
+inline std::string json_escape(std::string_view text) {
+    std::string out{};
+    out.reserve(text.size());
+    for (const auto c: text) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+inline double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty())
+        return 0.0;
+    const auto idx = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+// {"mean": .., "p50": .., "p90": .., "p99": .., "max": ..}
+inline std::string summary_json(std::vector<double> samples) {
+    std::ranges::sort(samples);
+    const auto mean = std::accumulate(samples.begin(), samples.end(), 0.0) /
+                      static_cast<double>(std::max<std::size_t>(samples.size(), 1));
+    return fmt::format(
+            R"({{"mean": {:.4f}, "p50": {:.4f}, "p90": {:.4f}, "p99": {:.4f}, "max": {:.4f}}})",
+            mean,
+            percentile(samples, 0.50),
+            percentile(samples, 0.90),
+            percentile(samples, 0.99),
+            samples.empty() ? 0.0 : samples.back());
+}
+
+// "draw_calls": .., "vertices": .., "bytes_uploaded": .. averaged per frame
+inline std::string draw_stats_json(const std::vector<gloo::DrawStats> &stats) {
+    const auto mean = [&](auto member) {
+        double sum = 0.0;
+        for (const auto &s: stats)
+            sum += static_cast<double>(s.*member);
+        return sum / static_cast<double>(std::max<std::size_t>(stats.size(), 1));
+    };
+    return fmt::format(
+            R"("draw_calls": {:.1f}, "vertices": {:.1f}, "bytes_uploaded": {:.1f}, "dispatches": {:.1f})",
+            mean(&gloo::DrawStats::draw_calls),
+            mean(&gloo::DrawStats::vertices),
+            mean(&gloo::DrawStats::bytes_uploaded),
+            mean(&gloo::DrawStats::dispatches));
+}
+} // namespace bench
+
+#endif // MIZU_BENCH_STATS_HPP
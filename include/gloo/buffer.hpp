@@ -1,7 +1,14 @@
 #ifndef GLOO_BUFFER_HPP
 #define GLOO_BUFFER_HPP
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <glad/gl.h>
+#include <span>
+#include <type_traits>
+#include <vector>
+#include "gloo/context.hpp"
 #include "mizu/core/log.hpp"
 #include "mizu/util/class_helpers.hpp"
 #include "mizu/util/enum_class_helpers.hpp"
@@ -28,7 +35,7 @@ class Buffer {
 public:
     GLuint id{0};
 
-    Buffer(GladGLContext &gl);
+    Buffer(Context &gl);
     ~Buffer();
 
     NO_COPY(Buffer)
@@ -40,15 +47,203 @@ public:
     void unbind(BufferTarget target);
 
 protected:
-    GladGLContext &gl_;
+    Context &gl_;
 };
 
+// Fixed size buffer holding a single std140 laid out T
+template<typename T>
+class UniformBuffer : public Buffer {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    explicit UniformBuffer(Context &gl);
+
+    NO_COPY(UniformBuffer)
+
+    MOVE_CONSTRUCTOR(UniformBuffer);
+    MOVE_ASSIGN_OP(UniformBuffer);
+
+    const T &value() const;
+
+    // Only uploads if the contents changed
+    void update(const T &value);
+
+    void bind_base(GLuint binding);
+
+private:
+    T value_{};
+};
+
+template<typename T>
+UniformBuffer<T>::UniformBuffer(Context &gl)
+    : Buffer(gl) {
+    gl_.ctx.NamedBufferData(id, sizeof(T), &value_, GL_DYNAMIC_DRAW);
+    CHECK_GL_ERROR(gl_.ctx, NamedBufferData);
+}
+
+template<typename T>
+MOVE_CONSTRUCTOR_IMPL_TEMPLATE(UniformBuffer, T)
+    : Buffer(std::move(other)), value_(other.value_) {}
+
+template<typename T>
+MOVE_ASSIGN_OP_IMPL_TEMPLATE(UniformBuffer, T) {
+    if (this != &other) {
+        Buffer::operator=(std::move(other));
+        value_ = other.value_;
+    }
+    return *this;
+}
+
+template<typename T>
+const T &UniformBuffer<T>::value() const {
+    return value_;
+}
+
+template<typename T>
+void UniformBuffer<T>::update(const T &value) {
+    if (std::memcmp(&value_, &value, sizeof(T)) == 0)
+        return;
+    value_ = value;
+
+    gl_.ctx.NamedBufferSubData(id, 0, sizeof(T), &value_);
+    CHECK_GL_ERROR(gl_.ctx, NamedBufferSubData);
+    gl_.count_upload(sizeof(T));
+}
+
+template<typename T>
+void UniformBuffer<T>::bind_base(GLuint binding) {
+    gl_.bind_buffer_base(unwrap(BufferTarget::Uniform), binding, id);
+}
+
+// Fixed length array of std430 laid out T in immutable storage, for compute
+// shaders to read and write. Usable as a vertex buffer once a barrier is issued.
+template<typename T>
+class StorageBuffer : public Buffer {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    StorageBuffer(Context &gl, std::size_t count);
+    StorageBuffer(Context &gl, std::span<const T> values);
+
+    NO_COPY(StorageBuffer)
+
+    MOVE_CONSTRUCTOR(StorageBuffer);
+    MOVE_ASSIGN_OP(StorageBuffer);
+
+    std::size_t count() const;
+    std::size_t byte_size() const;
+
+    void write(std::size_t first, std::span<const T> values);
+    void zero();
+
+    // Stalls until the GPU is done with the buffer, writes from shaders need
+    // a BarrierBit::BufferUpdate barrier first
+    void read(std::size_t first, std::span<T> out) const;
+    std::vector<T> read() const;
+
+    void bind_base(GLuint binding);
+
+private:
+    std::size_t count_;
+
+    void allocate_(const T *values);
+};
+
+template<typename T>
+StorageBuffer<T>::StorageBuffer(Context &gl, std::size_t count)
+    : Buffer(gl), count_(count) {
+    allocate_(nullptr);
+}
+
+template<typename T>
+StorageBuffer<T>::StorageBuffer(Context &gl, std::span<const T> values)
+    : Buffer(gl), count_(values.size()) {
+    allocate_(values.data());
+}
+
+template<typename T>
+MOVE_CONSTRUCTOR_IMPL_TEMPLATE(StorageBuffer, T)
+    : Buffer(std::move(other)), count_(other.count_) {
+    other.count_ = 0;
+}
+
+template<typename T>
+MOVE_ASSIGN_OP_IMPL_TEMPLATE(StorageBuffer, T) {
+    if (this != &other) {
+        Buffer::operator=(std::move(other));
+        count_ = other.count_;
+        other.count_ = 0;
+    }
+    return *this;
+}
+
+template<typename T>
+std::size_t StorageBuffer<T>::count() const {
+    return count_;
+}
+
+template<typename T>
+std::size_t StorageBuffer<T>::byte_size() const {
+    return count_ * sizeof(T);
+}
+
+template<typename T>
+void StorageBuffer<T>::write(std::size_t first, std::span<const T> values) {
+    assert(first + values.size() <= count_);
+    if (values.empty())
+        return;
+
+    gl_.ctx.NamedBufferSubData(id, first * sizeof(T), values.size_bytes(), values.data());
+    CHECK_GL_ERROR(gl_.ctx, NamedBufferSubData);
+    gl_.count_upload(values.size_bytes());
+}
+
+template<typename T>
+void StorageBuffer<T>::zero() {
+    gl_.ctx.ClearNamedBufferData(id, GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+    CHECK_GL_ERROR(gl_.ctx, ClearNamedBufferData);
+}
+
+template<typename T>
+void StorageBuffer<T>::read(std::size_t first, std::span<T> out) const {
+    assert(first + out.size() <= count_);
+    if (out.empty())
+        return;
+
+    gl_.ctx.GetNamedBufferSubData(id, first * sizeof(T), out.size_bytes(), out.data());
+    CHECK_GL_ERROR(gl_.ctx, GetNamedBufferSubData);
+}
+
+template<typename T>
+std::vector<T> StorageBuffer<T>::read() const {
+    std::vector<T> values(count_);
+    read(0, values);
+    return values;
+}
+
+template<typename T>
+void StorageBuffer<T>::bind_base(GLuint binding) {
+    gl_.bind_buffer_base(unwrap(BufferTarget::ShaderStorage), binding, id);
+}
+
+template<typename T>
+void StorageBuffer<T>::allocate_(const T *values) {
+    // Zero sized storage is an error, keep at least one element around
+    const auto size = std::max<std::size_t>(count_, 1) * sizeof(T);
+    gl_.ctx.NamedBufferStorage(id, size, values, GL_DYNAMIC_STORAGE_BIT);
+    CHECK_GL_ERROR(gl_.ctx, NamedBufferStorage);
+    if (values)
+        gl_.count_upload(count_ * sizeof(T));
+    else
+        zero();
+}
+
 enum class FillMode { FrontToBack, BackToFront };
 
 template<typename T>
 class StaticSizeBuffer : public Buffer {
 public:
-    StaticSizeBuffer(GladGLContext &gl, std::size_t capacity, FillMode fill_mode = FillMode::FrontToBack);
+    StaticSizeBuffer(Context &gl, std::size_t capacity, FillMode fill_mode = FillMode::FrontToBack);
     ~StaticSizeBuffer();
 
     NO_COPY(StaticSizeBuffer)
@@ -62,10 +257,11 @@ public:
     bool has_room_for(std::size_t num_elements) const;
 
     void push(std::initializer_list<T> vs);
+    void push(std::span<const T> vs);
 
     void clear();
 
-    void sync_gl(BufferTarget target);
+    void sync_gl();
 
 private:
     FillMode fill_mode_;
@@ -79,7 +275,7 @@ private:
 };
 
 template<typename T>
-StaticSizeBuffer<T>::StaticSizeBuffer(GladGLContext &gl, std::size_t capacity, FillMode fill_mode)
+StaticSizeBuffer<T>::StaticSizeBuffer(Context &gl, std::size_t capacity, FillMode fill_mode)
     : Buffer(gl),
       fill_mode_(fill_mode),
       gl_buf_capacity_(0),
@@ -166,14 +362,18 @@ bool StaticSizeBuffer<T>::has_room_for(std::size_t num_elements) const {
 
 template<typename T>
 void StaticSizeBuffer<T>::push(std::initializer_list<T> vs) {
+    push(std::span(vs.begin(), vs.size()));
+}
+
+template<typename T>
+void StaticSizeBuffer<T>::push(std::span<const T> vs) {
     if (fill_mode_ == FillMode::FrontToBack) {
         assert(data_pos_ + vs.size() <= data_capacity_);
-        for (const auto v: vs)
-            data_[data_pos_++] = v;
+        std::ranges::copy(vs, data_ + data_pos_);
+        data_pos_ += vs.size();
     } else {
         assert(data_pos_ >= vs.size());
-        for (const auto &[i, v]: std::views::enumerate(vs))
-            data_[data_pos_ - vs.size() + i] = v;
+        std::ranges::copy(vs, data_ + data_pos_ - vs.size());
         data_pos_ -= vs.size();
     }
 }
@@ -190,30 +390,30 @@ void StaticSizeBuffer<T>::clear() {
 }
 
 template<typename T>
-void StaticSizeBuffer<T>::sync_gl(BufferTarget target) {
+void StaticSizeBuffer<T>::sync_gl() {
     if (gl_buf_capacity_ != 0 && gl_buf_pos_ == data_pos_)
         return;
-    bind(target);
 
     if (gl_buf_capacity_ == 0) {
-        gl_.BufferData(unwrap(target), data_capacity_ * sizeof(T), data_, GL_STREAM_DRAW);
-        CHECK_GL_ERROR(gl_, BufferData);
+        gl_.ctx.NamedBufferData(id, data_capacity_ * sizeof(T), data_, GL_STREAM_DRAW);
+        CHECK_GL_ERROR(gl_.ctx, NamedBufferData);
+        gl_.count_upload(data_capacity_ * sizeof(T));
         gl_buf_capacity_ = data_capacity_;
         MIZU_LOG_TRACE("Initialized GL buffer id={}", id);
     } else if (fill_mode_ == FillMode::FrontToBack) {
         assert(gl_buf_pos_ < data_pos_);
-        gl_.BufferSubData(
-                unwrap(target), gl_buf_pos_ * sizeof(T), (data_pos_ - gl_buf_pos_) * sizeof(T), data_ + gl_buf_pos_);
-        CHECK_GL_ERROR(gl_, BufferSubData);
+        gl_.ctx.NamedBufferSubData(
+                id, gl_buf_pos_ * sizeof(T), (data_pos_ - gl_buf_pos_) * sizeof(T), data_ + gl_buf_pos_);
+        CHECK_GL_ERROR(gl_.ctx, NamedBufferSubData);
+        gl_.count_upload((data_pos_ - gl_buf_pos_) * sizeof(T));
     } else {
         assert(gl_buf_pos_ > data_pos_);
-        gl_.BufferSubData(
-                unwrap(target), data_pos_ * sizeof(T), (gl_buf_pos_ - data_pos_) * sizeof(T), data_ + data_pos_);
-        CHECK_GL_ERROR(gl_, BufferSubData);
+        gl_.ctx.NamedBufferSubData(
+                id, data_pos_ * sizeof(T), (gl_buf_pos_ - data_pos_) * sizeof(T), data_ + data_pos_);
+        CHECK_GL_ERROR(gl_.ctx, NamedBufferSubData);
+        gl_.count_upload((gl_buf_pos_ - data_pos_) * sizeof(T));
     }
     gl_buf_pos_ = data_pos_;
-
-    unbind(target);
 }
 } // namespace gloo
 
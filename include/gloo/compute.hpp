@@ -0,0 +1,50 @@
+#ifndef GLOO_COMPUTE_HPP
+#define GLOO_COMPUTE_HPP
+
+#include <glm/vec3.hpp>
+#include <memory>
+#include <string>
+#include "gloo/buffer.hpp"
+#include "gloo/context.hpp"
+#include "gloo/shader.hpp"
+#include "mizu/util/class_helpers.hpp"
+
+namespace gloo {
+// A linked compute program plus the work group size it was compiled with.
+// Dispatches don't synchronize anything, follow them with Context::memory_barrier
+// for whatever reads the results.
+class ComputePipeline {
+public:
+    ComputePipeline(Context &gl, std::unique_ptr<Shader> shader);
+
+    // nullptr if the source fails to compile or link
+    static std::unique_ptr<ComputePipeline>
+    from_src(Context &gl, const std::string &src, const ShaderDefines &defines = {});
+
+    NO_COPY(ComputePipeline)
+    NO_MOVE(ComputePipeline)
+
+    Shader &shader();
+
+    // The layout(local_size_x/y/z) declared in the shader
+    glm::uvec3 local_size() const;
+
+    void dispatch(glm::uvec3 groups);
+
+    // Enough groups to run at least one invocation per element, the shader
+    // has to skip the ones past the end
+    void dispatch_covering(glm::uvec3 invocations);
+
+    // Group counts are read from three uints at offset in args
+    void dispatch_indirect(const Buffer &args, GLintptr offset = 0);
+
+private:
+    Context &gl_;
+    std::unique_ptr<Shader> shader_;
+
+    glm::uvec3 local_size_{1};
+    glm::uvec3 max_groups_{0};
+};
+} // namespace gloo
+
+#endif // GLOO_COMPUTE_HPP
@@ -1,8 +1,12 @@
 #ifndef GLOO_CONTEXT_HPP
 #define GLOO_CONTEXT_HPP
 
+#include <array>
 #include <glad/gl.h>
 #include <optional>
+#include <limits>
+#include <unordered_map>
+#include "gloo/program_cache.hpp"
 #include "mizu/core/color.hpp"
 #include "mizu/util/enum_class_helpers.hpp"
 
@@ -93,12 +97,77 @@ enum class ClipDepth : GLenum {
     ZeroToOne = GL_ZERO_TO_ONE,
 };
 
+enum class BarrierBit : GLbitfield {
+    VertexAttribArray = GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT,
+    ElementArray = GL_ELEMENT_ARRAY_BARRIER_BIT,
+    Uniform = GL_UNIFORM_BARRIER_BIT,
+    TextureFetch = GL_TEXTURE_FETCH_BARRIER_BIT,
+    ShaderImageAccess = GL_SHADER_IMAGE_ACCESS_BARRIER_BIT,
+    Command = GL_COMMAND_BARRIER_BIT,
+    PixelBuffer = GL_PIXEL_BUFFER_BARRIER_BIT,
+    TextureUpdate = GL_TEXTURE_UPDATE_BARRIER_BIT,
+    BufferUpdate = GL_BUFFER_UPDATE_BARRIER_BIT,
+    Framebuffer = GL_FRAMEBUFFER_BARRIER_BIT,
+    TransformFeedback = GL_TRANSFORM_FEEDBACK_BARRIER_BIT,
+    AtomicCounter = GL_ATOMIC_COUNTER_BARRIER_BIT,
+    ShaderStorage = GL_SHADER_STORAGE_BARRIER_BIT,
+    ClientMappedBuffer = GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT,
+    QueryBuffer = GL_QUERY_BUFFER_BARRIER_BIT,
+    All = GL_ALL_BARRIER_BITS,
+};
+
+struct StateStats {
+    std::size_t issued{0};
+    std::size_t elided{0};
+};
+
+struct DrawStats {
+    std::size_t draw_calls{0};
+    std::size_t vertices{0};
+    std::size_t bytes_uploaded{0};
+    std::size_t dispatches{0};
+};
+
 class Context {
 public:
     GladGLContext ctx;
+    ProgramCache program_cache{};
 
     std::optional<ContextVersion> load(GLADloadfunc func);
 
+    bool parallel_shader_compile() const;
+    bool compute_shaders() const;
+
+    // Binds below go through a shadow of the GL state and skip calls that
+    // wouldn't change anything. Anything that touches GL directly through ctx
+    // must call invalidate_state() afterwards.
+    void use_program(GLuint id);
+    void bind_vertex_array(GLuint id);
+    void bind_buffer(GLenum target, GLuint id);
+    void bind_buffer_base(GLenum target, GLuint index, GLuint id);
+    void bind_texture(GLuint unit, GLuint id);
+    void bind_framebuffer(GLuint id);
+
+    // GL unbinds names when they're deleted, so the shadow has to follow
+    void forget_program(GLuint id);
+    void forget_vertex_array(GLuint id);
+    void forget_buffer(GLuint id);
+    void forget_texture(GLuint id);
+    void forget_framebuffer(GLuint id);
+
+    void invalidate_state();
+
+    const StateStats &state_stats() const;
+    void reset_state_stats();
+
+    // Wrappers report their draws and buffer/texture uploads here
+    void count_draw(std::size_t vertices);
+    void count_upload(std::size_t bytes);
+    void count_dispatch();
+
+    const DrawStats &draw_stats() const;
+    void reset_draw_stats();
+
     void clear_color(const mizu::Color &color);
     void clear(ClearBit mask);
 
@@ -116,10 +185,64 @@ public:
 
     void depth_mask(bool enabled);
 
+    // Lower left origin, in framebuffer pixels. Only applies with ScissorTest enabled.
+    void scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    // Makes writes from shader storage, image stores or atomics visible to the
+    // kinds of access named in bits. Not shadowed, every call is issued.
+    void memory_barrier(BarrierBit bits);
+
     void debug_message_callback(GLDEBUGPROC callback, const void *user_param);
+
+private:
+    static constexpr GLuint UNKNOWN_ = std::numeric_limits<GLuint>::max();
+    static constexpr std::size_t BUFFER_TARGET_COUNT_ = 14;
+    static constexpr std::size_t TEXTURE_UNIT_COUNT_ = 32;
+
+    struct Shadow {
+        GLuint program{UNKNOWN_};
+        GLuint vertex_array{UNKNOWN_};
+        GLuint framebuffer{UNKNOWN_};
+        std::array<GLuint, BUFFER_TARGET_COUNT_> buffers{};
+        std::array<GLuint, TEXTURE_UNIT_COUNT_> textures{};
+        std::unordered_map<GLenum, bool> capabilities{};
+        std::optional<std::pair<BlendFunc, BlendFunc>> blend_func{};
+        std::optional<DepthFunc> depth_func{};
+        std::optional<bool> depth_mask{};
+        std::optional<float> clear_depth{};
+        std::optional<std::pair<ClipOrigin, ClipDepth>> clip_control{};
+        std::optional<std::array<GLint, 4>> scissor{};
+
+        Shadow() {
+            buffers.fill(UNKNOWN_);
+            textures.fill(UNKNOWN_);
+        }
+    };
+
+    Shadow shadow_{};
+    StateStats stats_{};
+    DrawStats draw_stats_{};
+
+    // Returns true and counts an issued call if the shadowed value differs
+    template<typename T>
+    bool update_shadow_(T &shadowed, const T &value);
+
+    static std::optional<std::size_t> buffer_target_slot_(GLenum target);
 };
+
+template<typename T>
+bool Context::update_shadow_(T &shadowed, const T &value) {
+    if (shadowed == value) {
+        stats_.elided++;
+        return false;
+    }
+    shadowed = value;
+    stats_.issued++;
+    return true;
+}
 } // namespace gloo
 
 ENUM_CLASS_ENABLE_BITOPS(gloo::ClearBit);
+ENUM_CLASS_ENABLE_BITOPS(gloo::BarrierBit);
 
 #endif // GLOO_CONTEXT_HPP
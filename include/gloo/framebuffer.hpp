@@ -0,0 +1,50 @@
+#ifndef GLOO_FRAMEBUFFER_HPP
+#define GLOO_FRAMEBUFFER_HPP
+
+#include <glm/vec2.hpp>
+#include <memory>
+#include "gloo/context.hpp"
+#include "gloo/texture.hpp"
+#include "mizu/util/class_helpers.hpp"
+
+namespace gloo {
+enum class BlitFilter : GLenum {
+    Nearest = GL_NEAREST,
+    Linear = GL_LINEAR,
+};
+
+// Color texture plus a depth renderbuffer at a fixed size
+class Framebuffer {
+public:
+    GLuint id{0};
+
+    Framebuffer(Context &gl, glm::ivec2 size, InternalFormat color_format = InternalFormat::Rgba8);
+
+    ~Framebuffer();
+
+    NO_COPY(Framebuffer)
+    NO_MOVE(Framebuffer)
+
+    glm::ivec2 size() const;
+    const Texture &color() const;
+
+    bool complete() const;
+
+    void bind();
+    void unbind();
+
+    // Copies the color attachment into dst_fbo (0 for the window), scaling to dst_size
+    void blit_to(GLuint dst_fbo, glm::ivec2 dst_size, BlitFilter filter = BlitFilter::Nearest) const;
+    // Same, but only the src_size region in the lower left corner is copied
+    void blit_to(GLuint dst_fbo, glm::ivec2 src_size, glm::ivec2 dst_size, BlitFilter filter) const;
+
+private:
+    Context &gl_;
+
+    glm::ivec2 size_;
+    std::unique_ptr<Texture> color_;
+    GLuint depth_{0};
+};
+} // namespace gloo
+
+#endif // GLOO_FRAMEBUFFER_HPP
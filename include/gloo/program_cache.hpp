@@ -0,0 +1,42 @@
+#ifndef GLOO_PROGRAM_CACHE_HPP
+#define GLOO_PROGRAM_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <glad/gl.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gloo {
+struct ProgramBinary {
+    GLenum format;
+    std::vector<std::byte> bytes;
+};
+
+// Stores linked program binaries on disk, keyed by a hash of the stage
+// sources and the driver that produced them
+class ProgramCache {
+public:
+    bool open(GladGLContext &gl, const std::filesystem::path &dir);
+    void close();
+
+    bool enabled() const;
+
+    // Stages must be hashed in the order they're attached
+    std::uint64_t key(const std::vector<std::pair<GLenum, std::string_view>> &stages) const;
+
+    std::optional<ProgramBinary> load(std::uint64_t key) const;
+    void store(std::uint64_t key, const ProgramBinary &binary) const;
+    void evict(std::uint64_t key) const;
+
+private:
+    std::optional<std::filesystem::path> dir_{std::nullopt};
+    std::string driver_{};
+
+    std::filesystem::path entry_path_(std::uint64_t key) const;
+};
+} // namespace gloo
+
+#endif // GLOO_PROGRAM_CACHE_HPP
@@ -3,17 +3,64 @@
 
 #include <glad/gl.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
+#include "gloo/context.hpp"
+#include "gloo/program_cache.hpp"
+#include "mizu/core/log.hpp"
 #include "mizu/util/class_helpers.hpp"
+#include "mizu/util/is_any_of.hpp"
 
 namespace gloo {
+template<typename T>
+concept UniformType = mizu::IsAnyOf<
+        T,
+        float,
+        int,
+        unsigned int,
+        glm::vec2,
+        glm::vec3,
+        glm::vec4,
+        glm::ivec2,
+        glm::ivec3,
+        glm::ivec4,
+        glm::uvec2,
+        glm::uvec3,
+        glm::uvec4,
+        glm::mat2,
+        glm::mat3,
+        glm::mat4>;
+
+// A uniform location resolved once, written with glProgramUniform* so the
+// program doesn't need to be bound. Default constructed handles are no-ops.
+template<UniformType T>
+class UniformHandle {
+public:
+    UniformHandle() = default;
+    UniformHandle(GladGLContext &gl, GLuint program_id, GLint loc)
+        : gl_(&gl), program_id_(program_id), loc_(loc) {}
+
+    bool valid() const;
+
+    void set(const T &v) const;
+
+private:
+    GladGLContext *gl_{nullptr};
+    GLuint program_id_{0};
+    GLint loc_{-1};
+};
+
 class Shader {
-    friend class ShaderBuilder;
+    friend class PendingShader;
 
 public:
     GLuint id;
@@ -29,6 +76,11 @@ public:
 
     std::optional<GLuint> attrib_location(const std::string &name);
 
+    template<UniformType T>
+    UniformHandle<T> uniform_handle(const std::string &name);
+
+    bool uniform_block_binding(const std::string &name, GLuint binding);
+
     void uniform(const std::string &name, float v0);
     void uniform(const std::string &name, float v0, float v1);
     void uniform(const std::string &name, float v0, float v1, float v2);
@@ -73,49 +125,210 @@ public:
     void uniform(const std::string &name, const glm::mat4x3 &v);
 
 private:
-    GladGLContext &gl_;
+    Context &gl_;
     std::unordered_map<std::string, GLint> uniform_locs_{};
     std::unordered_set<std::string> bad_uniform_locs_{};
     std::unordered_map<std::string, GLint> attrib_locs_{};
     std::unordered_set<std::string> bad_attrib_locs_{};
 
-    explicit Shader(GladGLContext &gl, GLuint id);
+    explicit Shader(Context &gl, GLuint id);
 
     std::optional<GLint> find_uniform_loc_(const std::string &name);
 };
 
+template<UniformType T>
+bool UniformHandle<T>::valid() const {
+    return loc_ != -1;
+}
+
+template<UniformType T>
+void UniformHandle<T>::set(const T &v) const {
+    if (loc_ == -1)
+        return;
+
+    if constexpr (std::same_as<T, float>) {
+        gl_->ProgramUniform1f(program_id_, loc_, v);
+        CHECK_GL_ERROR(*gl_, ProgramUniform1f);
+    } else if constexpr (std::same_as<T, int>) {
+        gl_->ProgramUniform1i(program_id_, loc_, v);
+        CHECK_GL_ERROR(*gl_, ProgramUniform1i);
+    } else if constexpr (std::same_as<T, unsigned int>) {
+        gl_->ProgramUniform1ui(program_id_, loc_, v);
+        CHECK_GL_ERROR(*gl_, ProgramUniform1ui);
+    } else if constexpr (std::same_as<T, glm::vec2>) {
+        gl_->ProgramUniform2fv(program_id_, loc_, 1, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniform2fv);
+    } else if constexpr (std::same_as<T, glm::vec3>) {
+        gl_->ProgramUniform3fv(program_id_, loc_, 1, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniform3fv);
+    } else if constexpr (std::same_as<T, glm::vec4>) {
+        gl_->ProgramUniform4fv(program_id_, loc_, 1, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniform4fv);
+    } else if constexpr (std::same_as<T, glm::ivec2>) {
+        gl_->ProgramUniform2iv(program_id_, loc_, 1, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniform2iv);
+    } else if constexpr (std::same_as<T, glm::ivec3>) {
+        gl_->ProgramUniform3iv(program_id_, loc_, 1, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniform3iv);
+    } else if constexpr (std::same_as<T, glm::ivec4>) {
+        gl_->ProgramUniform4iv(program_id_, loc_, 1, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniform4iv);
+    } else if constexpr (std::same_as<T, glm::uvec2>) {
+        gl_->ProgramUniform2uiv(program_id_, loc_, 1, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniform2uiv);
+    } else if constexpr (std::same_as<T, glm::uvec3>) {
+        gl_->ProgramUniform3uiv(program_id_, loc_, 1, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniform3uiv);
+    } else if constexpr (std::same_as<T, glm::uvec4>) {
+        gl_->ProgramUniform4uiv(program_id_, loc_, 1, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniform4uiv);
+    } else if constexpr (std::same_as<T, glm::mat2>) {
+        gl_->ProgramUniformMatrix2fv(program_id_, loc_, 1, GL_FALSE, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniformMatrix2fv);
+    } else if constexpr (std::same_as<T, glm::mat3>) {
+        gl_->ProgramUniformMatrix3fv(program_id_, loc_, 1, GL_FALSE, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniformMatrix3fv);
+    } else if constexpr (std::same_as<T, glm::mat4>) {
+        gl_->ProgramUniformMatrix4fv(program_id_, loc_, 1, GL_FALSE, glm::value_ptr(v));
+        CHECK_GL_ERROR(*gl_, ProgramUniformMatrix4fv);
+    }
+}
+
+template<UniformType T>
+UniformHandle<T> Shader::uniform_handle(const std::string &name) {
+    if (const auto loc = find_uniform_loc_(name); loc)
+        return UniformHandle<T>(gl_.ctx, id, *loc);
+    return UniformHandle<T>();
+}
+
 enum class ShaderType : GLenum {
     Vertex = GL_VERTEX_SHADER,
     Fragment = GL_FRAGMENT_SHADER,
+    Compute = GL_COMPUTE_SHADER,
 };
 
 inline std::string shader_type_str(ShaderType type) {
     switch (type) {
     case ShaderType::Vertex: return "vertex";
     case ShaderType::Fragment: return "fragment";
+    case ShaderType::Compute: return "compute";
     default: std::unreachable();
     }
 }
 
+// A program whose compile and link were issued but not yet checked. With
+// GL_KHR_parallel_shader_compile the driver works on it in the background
+// until finish() is called, so several of these can be in flight at once.
+class PendingShader {
+    friend class ShaderBuilder;
+
+public:
+    ~PendingShader();
+
+    NO_COPY(PendingShader)
+
+    MOVE_CONSTRUCTOR(PendingShader);
+    MOVE_ASSIGN_OP(PendingShader);
+
+    // Never blocks, always true if the driver can't compile in the background
+    bool ready() const;
+
+    // Blocks until the program is linked, nullptr on failure
+    std::unique_ptr<Shader> finish();
+
+private:
+    Context &gl_;
+    const ProgramCache *cache_;
+    std::uint64_t key_;
+
+    GLuint program_id_;
+    std::vector<std::pair<GLuint, ShaderType>> stages_;
+    bool from_cache_;
+
+    PendingShader(
+            Context &gl,
+            const ProgramCache *cache,
+            std::uint64_t key,
+            GLuint program_id,
+            std::vector<std::pair<GLuint, ShaderType>> stages,
+            bool from_cache);
+
+    bool check_compile_(GLuint id, ShaderType type) const;
+    bool check_link_() const;
+
+    void store_binary_() const;
+
+    void delete_stages_();
+    void delete_program_();
+};
+
+// Name/value pairs, an empty value defines the name without one
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
 class ShaderBuilder {
 public:
-    explicit ShaderBuilder(GladGLContext &gl);
+    explicit ShaderBuilder(Context &gl);
 
     NO_COPY(ShaderBuilder)
     NO_MOVE(ShaderBuilder)
 
     ShaderBuilder &stage_src(ShaderType type, const std::string &src);
 
+    // Inserted into every stage right after its #version line
+    ShaderBuilder &define(const std::string &name, const std::string &value = "");
+    ShaderBuilder &defines(const ShaderDefines &defines);
+
+    // Source substituted for '#include "name"' lines in any stage or other include
+    ShaderBuilder &include(const std::string &name, const std::string &src);
+
     std::unique_ptr<Shader> link();
+    PendingShader link_async();
 
 private:
-    GladGLContext &gl_;
-    std::vector<std::tuple<GLuint, ShaderType, std::string>> stages_{};
+    Context &gl_;
+    const ProgramCache *cache_;
+    std::vector<std::pair<ShaderType, std::string>> stages_{};
+    ShaderDefines defines_{};
+    std::unordered_map<std::string, std::string> includes_{};
 
-    bool try_compile_(GLuint id, ShaderType type, const std::string &src) const;
-    bool try_link_(GLuint id) const;
+    std::string preprocess_(const std::string &src) const;
+    void expand_includes_(std::string_view src, std::string &out, std::size_t depth) const;
 
-    void delete_stages_();
+    std::uint64_t cache_key_(const std::vector<std::pair<ShaderType, std::string>> &stages) const;
+    std::optional<GLuint> try_load_binary_(std::uint64_t key) const;
+};
+
+// Lazily links and caches every combination of defines requested from one set
+// of stage sources, so variants of a shader share a single source of truth
+class ShaderPermutations {
+public:
+    explicit ShaderPermutations(Context &gl);
+
+    NO_COPY(ShaderPermutations)
+    NO_MOVE(ShaderPermutations)
+
+    ShaderPermutations &stage_src(ShaderType type, const std::string &src);
+    ShaderPermutations &include(const std::string &name, const std::string &src);
+
+    // Links every permutation not already cached, issuing them all before
+    // waiting on any so the driver can compile them in parallel
+    void prewarm(std::span<const ShaderDefines> permutations);
+
+    // Define order doesn't matter, nullptr if the permutation failed to link
+    Shader *get(const ShaderDefines &defines);
+
+    std::size_t size() const;
+
+private:
+    Context &gl_;
+    std::vector<std::pair<ShaderType, std::string>> stages_{};
+    std::unordered_map<std::string, std::string> includes_{};
+
+    std::unordered_map<std::string, std::unique_ptr<Shader>> shaders_{};
+
+    static std::string key_(const ShaderDefines &defines);
+
+    PendingShader link_async_(const ShaderDefines &defines) const;
 };
 } // namespace gloo
 
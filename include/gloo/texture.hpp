@@ -21,12 +21,68 @@ enum class MagFilter : GLenum {
     Linear = GL_LINEAR,
 };
 
+enum class InternalFormat : GLenum {
+    R8 = GL_R8,
+    Rg8 = GL_RG8,
+    Rgba8 = GL_RGBA8,
+    Srgb8Alpha8 = GL_SRGB8_ALPHA8,
+};
+
+enum class Wrap : GLenum {
+    ClampToEdge = GL_CLAMP_TO_EDGE,
+    ClampToBorder = GL_CLAMP_TO_BORDER,
+    MirroredRepeat = GL_MIRRORED_REPEAT,
+    Repeat = GL_REPEAT,
+};
+
+enum class Swizzle : GLenum {
+    Red = GL_RED,
+    Green = GL_GREEN,
+    Blue = GL_BLUE,
+    Alpha = GL_ALPHA,
+    Zero = GL_ZERO,
+    One = GL_ONE,
+};
+
+enum class ImageAccess : GLenum {
+    ReadOnly = GL_READ_ONLY,
+    WriteOnly = GL_WRITE_ONLY,
+    ReadWrite = GL_READ_WRITE,
+};
+
+struct SwizzleMask {
+    Swizzle r{Swizzle::Red};
+    Swizzle g{Swizzle::Green};
+    Swizzle b{Swizzle::Blue};
+    Swizzle a{Swizzle::Alpha};
+};
+
+// Single channel coverage sampled as white with the coverage in alpha
+constexpr SwizzleMask SWIZZLE_COVERAGE{Swizzle::One, Swizzle::One, Swizzle::One, Swizzle::Red};
+
+struct TextureDesc {
+    InternalFormat format{InternalFormat::Rgba8};
+    // 0 picks a full chain if min_filter samples mipmaps, 1 level otherwise
+    GLsizei mip_levels{0};
+    MinFilter min_filter{MinFilter::Nearest};
+    MagFilter mag_filter{MagFilter::Linear};
+    Wrap wrap_s{Wrap::ClampToEdge};
+    Wrap wrap_t{Wrap::ClampToEdge};
+    SwizzleMask swizzle{};
+};
+
+bool uses_mipmaps(MinFilter filter);
+
+GLsizei full_mip_chain_levels(glm::ivec2 size);
+
+std::size_t bytes_per_texel(InternalFormat format);
+
 class Texture {
 public:
     GLuint id{0};
 
-    Texture(GladGLContext &gl, const mizu::PngData &data, MinFilter min_filter, MagFilter mag_filter);
-    Texture(GladGLContext &gl, glm::ivec2 size, MinFilter min_filter, MagFilter mag_filter);
+    Texture(Context &gl, const mizu::PngData &data, const TextureDesc &desc);
+    Texture(Context &gl, glm::ivec2 size, const TextureDesc &desc);
 
     ~Texture();
 
@@ -35,10 +91,38 @@ public:
     MOVE_CONSTRUCTOR(Texture);
     MOVE_ASSIGN_OP(Texture);
 
-    void write_subimage(glm::ivec2 pos, glm::ivec2 size, const unsigned char *bytes);
+    glm::ivec2 size() const;
+    InternalFormat format() const;
+    GLsizei mip_levels() const;
+
+    // bytes has bytes_per_texel(format()) bytes per texel. Rows are tightly packed
+    // unless row_length gives the source width in texels, for uploading part of a larger image.
+    void write_subimage(glm::ivec2 pos, glm::ivec2 size, const unsigned char *bytes, GLint row_length = 0);
+
+    // GPU side copy of level 0, the formats must be compatible
+    void copy_subimage_from(const Texture &src, glm::ivec2 src_pos, glm::ivec2 dst_pos, glm::ivec2 size);
+
+    void generate_mipmaps();
+
+    // For imageLoad/imageStore in compute shaders. sRGB textures are bound as
+    // plain RGBA8 since image units can't do the conversion.
+    void bind_image(GLuint unit, ImageAccess access, GLint level = 0) const;
 
 private:
-    GladGLContext &gl_;
+    Context &gl_;
+
+    glm::ivec2 size_;
+    InternalFormat format_;
+    GLsizei mip_levels_;
+
+    void allocate_(const TextureDesc &desc);
+    void upload_(
+            glm::ivec2 pos,
+            glm::ivec2 size,
+            GLenum pixel_format,
+            std::size_t texel_size,
+            const void *bytes,
+            GLint row_length = 0);
 };
 } // namespace gloo
 
@@ -4,6 +4,7 @@
 #include <glad/gl.h>
 #include <memory>
 #include "gloo/buffer.hpp"
+#include "gloo/context.hpp"
 #include "gloo/shader.hpp"
 #include "mizu/util/class_helpers.hpp"
 #include "mizu/util/is_any_of.hpp"
@@ -31,26 +32,40 @@ public:
     void bind();
     void unbind();
 
+    // Attaches a buffer to a binding declared by the builder, using the stride
+    // the builder computed for it. Swapping buffers keeps the vertex format.
+    void vertex_buffer(GLuint binding, const Buffer &buf, GLintptr offset = 0);
+
     void draw_arrays(DrawMode mode, std::size_t first, std::size_t count);
+    void draw_arrays_instanced(DrawMode mode, std::size_t first, std::size_t count, std::size_t instances);
 
 private:
-    GladGLContext &gl_;
+    Context &gl_;
+
+    std::vector<GLsizei> strides_;
 
-    VertexArray(GladGLContext &gl, GLuint id);
+    VertexArray(Context &gl, GLuint id, std::vector<GLsizei> strides);
 };
 
 class VertexArrayBuilder {
 public:
-    explicit VertexArrayBuilder(GladGLContext &gl);
+    explicit VertexArrayBuilder(Context &gl);
 
     NO_COPY(VertexArrayBuilder)
     NO_MOVE(VertexArrayBuilder)
 
     VertexArrayBuilder &with(Shader *shader);
 
+    // Starts a new buffer binding whose attributes are T, with no buffer attached yet.
+    // A non-zero divisor advances the binding once per that many instances instead of per vertex.
+    template<typename T>
+        requires mizu::IsAnyOf<T, float, int, unsigned int>
+    VertexArrayBuilder &binding(GLuint divisor = 0);
+
+    // Starts a new buffer binding and attaches buf to it
     template<typename T>
         requires mizu::IsAnyOf<T, float, int, unsigned int>
-    VertexArrayBuilder &with(StaticSizeBuffer<T> *buf, BufferTarget target);
+    VertexArrayBuilder &with(StaticSizeBuffer<T> *buf);
 
     VertexArrayBuilder &vec(const std::string &name, GLint size, bool normalized = false);
 
@@ -58,11 +73,14 @@ public:
 
 private:
     GLuint id_;
-    GladGLContext &gl_;
+    Context &gl_;
 
-    std::optional<BufferTarget> current_target_{std::nullopt};
+    std::optional<GLuint> current_binding_{std::nullopt};
+    const Buffer *current_buf_{nullptr};
     GLsizei current_buf_item_size_{0};
     GLenum current_buf_type_;
+    GLuint current_offset_{0};
+    GLuint current_divisor_{0};
     Shader *attrib_lookup_{nullptr};
 
     struct AttribInfo {
@@ -70,10 +88,12 @@ private:
         GLint size;
         GLenum type;
         GLboolean normalized;
-        GLsizei offset;
+        GLuint offset;
     };
     std::vector<AttribInfo> attrib_info_buf_{};
+    std::vector<GLsizei> strides_{};
 
+    void begin_binding_(const Buffer *buf, GLsizei item_size, GLenum type, GLuint divisor = 0);
     void flush_();
 
     template<typename T>
@@ -82,14 +102,15 @@ private:
 
 template<typename T>
     requires mizu::IsAnyOf<T, float, int, unsigned int>
-VertexArrayBuilder &VertexArrayBuilder::with(StaticSizeBuffer<T> *buf, BufferTarget target) {
-    flush_();
-    buf->bind(target);
-
-    current_target_ = target;
-    current_buf_item_size_ = sizeof(T);
-    current_buf_type_ = determine_buf_type_<T>();
+VertexArrayBuilder &VertexArrayBuilder::binding(GLuint divisor) {
+    begin_binding_(nullptr, sizeof(T), determine_buf_type_<T>(), divisor);
+    return *this;
+}
 
+template<typename T>
+    requires mizu::IsAnyOf<T, float, int, unsigned int>
+VertexArrayBuilder &VertexArrayBuilder::with(StaticSizeBuffer<T> *buf) {
+    begin_binding_(buf, sizeof(T), determine_buf_type_<T>());
     return *this;
 }
 
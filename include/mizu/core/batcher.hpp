@@ -1,21 +1,56 @@
 #ifndef MIZU_BATCHER_HPP
 #define MIZU_BATCHER_HPP
 
+#include <array>
+#include <functional>
 #include <glad/gl.h>
+#include <optional>
+#include <span>
 #include "gloo/buffer.hpp"
 #include "gloo/context.hpp"
+#include "gloo/shader.hpp"
 #include "gloo/vertex_array.hpp"
 #include "mizu/util/time.hpp"
 
 namespace mizu {
-enum class BatchType : std::size_t { Points = 0, Lines = 1, Triangles = 2, Tex = 3 };
+class DrawRecorder;
+
+// The *Unrotated types use a vertex format without rot_params and a shader
+// permutation that skips building the rotation matrix per vertex.
+// SdfUnrotated shares TexUnrotated's format, the texture's alpha is a distance field.
+enum class BatchType : std::size_t {
+    Points = 0,
+    Lines = 1,
+    Triangles = 2,
+    Tex = 3,
+    LinesUnrotated = 4,
+    TrianglesUnrotated = 5,
+    TexUnrotated = 6,
+    SdfUnrotated = 7,
+};
+
+constexpr std::size_t BATCH_TYPE_COUNT = 8;
+
+// Floats per vertex in each type's format, indexed by the type
+constexpr std::size_t BATCH_VERTEX_SIZE[BATCH_TYPE_COUNT] = {7, 10, 10, 12, 7, 7, 9, 9};
+
+// Mirrors the std140 "Frame" block shared by every engine shader
+struct FrameUniforms {
+    glm::mat4 proj{1.0f};
+    glm::mat4 view{1.0f};
+    glm::vec4 viewport{0.0f};
+    float time{0.0f};
+    float pad_[3]{};
+};
+static_assert(sizeof(FrameUniforms) == 160);
+
+constexpr GLuint FRAME_UNIFORMS_BINDING = 0;
 
 struct Batch {
     std::size_t vertex_size;
     std::unique_ptr<gloo::StaticSizeBuffer<float>> vbo;
-    std::unique_ptr<gloo::VertexArray> vao;
 
-    Batch(gloo::Context &gl, BatchType type, gloo::Shader *shader, std::size_t capacity, gloo::FillMode fill_mode);
+    Batch(gloo::Context &gl, BatchType type, std::size_t capacity, gloo::FillMode fill_mode);
 };
 
 class BatchListBase {
@@ -23,6 +58,7 @@ protected:
     gloo::Context &gl_;
     BatchType type_;
     gloo::Shader *shader_;
+    gloo::VertexArray *vao_;
     gloo::FillMode fill_mode_;
 
     std::size_t active_idx_;
@@ -33,10 +69,12 @@ protected:
     MaxPeriod<std::size_t> batch_count_max_;
     std::size_t last_batch_count_;
 
-    BatchListBase(gloo::Context &gl, BatchType type, gloo::Shader *shader, gloo::FillMode fill_mode)
+    BatchListBase(
+            gloo::Context &gl, BatchType type, gloo::Shader *shader, gloo::VertexArray *vao, gloo::FillMode fill_mode)
         : gl_(gl),
           type_(type),
           shader_(shader),
+          vao_(vao),
           fill_mode_(fill_mode),
           active_idx_(0),
           batches_(),
@@ -53,40 +91,43 @@ protected:
 
 class OpaqueBatchList : BatchListBase {
 public:
-    OpaqueBatchList(gloo::Context &gl, BatchType type, gloo::Shader *shader)
-        : BatchListBase(gl, type, shader, gloo::FillMode::BackToFront) {}
+    OpaqueBatchList(gloo::Context &gl, BatchType type, gloo::Shader *shader, gloo::VertexArray *vao)
+        : BatchListBase(gl, type, shader, vao, gloo::FillMode::BackToFront) {}
 
     NO_COPY(OpaqueBatchList)
     NO_MOVE(OpaqueBatchList)
 
-    void add(std::initializer_list<float> vertex_data);
+    void add(std::span<const float> vertex_data);
 
-    void draw(const glm::mat4 &projection);
+    void draw();
 
     void clear();
 };
 
+constexpr std::size_t NO_CLIP_IDX = std::numeric_limits<std::size_t>::max();
+
 struct TransBatchListDrawParams {
     std::size_t batch_idx;
     std::size_t first;
     std::size_t count;
     std::size_t texture_id{0};
     std::size_t list_idx{0};
+    std::size_t clip_idx{NO_CLIP_IDX};
 };
 
 class TransBatchList : BatchListBase {
 public:
-    TransBatchList(gloo::Context &gl, BatchType type, gloo::Shader *shader)
-        : BatchListBase(gl, type, shader, gloo::FillMode::FrontToBack) {}
+    TransBatchList(gloo::Context &gl, BatchType type, gloo::Shader *shader, gloo::VertexArray *vao)
+        : BatchListBase(gl, type, shader, vao, gloo::FillMode::FrontToBack) {}
 
     NO_COPY(TransBatchList)
     NO_MOVE(TransBatchList)
 
     std::vector<TransBatchListDrawParams> draw_calls();
 
-    void add(std::initializer_list<float> vertex_data);
+    void add(std::span<const float> vertex_data);
 
-    void set_projection_and_sync(const glm::mat4 &projection);
+    void sync();
 
     void draw(std::size_t batch_idx, std::size_t first, std::size_t count);
 
@@ -102,6 +143,7 @@ private:
 class Batcher {
     const std::size_t NO_LAST_IDX_ = std::numeric_limits<std::size_t>::max();
     const GLuint NO_LAST_ID_ = std::numeric_limits<GLuint>::max();
+    const std::size_t CUSTOM_LIST_IDX_ = NO_LAST_IDX_ - 1;
 
 public:
     explicit Batcher(gloo::Context &ctx);
@@ -112,29 +154,70 @@ public:
     float z();
 
     void add(BatchType type, bool trans, GLuint texture_id, std::initializer_list<float> vertex_data);
+    void add(BatchType type, bool trans, GLuint texture_id, std::span<const float> vertex_data);
+
+    // Clip rects are (x0, y0, x1, y1) in the same space as vertex positions and
+    // intersect with the enclosing one. Adds entirely outside the clip are
+    // dropped and ones entirely inside are batched as if unclipped, only adds
+    // straddling the edge pay for a scissored draw call. Rotated types can't be
+    // bounded cheaply, so they're always scissored.
+    void push_clip(glm::vec4 rect);
+    void pop_clip();
+    std::optional<glm::vec4> clip() const;
 
-    void draw(glm::mat4 projection);
+    // Adds dropped by clip culling since the last clear()
+    std::size_t culled() const;
+
+    // Runs fn during draw() between the translucent batches added before and
+    // after it, with blending on, depth writes off and the Frame block bound.
+    // fn must use the Context shadow for any state it changes. Not recorded.
+    void add_custom(std::function<void()> fn);
+
+    // Every add and frame is also passed to the recorder while one is set
+    void set_recorder(DrawRecorder *recorder);
+
+    void draw(const FrameUniforms &frame);
 
     void clear();
 
 private:
     gloo::Context &gl_;
 
-    std::unique_ptr<gloo::Shader> shaders_[4];
+    gloo::ShaderPermutations prim_shaders_;
+    gloo::ShaderPermutations tex_shaders_;
+    std::array<gloo::Shader *, BATCH_TYPE_COUNT> shaders_;
+    gloo::UniformBuffer<FrameUniforms> frame_ubo_;
+    // One per vertex format, batches swap their buffer in before drawing
+    std::array<std::unique_ptr<gloo::VertexArray>, BATCH_TYPE_COUNT> vaos_;
 
-    OpaqueBatchList opaque_batch_lists_[3];
+    // Textured types are only ever drawn as translucent, their opaque lists stay empty
+    OpaqueBatchList opaque_batch_lists_[BATCH_TYPE_COUNT];
 
-    TransBatchList trans_batch_lists_[4];
+    TransBatchList trans_batch_lists_[BATCH_TYPE_COUNT];
     std::size_t last_trans_batch_list_idx_{NO_LAST_IDX_};
     GLuint last_texture_id_{NO_LAST_ID_};
     std::vector<TransBatchListDrawParams> saved_trans_draw_calls_{};
+    std::vector<std::function<void()>> custom_draws_{};
+
+    std::vector<glm::vec4> clip_rects_{};
+    std::vector<std::size_t> clip_stack_{};
+    std::size_t last_clip_idx_{NO_CLIP_IDX};
+    std::size_t culled_{0};
 
     float z_level_{2.0f};
 
-    void add_opaque_(BatchType type, std::initializer_list<float> vertex_data);
+    DrawRecorder *recorder_{nullptr};
 
-    void add_trans_(BatchType type, GLuint texture_id, std::initializer_list<float> vertex_data);
+    std::array<gloo::Shader *, BATCH_TYPE_COUNT> link_shaders_();
+    std::array<std::unique_ptr<gloo::VertexArray>, BATCH_TYPE_COUNT> build_vertex_arrays_();
+
+    void add_opaque_(BatchType type, std::span<const float> vertex_data);
+
+    void add_trans_(BatchType type, GLuint texture_id, std::span<const float> vertex_data, std::size_t clip_idx);
     void flush_trans_draw_calls_();
+
+    std::size_t current_clip_idx_() const;
+    void apply_clip_(std::size_t clip_idx, const FrameUniforms &frame);
 };
 } // namespace mizu
 
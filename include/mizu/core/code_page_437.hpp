@@ -0,0 +1,42 @@
+#ifndef MIZU_CODE_PAGE_437_HPP
+#define MIZU_CODE_PAGE_437_HPP
+
+#include <cstdint>
+#include <glm/vec2.hpp>
+#include <string_view>
+#include "mizu/core/color.hpp"
+#include "mizu/core/g2d.hpp"
+#include "mizu/core/texture.hpp"
+#include "mizu/util/class_helpers.hpp"
+
+namespace mizu {
+// Draws text from a sheet of fixed size characters laid out left to right, top to bottom
+// in code page 437 order. Sheets that leave out the leading control pictures start at first.
+class CodePage437 {
+public:
+    CodePage437(G2d &g2d, const Texture &sheet, glm::uvec2 char_size, float scale = 1.0f, std::uint8_t first = 0x20);
+
+    NO_COPY(CodePage437)
+    NO_MOVE(CodePage437)
+
+    // In pixels with the scale applied
+    glm::vec2 char_size() const;
+    glm::vec2 calc_size(std::string_view text) const;
+
+    void draw(std::string_view text, glm::vec2 pos, const Color &color = rgb(0xffffff));
+
+    // The code page 437 byte cp is drawn with, '?' for codepoints it doesn't have
+    static std::uint8_t encode(char32_t cp);
+
+private:
+    G2d &g2d_;
+    const Texture &sheet_;
+    glm::vec2 char_size_;
+    float scale_;
+    std::uint8_t first_;
+    int columns_;
+    int count_;
+};
+} // namespace mizu
+
+#endif // MIZU_CODE_PAGE_437_HPP
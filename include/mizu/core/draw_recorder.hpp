@@ -0,0 +1,82 @@
+#ifndef MIZU_DRAW_RECORDER_HPP
+#define MIZU_DRAW_RECORDER_HPP
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_set>
+#include <vector>
+#include "gloo/context.hpp"
+#include "mizu/core/batcher.hpp"
+#include "mizu/util/class_helpers.hpp"
+
+namespace mizu {
+// Serializes the Batcher input stream so a slow frame can be replayed in isolation
+//
+// File layout, native endian since recordings are replayed on the machine that made them.
+// Depth isn't stored separately, it's already in every vertex.
+//   header  "MZDR" u32 version
+//   texture u8 0, u32 id, i32 width, i32 height   (first time an id is seen)
+//   add     u8 1, u8 type, u8 trans, u32 texture id, u32 count, f32[count]
+//   frame   u8 2, FrameUniforms                   (ends the frame's adds)
+class DrawRecorder {
+public:
+    static std::unique_ptr<DrawRecorder> open(gloo::Context &gl, const std::filesystem::path &path);
+
+    ~DrawRecorder();
+
+    NO_COPY(DrawRecorder)
+    NO_MOVE(DrawRecorder)
+
+    void add(BatchType type, bool trans, GLuint texture_id, std::span<const float> vertex_data);
+    void end_frame(const FrameUniforms &frame);
+
+    std::size_t frames() const;
+    std::size_t bytes_written() const;
+
+private:
+    gloo::Context &gl_;
+    std::filesystem::path path_;
+    std::ofstream out_;
+
+    std::unordered_set<GLuint> seen_textures_{};
+    std::size_t frames_{0};
+    std::size_t bytes_written_{0};
+
+    DrawRecorder(gloo::Context &gl, std::filesystem::path path, std::ofstream out);
+
+    template<typename T>
+    void write_(const T &v);
+    void write_bytes_(const void *data, std::size_t size);
+};
+
+struct DrawRecording {
+    struct Texture {
+        GLuint id;
+        glm::ivec2 size;
+    };
+
+    struct Add {
+        BatchType type;
+        bool trans;
+        GLuint texture_id;
+        std::size_t offset;
+        std::size_t count;
+    };
+
+    struct Frame {
+        FrameUniforms uniforms{};
+        std::vector<Add> adds{};
+        std::vector<float> vertices{};
+    };
+
+    std::vector<Texture> textures{};
+    std::vector<Frame> frames{};
+
+    static std::optional<DrawRecording> load(const std::filesystem::path &path);
+};
+} // namespace mizu
+
+#endif // MIZU_DRAW_RECORDER_HPP
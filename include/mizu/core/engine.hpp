@@ -1,8 +1,10 @@
 #ifndef MIZU_ENGINE_HPP
 #define MIZU_ENGINE_HPP
 
+#include <expected>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include "gloo/context.hpp"
 #include "mizu/core/application.hpp"
@@ -19,6 +21,15 @@
 #include "mizu/util/time.hpp"
 
 namespace mizu {
+struct HeadlessConfig {
+    // Size of the offscreen target everything is rendered into
+    glm::ivec2 resolution{1280, 720};
+    // Seconds passed to update callbacks each frame, nullopt uses the measured frame time
+    std::optional<double> fixed_dt{1.0 / 60.0};
+    // Shuts down after this many frames, nullopt runs until shutdown() is called
+    std::optional<std::size_t> max_frames{std::nullopt};
+};
+
 class Engine {
     using WindowBuildFunc = std::function<void(WindowBuilder &)>;
 
@@ -39,6 +50,11 @@ public:
     Engine(const std::string &window_title, glm::ivec2 window_size, WindowBuildFunc f);
     Engine(const std::string &window_title, WindowBuildFunc f);
 
+    // Creates a hidden window through SDL's offscreen video driver (EGL) and renders into an
+    // offscreen target, so it runs without a display. Fails instead of exiting the process.
+    static std::expected<std::unique_ptr<Engine>, std::string>
+    headless(const std::string &title, const HeadlessConfig &config = {});
+
     ~Engine();
 
     Engine(const Engine &) = delete;
@@ -52,6 +68,16 @@ public:
     bool show_fps() const;
     void set_show_fps(bool v);
 
+    bool is_headless() const;
+
+    std::optional<double> fixed_dt() const;
+    void set_fixed_dt(std::optional<double> dt);
+
+    void set_max_frames(std::optional<std::size_t> max_frames);
+
+    // Frames run by the current mainloop
+    std::size_t frame_count() const;
+
     template<typename T, typename... Args>
         requires std::derived_from<T, Application>
     void mainloop(Args &&...args);
@@ -59,8 +85,16 @@ public:
 private:
     bool running_;
     bool show_fps_;
+    bool headless_{false};
+    std::optional<double> fixed_dt_{std::nullopt};
+    std::optional<std::size_t> max_frames_{std::nullopt};
+    std::size_t frame_count_{0};
     std::size_t callback_id_{0};
 
+    Engine();
+
+    std::expected<void, std::string> init_(const std::string &window_title, glm::ivec2 window_size, WindowBuildFunc f);
+
     void poll_events_();
 
     void register_callbacks_();
@@ -71,10 +105,12 @@ template<typename T, typename... Args>
     requires std::derived_from<T, Application>
 void Engine::mainloop(Args &&...args) {
     auto application = T(this, std::forward<Args>(args)...);
+    running_ = true;
+    frame_count_ = 0;
 
     do {
         frame_counter.update();
-        const auto dt = as_secs_dt<decltype(frame_counter)>(frame_counter.dt());
+        const auto dt = fixed_dt_.value_or(as_secs_dt<decltype(frame_counter)>(frame_counter.dt()));
 
         callbacks.pub_nowait<PPreUpdate>(dt);
         callbacks.pub_nowait<PUpdate>(dt);
@@ -103,10 +139,17 @@ void Engine::mainloop(Args &&...args) {
         callbacks.pub_nowait<PPostDraw>();
         callbacks.pub_nowait<PDrawOverlay>();
 
+        // ImGui draws through its own GL loader behind the state cache's back
+        gl.invalidate_state();
+
         callbacks.pub_nowait<PPresent>();
 
         poll_events_();
         callbacks.poll<PEventQuit>(callback_id_);
+
+        ++frame_count_;
+        if (max_frames_ && frame_count_ >= *max_frames_)
+            running_ = false;
     } while (running_);
 }
 } // namespace mizu
@@ -1,56 +1,307 @@
 #ifndef MIZU_FONT_TTF_HPP
 #define MIZU_FONT_TTF_HPP
 
+#include <array>
 #include <filesystem>
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_MODULE_H
+#include <limits>
 #include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include "g2d.hpp"
 #include "mizu/util/class_helpers.hpp"
 #include "stb_rect_pack.h"
 #include "texture.hpp"
 
 namespace mizu {
+// Atlas pages start at ATLAS_SIZE and double in height up to ATLAS_MAX_HEIGHT
+// before another page is added. Once ATLAS_MAX_PAGES are full, the least recently
+// used page that hasn't been drawn from in ATLAS_EVICT_FRAMES frames is cleared.
 constexpr glm::ivec2 ATLAS_SIZE{512, 512};
+constexpr int ATLAS_MAX_HEIGHT{2048};
+constexpr std::size_t ATLAS_MAX_PAGES{4};
+constexpr std::uint64_t ATLAS_EVICT_FRAMES{120};
+
+// Used for px_size 0 with scalable faces, bitmap faces default to their first strike
+constexpr int DEFAULT_PX_SIZE{16};
+
+// Font::prewarm only adds another thread for every this many glyphs
+constexpr std::size_t PREWARM_GLYPHS_PER_WORKER{32};
+
+constexpr std::string_view PRINTABLE_ASCII{
+        " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~"};
+
+enum class FontMode {
+    // Glyphs are rasterized per pixel size
+    Bitmap,
+    // Glyphs are rasterized once at sdf_px_size as distance fields and scaled on draw.
+    // Only outline faces can do this, bitmap faces fall back to Bitmap.
+    Sdf,
+};
+
+struct FontDesc {
+    FontMode mode{FontMode::Bitmap};
+    int sdf_px_size{48};
+    // Pixels the field extends past the outline on either side, between 2 and 32
+    int sdf_spread{8};
+    // UTF-8, prewarmed at the default size when the font is loaded
+    std::string charset{};
+    // If set, the atlas and glyph metrics are loaded from here when the cached copy matches
+    // the font file and these options, and written back on destruction if glyphs were added
+    std::filesystem::path cache_dir{};
+};
+
+struct FontAtlasStats {
+    std::size_t pages{0};
+    std::size_t glyphs{0};
+    std::size_t used_texels{0};
+    std::size_t total_texels{0};
+    std::size_t grows{0};
+    std::size_t evictions{0};
+    // Glyphs that fit nowhere, they're retried the next time they're used
+    std::size_t dropped{0};
+
+    float occupancy() const;
+};
+
+// Maps codepoints to glyph slots. Latin-1 is a flat array, everything above
+// it lives in 256 entry pages allocated the first time one of their codepoints is set.
+class CodepointTable {
+public:
+    static constexpr std::uint32_t NO_SLOT = std::numeric_limits<std::uint32_t>::max();
+
+    CodepointTable();
+
+    std::uint32_t get(char32_t cp) const;
+    void set(char32_t cp, std::uint32_t slot);
+
+    // Calls fn(cp, slot) for every codepoint with a slot, in codepoint order
+    template<typename F>
+    void for_each(F &&fn) const;
+
+private:
+    using Page = std::array<std::uint32_t, 256>;
+    Page latin1_{};
+    std::vector<std::unique_ptr<Page>> pages_{};
+};
+
+inline std::uint32_t CodepointTable::get(char32_t cp) const {
+    if (cp < 256)
+        return latin1_[cp];
+
+    const auto page = cp >> 8;
+    if (page >= pages_.size() || !pages_[page])
+        return NO_SLOT;
+    return (*pages_[page])[cp & 0xff];
+}
+
+template<typename F>
+void CodepointTable::for_each(F &&fn) const {
+    for (std::size_t i = 0; i < latin1_.size(); ++i)
+        if (latin1_[i] != NO_SLOT)
+            fn(static_cast<char32_t>(i), latin1_[i]);
+
+    // Page 0 is Latin-1, it's never allocated
+    for (std::size_t page = 1; page < pages_.size(); ++page) {
+        if (!pages_[page])
+            continue;
+        for (std::size_t i = 0; i < pages_[page]->size(); ++i)
+            if ((*pages_[page])[i] != NO_SLOT)
+                fn(static_cast<char32_t>((page << 8) | i), (*pages_[page])[i]);
+    }
+}
+
+// Glyph quads relative to the top left of the text, regions are in atlas page pixels
+struct TextLayout {
+    struct Quad {
+        glm::vec2 pos;
+        glm::vec2 size;
+        glm::vec4 region;
+        std::uint32_t page;
+    };
+    std::vector<Quad> quads{};
+    glm::vec2 size{0.0f};
+    std::size_t lines{0};
+    // Font::atlas_generation() when laid out, the quads are stale once it changes
+    std::uint64_t generation{0};
+};
 
 class Font {
 public:
-    explicit Font(G2d &g2d, const std::filesystem::path &path);
+    explicit Font(G2d &g2d, const std::filesystem::path &path, const FontDesc &desc = {});
 
     ~Font();
 
     NO_COPY(Font)
     NO_MOVE(Font)
 
-    float pen_offset() const;
-    float line_height() const;
+    bool sdf() const;
+
+    // Every pixel size has its own glyph cache, all sizes share the face and the atlas pages.
+    // SDF fonts draw every size from the sdf_px_size cache. px_size 0 is the face's default size.
+    int default_px_size() const;
+
+    // 0 until something has been drawn or measured at that size
+    float pen_offset(int px_size = 0) const;
+    float line_height(int px_size = 0) const;
 
-    glm::vec2 calc_size(std::string_view text);
+    glm::vec2 calc_size(std::string_view text, int px_size = 0);
 
-    void draw(std::string_view text, glm::vec2 pos, const Color &color = rgb(0xffffff));
+    void draw(std::string_view text, glm::vec2 pos, const Color &color = rgb(0xffffff), int px_size = 0);
+
+    // Rasterizes every codepoint in the UTF-8 charset across worker threads, packs them
+    // together and uploads them right away, so drawing them later costs no FreeType work
+    void prewarm(std::string_view charset, int px_size = 0);
+
+    // Breaks lines on '\n' and, with a positive wrap_width, greedily at spaces.
+    // Words wider than wrap_width are broken between glyphs.
+    TextLayout layout(std::string_view text, float wrap_width = 0.0f, int px_size = 0);
+
+    // Where cp's glyph sits relative to the top left of a line, for renderers that place glyphs
+    // themselves. Empty for whitespace and glyphs that couldn't be loaded or packed.
+    std::optional<TextLayout::Quad> glyph_quad(char32_t cp, int px_size = 0);
+
+    std::size_t atlas_pages() const;
+    const Texture *atlas_page(std::uint32_t page) const;
+    // Bumped whenever a page grows or is evicted
+    std::uint64_t atlas_generation() const;
+    FontAtlasStats atlas_stats() const;
+
+    // For draws that reuse an old layout, keeps the page from being evicted while in use
+    void mark_page_used(std::uint32_t page);
+
+    // Writes the atlas pages and every size's glyphs to FontDesc::cache_dir
+    bool save_cache();
 
 private:
     G2d &g2d_;
-    float pen_offset_{0};
-    float line_height_{0};
+    FontDesc desc_;
 
     FT_Byte *face_data_{nullptr};
     std::size_t face_data_size_{0};
     FT_Face face_{nullptr};
+    int default_px_size_{DEFAULT_PX_SIZE};
+    // Size last set on the face, so switching between caches only resizes when needed
+    int face_px_size_{0};
+
+    // Hash of the face data and everything else that changes how glyphs are rasterized
+    std::uint64_t cache_key_{0};
+    // Set when glyphs are packed, cleared when the cache file matches the atlas again
+    bool cache_dirty_{false};
 
+    static constexpr std::uint32_t NO_PAGE = std::numeric_limits<std::uint32_t>::max();
+
+    // Glyphs with a size but NO_PAGE were evicted or dropped and are rasterized again on use
     struct GlyphInfo {
         std::uint32_t idx;
         glm::vec2 pos;
         glm::vec2 size;
         glm::vec2 offset;
         glm::vec2 advance;
+        std::uint32_t page{NO_PAGE};
+    };
+
+    // Codepoints that share a glyph (e.g. everything the face lacks) share a slot
+    struct GlyphCache {
+        int px_size{0};
+        float pen_offset{0};
+        float line_height{0};
+        CodepointTable codepoints{};
+        std::unordered_map<FT_UInt, std::uint32_t> slots_by_index{};
+        std::vector<GlyphInfo> glyphs{};
+    };
+
+    std::vector<GlyphCache> glyphs_{};
+
+    struct GlyphRef {
+        std::uint32_t cache;
+        std::uint32_t slot;
+    };
+
+    // Heap allocated since the packer context points into itself. Glyphs are
+    // written to a CPU copy of the page and the rect covering everything written
+    // since the last flush is uploaded once, right before the frame is drawn.
+    struct AtlasPage {
+        std::unique_ptr<Texture> texture{nullptr};
+        std::vector<unsigned char> pixels{};
+        glm::ivec4 dirty{0};
+        stbrp_context rp_ctx{};
+        std::vector<stbrp_node> rp_nodes{};
+        std::vector<GlyphRef> glyphs{};
+        std::size_t used_texels{0};
+        std::uint64_t last_used{0};
+    };
+    std::vector<std::unique_ptr<AtlasPage>> pages_{};
+    // Textures replaced by a grow, freed once the frame that may still sample them is drawn
+    std::vector<std::pair<std::uint64_t, std::unique_ptr<Texture>>> retired_textures_{};
+    std::uint64_t atlas_generation_{0};
+    FontAtlasStats stats_{};
+
+    // Glyphs rasterized but not packed yet, their pixels back to back
+    struct StagedGlyphs {
+        std::vector<GlyphInfo> glyphs{};
+        std::vector<std::uint32_t> slots{};
+        std::vector<std::size_t> offsets{};
+        std::vector<unsigned char> pixels{};
+
+        void clear();
+        void append(const StagedGlyphs &other);
     };
-    std::unique_ptr<Texture> atlas_{nullptr};
-    std::vector<std::unordered_map<std::uint32_t, GlyphInfo>> glyphs_{};
+    StagedGlyphs staging_{};
+
+    struct PrewarmItem {
+        char32_t cp;
+        FT_UInt glyph_idx;
+        std::uint32_t slot;
+    };
+    std::size_t pre_flush_hook_id_{0};
+
+    // Quads for the page draw() is currently on, SDF glyphs can't go through G2d::texture
+    std::vector<float> sdf_vertices_{};
+
+    // How much glyphs from the cache px_size maps to are scaled when drawn
+    float scale_(int px_size) const;
+    int cache_px_size_(int px_size) const;
+    std::uint32_t cache_for_(int px_size);
+    const GlyphCache *find_cache_(int px_size) const;
+    bool set_face_size_(int px_size);
+    static bool size_face_(FT_Face face, int px_size);
+
+    void check_populate_atlas_(std::string_view text, std::uint32_t cache_idx);
+
+    // The slot cp maps to if its glyph still has to be rasterized
+    std::optional<std::uint32_t> queue_glyph_(char32_t cp, GlyphCache &cache);
+    void init_cache_metrics_(GlyphCache &cache, const GlyphInfo *glyph) const;
+    void set_sdf_spread_(FT_Library library) const;
+
+    // Only touch face and out, so workers can run these with their own face
+    bool rasterize_(FT_Face face, char32_t cp, FT_UInt glyph_idx, std::uint32_t slot, StagedGlyphs &out) const;
+    void rasterize_items_(FT_Face face, std::span<const PrewarmItem> items, StagedGlyphs &out) const;
+    bool rasterize_on_worker_(int px_size, std::span<const PrewarmItem> items, StagedGlyphs &out) const;
+
+    void pack_staged_(std::uint32_t cache_idx);
+    std::size_t pack_into_page_(std::uint32_t page, std::vector<stbrp_rect> &pending, std::uint32_t cache_idx);
+    std::optional<std::uint32_t> make_room_();
+    gloo::TextureDesc page_texture_desc_() const;
+    void add_page_();
+    void grow_page_(AtlasPage &page);
+    std::optional<std::uint32_t> evict_page_();
+
+    std::filesystem::path cache_path_() const;
+    bool load_cache_();
+    void restore_skyline_(AtlasPage &page) const;
+
+    static void write_to_page_(AtlasPage &page, glm::ivec2 pos, glm::ivec2 size, const unsigned char *bytes);
+    static void flush_page_(AtlasPage &page);
+    void flush_uploads_();
 
-    stbrp_context rp_ctx_;
-    stbrp_node *rp_nodes_{nullptr};
-    void check_populate_atlas_(std::string_view text, int pt_size);
+    const GlyphInfo *glyph_(char32_t cp, std::uint32_t cache_idx) const;
 
     static std::once_flag initialized_ft_;
     static FT_Library ft_library_;
@@ -0,0 +1,91 @@
+#ifndef MIZU_FRAME_CAPTURE_HPP
+#define MIZU_FRAME_CAPTURE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <glm/vec2.hpp>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "gloo/context.hpp"
+#include "mizu/util/class_helpers.hpp"
+
+namespace mizu {
+// Reads finished frames into a ring of pixel pack buffers and only maps them
+// once their fence has signaled, encoding happens on a worker thread. Nothing
+// here waits on the GPU during normal operation.
+class FrameCapture {
+public:
+    explicit FrameCapture(gloo::Context &gl, std::size_t ring_size = 3);
+
+    ~FrameCapture();
+
+    NO_COPY(FrameCapture)
+    NO_MOVE(FrameCapture)
+
+    // Writes the next finished frame to a PNG
+    void capture(const std::filesystem::path &path);
+
+    // Appends every frame to a Y4M sequence until stopped. Frames are dropped rather than
+    // stalling if every ring slot is still in flight.
+    void start_recording(const std::filesystem::path &path, int fps = 60);
+    void stop_recording();
+    bool recording() const;
+
+    std::size_t dropped_frames() const;
+
+    // Called once the frame is finished with the framebuffer holding it bound for reading
+    void end_frame(glm::ivec2 size);
+
+    // Blocks until every queued capture has been read back and written
+    void flush();
+
+private:
+    gloo::Context &gl_;
+
+    enum class JobKind { Png, Frame, CloseRecording };
+
+    struct Job {
+        JobKind kind;
+        std::filesystem::path path;
+        glm::ivec2 size{0};
+        int fps{0};
+        std::vector<unsigned char> pixels{};
+    };
+
+    struct Slot {
+        GLuint pbo{0};
+        std::size_t capacity{0};
+        GLsync fence{nullptr};
+        std::uint64_t seq{0};
+        std::optional<Job> job{std::nullopt};
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t next_slot_{0};
+    std::uint64_t next_seq_{0};
+
+    std::deque<std::filesystem::path> requests_{};
+    std::optional<std::filesystem::path> recording_path_{std::nullopt};
+    int recording_fps_{60};
+    std::size_t dropped_frames_{0};
+
+    std::mutex jobs_mutex_{};
+    std::condition_variable_any jobs_cv_{};
+    std::condition_variable_any idle_cv_{};
+    std::deque<Job> jobs_{};
+    bool worker_busy_{false};
+    std::jthread worker_;
+
+    Slot *free_slot_();
+    void read_into_(Slot &slot, glm::ivec2 size, Job job);
+    void collect_(bool wait);
+
+    void push_job_(Job job);
+    void worker_loop_(std::stop_token stop);
+};
+} // namespace mizu
+
+#endif // MIZU_FRAME_CAPTURE_HPP
@@ -1,22 +1,45 @@
 #ifndef MIZU_G2D_HPP
 #define MIZU_G2D_HPP
 
+#include <chrono>
+#include <functional>
 #include <glm/vec2.hpp>
 #include "gloo/context.hpp"
+#include "gloo/framebuffer.hpp"
 #include "gloo/texture.hpp"
 #include "mizu/core/batcher.hpp"
 #include "mizu/core/callback_mgr.hpp"
 #include "mizu/core/color.hpp"
+#include "mizu/core/draw_recorder.hpp"
+#include "mizu/core/frame_capture.hpp"
+#include "mizu/core/particles.hpp"
 #include "mizu/core/texture.hpp"
 #include "mizu/core/window.hpp"
 #include "mizu/util/class_helpers.hpp"
 #include "mizu/util/enum_class_helpers.hpp"
 #include "mizu/util/shapes.hpp"
+#include "mizu/util/time.hpp"
 
 namespace mizu {
+// text_grid.hpp includes font.hpp, which needs G2d
+class TextGrid;
+
+struct DynamicResolution {
+    // Frame time to stay under. FrameCounter measures whole frames, so with vsync
+    // on this should sit a little above the refresh interval or it never scales up.
+    double budget_ms{1000.0 / 60.0};
+    float min_scale{0.5f};
+    float max_scale{1.0f};
+    // How far the scale moves per adjustment, and the frames to wait between them
+    float step{0.05f};
+    std::size_t settle_frames{30};
+    // Nearest keeps pixel art crisp, linear looks better for everything else
+    gloo::BlitFilter filter{gloo::BlitFilter::Linear};
+};
+
 class G2d {
 public:
-    G2d(CallbackMgr &callbacks, gloo::Context &gl, Window *window);
+    G2d(CallbackMgr &callbacks, gloo::Context &gl, Window *window, const FrameCounter<> &frame_counter);
 
     ~G2d();
 
@@ -33,9 +56,50 @@ public:
             gloo::MinFilter min_filter = gloo::MinFilter::Nearest,
             gloo::MagFilter mag_filter = gloo::MagFilter::Linear) const;
 
+    std::unique_ptr<Texture> load_texture(const std::filesystem::path &path, const gloo::TextureDesc &desc) const;
+    std::unique_ptr<Texture> create_texture(glm::ivec2 size, const gloo::TextureDesc &desc) const;
+
     bool vsync() const;
     void set_vsync(bool enabled);
 
+    // Renders into an offscreen target of a fixed size instead of the window. If present
+    // is set the target is scaled onto the window after drawing, otherwise it's never shown.
+    void use_offscreen_target(glm::ivec2 size, bool present = true);
+    void use_window_target();
+
+    // Returns nullptr when drawing straight to the window
+    const gloo::Framebuffer *render_target() const;
+    // Pixels actually rendered this frame, smaller than logical_size() while scaled
+    glm::ivec2 render_size() const;
+    // The coordinate space everything is drawn in
+    glm::ivec2 logical_size() const;
+
+    // Frames drawn so far, anything submitted now is drawn as part of this frame
+    std::uint64_t frame() const;
+
+    // Renders window frames into a target whose scale adapts to keep frame time
+    // within budget, then upscales onto the window. Ignored while an offscreen
+    // target is in use.
+    void enable_dynamic_resolution(const DynamicResolution &config = {});
+    void disable_dynamic_resolution();
+
+    // Holds the scale fixed, whether or not dynamic resolution is enabled
+    void pin_resolution_scale(float scale, gloo::BlitFilter filter = gloo::BlitFilter::Linear);
+    void unpin_resolution_scale();
+
+    float resolution_scale() const;
+
+    // Captures what G2d drew this frame, overlays like ImGui aren't included
+    void capture(const std::filesystem::path &path);
+    void start_recording(const std::filesystem::path &path, int fps = 60);
+    void stop_recording();
+
+    FrameCapture &frame_capture();
+
+    // Serializes every primitive G2d batches until stopped, see DrawRecorder
+    bool record_draws(const std::filesystem::path &path);
+    void stop_recording_draws();
+
     void clear(const Color &color, gloo::ClearBit mask = gloo::ClearBit::Color | gloo::ClearBit::Depth);
 
     void point(glm::vec2 pos, const Color &color);
@@ -76,11 +140,49 @@ public:
     void texture(const Texture &t, glm::vec2 pos, glm::vec3 rot, const Color &color = rgb(0xffffff));
     void texture(const Texture &t, glm::vec2 pos, glm::vec2 size, glm::vec3 rot, const Color &color = rgb(0xffffff));
 
+    // Submits prebuilt unrotated textured vertices, 9 floats each (x y z, r g b a, s t)
+    // and 6 per quad. The z of every vertex is overwritten with the current depth.
+    // With sdf the texture's alpha is read as a distance field with the edge at 0.5.
+    void texture_vertices(const Texture &t, std::span<float> vertex_data, bool sdf = false);
+
+    // Draws every emitter in the system at the current depth, in one instanced call each
+    void particles(ParticleSystem &system);
+
+    // Draws the grid at the current depth in one call, pos is its top left corner
+    void text_grid(TextGrid &grid, glm::vec2 pos);
+
+    // Run right before each frame's batches are drawn, for uploads deferred until then
+    std::size_t add_pre_flush_hook(std::function<void()> fn);
+    void remove_pre_flush_hook(std::size_t id);
+
+    // Restricts drawing to a rect in logical coordinates until the matching pop_clip(),
+    // nested clips are intersected with the enclosing one
+    void push_clip(glm::vec2 pos, glm::vec2 size);
+    void pop_clip();
+
 private:
     gloo::Context &gl_;
     Window *window_;
 
     Batcher batcher_;
+    std::unique_ptr<gloo::Framebuffer> target_{nullptr};
+    bool present_target_{true};
+
+    const FrameCounter<> &frame_counter_;
+    std::optional<DynamicResolution> dynres_{std::nullopt};
+    std::optional<float> pinned_scale_{std::nullopt};
+    float scale_{1.0f};
+    gloo::BlitFilter scale_filter_{gloo::BlitFilter::Linear};
+    EMA frame_ms_{0.1};
+    std::size_t frames_until_adjust_{0};
+    // Allocated at window size * max scale, lower scales render into a corner of it
+    std::unique_ptr<gloo::Framebuffer> scaled_target_{nullptr};
+    std::unique_ptr<FrameCapture> capture_{nullptr};
+    std::unique_ptr<DrawRecorder> draw_recorder_{nullptr};
+    std::chrono::steady_clock::time_point start_time_;
+    std::uint64_t frame_{0};
+    std::vector<std::pair<std::size_t, std::function<void()>>> pre_flush_hooks_{};
+    std::size_t next_pre_flush_hook_id_{1};
 
     std::size_t callback_id_{0};
     CallbackMgr &callbacks_;
@@ -88,6 +190,11 @@ private:
     void register_callbacks_();
     void unregister_callbacks_();
 
+    bool scaling_() const;
+    // The framebuffer pre_draw_ binds, nullptr for the window
+    gloo::Framebuffer *active_target_();
+    void update_resolution_scale_();
+
     void pre_draw_();
     void post_draw_();
 };
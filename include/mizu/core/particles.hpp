@@ -0,0 +1,148 @@
+#ifndef MIZU_PARTICLES_HPP
+#define MIZU_PARTICLES_HPP
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <memory>
+#include <vector>
+#include "gloo/buffer.hpp"
+#include "gloo/compute.hpp"
+#include "gloo/context.hpp"
+#include "gloo/shader.hpp"
+#include "gloo/vertex_array.hpp"
+#include "mizu/core/color.hpp"
+#include "mizu/core/texture.hpp"
+#include "mizu/util/class_helpers.hpp"
+
+namespace mizu {
+struct EmitterDesc {
+    // Live particles are kept in a ring, spawning past this recycles the oldest
+    std::size_t capacity{4096};
+    // Particles per second, 0 only spawns through burst()
+    float rate{0.0f};
+
+    // Ranges are (min, max), picked uniformly per particle
+    glm::vec2 lifetime{1.0f, 1.0f};
+    glm::vec2 speed{50.0f, 100.0f};
+    // Degrees, particles leave within spread / 2 of direction
+    float direction{0.0f};
+    float spread{360.0f};
+
+    glm::vec2 gravity{0.0f};
+    // Fraction of velocity lost per second
+    float drag{0.0f};
+
+    // Size and color are interpolated from start to end over each particle's life
+    glm::vec2 size{8.0f, 0.0f};
+    Rgba color_start{rgb(0xffffff)};
+    Rgba color_end{rgba(0xffffff00)};
+
+    // nullptr draws untextured quads. An empty region uses the whole texture.
+    const Texture *texture{nullptr};
+    glm::vec4 region{0.0f};
+};
+
+class ParticleEmitter {
+    friend class ParticleSystem;
+
+public:
+    EmitterDesc desc;
+    glm::vec2 pos;
+
+    NO_COPY(ParticleEmitter)
+    NO_MOVE(ParticleEmitter)
+
+    void burst(std::size_t count);
+
+    bool active() const;
+
+private:
+    // SoA state, all vec2 so each array is directly usable as an instanced attribute.
+    // life is (age, lifetime), a particle is dead once age reaches lifetime.
+    gloo::StorageBuffer<glm::vec2> pos_buf_;
+    gloo::StorageBuffer<glm::vec2> vel_buf_;
+    gloo::StorageBuffer<glm::vec2> life_buf_;
+    std::unique_ptr<gloo::VertexArray> vao_;
+
+    // Mirror of the buffers, only kept when simulating on the CPU
+    std::vector<glm::vec2> cpu_pos_{};
+    std::vector<glm::vec2> cpu_vel_{};
+    std::vector<glm::vec2> cpu_life_{};
+
+    std::size_t head_{0};
+    float spawn_acc_{0.0f};
+    std::size_t pending_burst_{0};
+    // Upper bound on how long anything spawned can still be alive
+    float alive_for_{0.0f};
+
+    ParticleEmitter(gloo::Context &gl, gloo::Shader *shader, const EmitterDesc &desc, glm::vec2 pos, bool cpu);
+};
+
+// Simulates emitters in a compute shader when the context has one and on the
+// CPU otherwise, and draws each emitter as one instanced call. Draw through
+// G2d::particles so they're depth sorted with everything else.
+class ParticleSystem {
+public:
+    explicit ParticleSystem(gloo::Context &gl);
+
+    ~ParticleSystem();
+
+    NO_COPY(ParticleSystem)
+    NO_MOVE(ParticleSystem)
+
+    ParticleEmitter *add_emitter(const EmitterDesc &desc, glm::vec2 pos);
+    void remove_emitter(ParticleEmitter *emitter);
+
+    bool gpu_simulation() const;
+
+    void update(double dt);
+
+    void draw(float z);
+
+private:
+    gloo::Context &gl_;
+
+    std::unique_ptr<gloo::ComputePipeline> simulate_;
+    gloo::ShaderPermutations shaders_;
+    gloo::Shader *tex_shader_{nullptr};
+    gloo::Shader *flat_shader_{nullptr};
+
+    // Resolved when the shaders are created so the per emitter work only sets them
+    struct DrawUniforms {
+        gloo::UniformHandle<float> z{};
+        gloo::UniformHandle<glm::vec2> size_range{};
+        gloo::UniformHandle<glm::vec4> color_start{};
+        gloo::UniformHandle<glm::vec4> color_end{};
+        gloo::UniformHandle<glm::vec4> tex_region{};
+    };
+    DrawUniforms tex_uniforms_{};
+    DrawUniforms flat_uniforms_{};
+
+    struct SimulateUniforms {
+        gloo::UniformHandle<unsigned int> count{};
+        gloo::UniformHandle<float> dt{};
+        gloo::UniformHandle<glm::vec2> gravity{};
+        gloo::UniformHandle<float> drag{};
+    };
+    SimulateUniforms simulate_uniforms_{};
+
+    std::vector<std::unique_ptr<ParticleEmitter>> emitters_{};
+
+    struct SpawnScratch {
+        std::vector<glm::vec2> pos{};
+        std::vector<glm::vec2> vel{};
+        std::vector<glm::vec2> life{};
+    };
+    SpawnScratch scratch_{};
+
+    static DrawUniforms draw_uniforms_(gloo::Shader &shader);
+
+    void spawn_(ParticleEmitter &e, std::size_t count);
+    void write_spawned_(ParticleEmitter &e, std::size_t first, std::size_t offset, std::size_t count);
+
+    void simulate_gpu_(ParticleEmitter &e, float dt);
+    static void simulate_cpu_(ParticleEmitter &e, float dt);
+};
+} // namespace mizu
+
+#endif // MIZU_PARTICLES_HPP
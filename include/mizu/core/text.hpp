@@ -0,0 +1,65 @@
+#ifndef MIZU_TEXT_HPP
+#define MIZU_TEXT_HPP
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <string>
+#include <vector>
+#include "mizu/core/color.hpp"
+#include "mizu/core/font.hpp"
+#include "mizu/core/g2d.hpp"
+
+namespace mizu {
+// Retained text. The layout is only rebuilt when the string, font, size or wrap width
+// change or the font's atlas moves glyphs around, and the quads from the last draw
+// are reused as long as the position and color stay the same, so redrawing
+// unchanged text only restamps depth.
+class Text {
+public:
+    explicit Text(Font &font, std::string str = "", float wrap_width = 0.0f, int px_size = 0);
+
+    Font &font() const;
+    void set_font(Font &font);
+
+    const std::string &str() const;
+    void set_str(std::string_view str);
+
+    // 0 disables wrapping
+    float wrap_width() const;
+    void set_wrap_width(float wrap_width);
+
+    // 0 uses the font's default size
+    int px_size() const;
+    void set_px_size(int px_size);
+
+    glm::vec2 size();
+    std::size_t lines();
+
+    // pos is the top left of the text
+    void draw(G2d &g2d, glm::vec2 pos, const Color &color = rgb(0xffffff));
+
+private:
+    Font *font_;
+    std::string str_;
+    float wrap_width_;
+    int px_size_;
+
+    bool layout_dirty_{true};
+    TextLayout layout_{};
+
+    bool vertices_dirty_{true};
+    glm::vec2 vertices_pos_{0.0f};
+    glm::vec4 vertices_color_{0.0f};
+    // One run of vertices per atlas page the text uses
+    struct PageVertices {
+        std::uint32_t page;
+        std::vector<float> data;
+    };
+    std::vector<PageVertices> vertices_{};
+
+    const TextLayout &layout_if_dirty_();
+    void build_vertices_(glm::vec2 pos, glm::vec4 color);
+};
+} // namespace mizu
+
+#endif // MIZU_TEXT_HPP
@@ -0,0 +1,120 @@
+#ifndef MIZU_TEXT_GRID_HPP
+#define MIZU_TEXT_GRID_HPP
+
+#include <array>
+#include <cstdint>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "gloo/buffer.hpp"
+#include "gloo/context.hpp"
+#include "gloo/shader.hpp"
+#include "gloo/vertex_array.hpp"
+#include "mizu/core/color.hpp"
+#include "mizu/core/font.hpp"
+#include "mizu/core/texture.hpp"
+#include "mizu/util/class_helpers.hpp"
+
+namespace mizu {
+// Distinct glyphs one grid can show at once, so the palette block stays within
+// the 16KB of uniform block storage every context guarantees
+constexpr std::size_t TEXT_GRID_MAX_GLYPHS{512};
+constexpr GLuint TEXT_GRID_GLYPHS_BINDING = 1;
+
+struct TextGridCell {
+    char32_t cp{' '};
+    Rgba fg{rgb(0xffffff)};
+    Rgba bg{rgba(0x00000000)};
+};
+
+// A cols x rows buffer of cells for monospace fonts, drawn in one call. Cells are
+// mirrored into a texture that only has its changed rows uploaded, and the fragment
+// shader finds each cell's glyph in the font's atlas. Glyphs are fetched texel for
+// texel and only scaled by whole multiples, so SDF fonts aren't supported.
+// Draw through G2d::text_grid so it's depth sorted with everything else.
+class TextGrid {
+public:
+    TextGrid(gloo::Context &gl, Font &font, glm::ivec2 dims, int px_size = 0, int scale = 1);
+
+    ~TextGrid();
+
+    NO_COPY(TextGrid)
+    NO_MOVE(TextGrid)
+
+    glm::ivec2 dims() const;
+    // In pixels with the scale applied
+    glm::vec2 cell_size() const;
+    glm::vec2 size() const;
+
+    // Out of range reads get a blank cell, out of range writes are dropped
+    const TextGridCell &cell(glm::ivec2 pos) const;
+    void set(glm::ivec2 pos, const TextGridCell &cell);
+
+    // Writes UTF-8 text from pos, '\n' moves down a row back to pos.x and anything
+    // past the right edge is clipped. Returns where the next character would go.
+    glm::ivec2 print(
+            glm::ivec2 pos, std::string_view text, const Rgba &fg = rgb(0xffffff), const Rgba &bg = rgba(0x00000000));
+
+    void fill(const TextGridCell &cell);
+    // Moves every row up, the rows left at the bottom are filled with blank
+    void scroll(int rows, const TextGridCell &blank = {});
+
+    // Resolves new glyphs against the atlas, G2d::text_grid calls this when the grid is submitted
+    void prepare();
+    // Called from the draw G2d::text_grid defers until the batches are drawn
+    void draw(glm::vec2 pos, float z);
+
+private:
+    gloo::Context &gl_;
+    Font &font_;
+    glm::ivec2 dims_;
+    int px_size_;
+    int scale_;
+    glm::ivec2 cell_px_{0};
+
+    std::vector<TextGridCell> cells_{};
+    // Texture mirror, 3 texels per cell: glyph index (low, high byte), fg, bg
+    std::vector<unsigned char> cell_bytes_{};
+    std::unique_ptr<Texture> cell_tex_{nullptr};
+    // [first, last) rows changed since the last upload
+    glm::ivec2 dirty_rows_{0};
+
+    // Glyph index 0 draws nothing, it's used for whitespace and glyphs that didn't fit
+    std::unordered_map<char32_t, std::uint16_t> palette_{};
+    std::vector<char32_t> palette_cps_{0};
+    bool palette_dirty_{false};
+    bool palette_full_warned_{false};
+    std::uint64_t palette_generation_{0};
+    std::uint32_t pages_used_{0};
+
+    // Regions are (x, y, w, h) in atlas pixels, placements are the offset into the cell and the page
+    struct GlyphUniforms {
+        std::array<glm::vec4, TEXT_GRID_MAX_GLYPHS> region{};
+        std::array<glm::vec4, TEXT_GRID_MAX_GLYPHS> placement{};
+    };
+    std::unique_ptr<GlyphUniforms> glyphs_;
+    gloo::UniformBuffer<GlyphUniforms> glyph_ubo_;
+    bool glyphs_changed_{false};
+
+    gloo::ShaderPermutations shaders_;
+    gloo::Shader *shader_{nullptr};
+    gloo::UniformHandle<float> z_uniform_{};
+    gloo::UniformHandle<glm::vec2> origin_uniform_{};
+    gloo::UniformHandle<glm::vec2> size_uniform_{};
+    gloo::UniformHandle<glm::ivec2> cell_size_uniform_{};
+    gloo::UniformHandle<int> scale_uniform_{};
+    std::unique_ptr<gloo::VertexArray> vao_;
+
+    std::uint16_t glyph_index_(char32_t cp);
+    void compact_palette_();
+    void resolve_palette_();
+
+    void write_cell_(std::size_t i, std::uint16_t glyph);
+    void mark_rows_(int first, int last);
+};
+} // namespace mizu
+
+#endif // MIZU_TEXT_GRID_HPP
@@ -9,12 +9,9 @@
 namespace mizu {
 class Texture {
 public:
-    Texture(gloo::Context &gl,
-            const std::filesystem::path &path,
-            gloo::MinFilter min_filter,
-            gloo::MagFilter mag_filter);
+    Texture(gloo::Context &gl, const std::filesystem::path &path, const gloo::TextureDesc &desc);
 
-    Texture(gloo::Context &gl, glm::ivec2 size, gloo::MinFilter min_filter, gloo::MagFilter mag_filter);
+    Texture(gloo::Context &gl, glm::ivec2 size, const gloo::TextureDesc &desc);
 
     ~Texture() = default;
 
@@ -24,6 +21,7 @@ public:
     MOVE_ASSIGN_OP(Texture);
 
     GLuint id() const;
+    gloo::InternalFormat format() const;
 
     float width() const;
     float height() const;
@@ -31,12 +29,13 @@ public:
     float s(float x) const;
     float t(float y) const;
 
-    void write_subimage(glm::ivec2 pos, glm::ivec2 size, const unsigned char *bytes);
+    void write_subimage(glm::ivec2 pos, glm::ivec2 size, const unsigned char *bytes, GLint row_length = 0);
+    void copy_subimage_from(const Texture &src, glm::ivec2 src_pos, glm::ivec2 dst_pos, glm::ivec2 size);
 
 private:
     gloo::Context &gl_;
 
-    PngData data_;
+    glm::ivec2 size_;
     float px_x_;
     float px_y_;
 
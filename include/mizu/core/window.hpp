@@ -45,7 +45,7 @@ private:
     SDL_Window *sdl_window_;
     SDL_GLContext gl_context_;
 
-    explicit Window(SDL_Window *sdl_window, CallbackMgr &callbacks);
+    Window(SDL_Window *sdl_window, SDL_GLContext gl_context, CallbackMgr &callbacks);
 
     void register_callbacks_();
     void unregister_callbacks_();
@@ -3,6 +3,7 @@
 
 #include <string>
 #include "mizu/core/font.hpp"
+#include "mizu/core/text.hpp"
 #include "mizu/gui/node.hpp"
 
 namespace mizu::gui {
@@ -45,7 +46,11 @@ private:
     bool primed_{false};
     bool hovered_{false};
 
+    // Laid out once and redrawn from cache, picks up changes to font and text lazily
+    mutable Text label_;
+
     float border_size_() const;
+    Text &label_synced_() const;
 };
 } // namespace mizu::gui
 
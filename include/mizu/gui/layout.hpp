@@ -10,6 +10,8 @@ struct VStackParams {
     std::optional<Border> border{std::nullopt};
     Padding outer_pad{0.0f};
     float inner_pad{0.0f};
+    // Clip children to the area inside the border
+    bool clip{false};
 };
 
 class VStack final : public Node<VStackParams> {
@@ -17,6 +19,7 @@ public:
     std::optional<Border> border;
     Padding outer_pad;
     float inner_pad;
+    bool clip;
 
     explicit VStack(const VStackParams &params);
 
@@ -29,6 +32,7 @@ public:
     void draw(G2d &g2d) const override;
 
 private:
+    void draw_children_(G2d &g2d) const;
     float border_size_() const;
 };
 
@@ -37,6 +41,8 @@ struct HStackParams {
     std::optional<Border> border{std::nullopt};
     Padding outer_pad{0.0f};
     float inner_pad{0.0f};
+    // Clip children to the area inside the border
+    bool clip{false};
 };
 
 class HStack final : public Node<HStackParams> {
@@ -44,6 +50,7 @@ public:
     std::optional<Border> border;
     Padding outer_pad;
     float inner_pad;
+    bool clip;
 
     explicit HStack(const HStackParams &params);
 
@@ -56,6 +63,7 @@ public:
     void draw(G2d &g2d) const override;
 
 private:
+    void draw_children_(G2d &g2d) const;
     float border_size_() const;
 };
 
@@ -3,13 +3,17 @@
 
 #include "mizu/core/application.hpp"
 #include "mizu/core/callback_mgr.hpp"
+#include "mizu/core/code_page_437.hpp"
 #include "mizu/core/color.hpp"
 #include "mizu/core/engine.hpp"
 #include "mizu/core/font.hpp"
 #include "mizu/core/g2d.hpp"
 #include "mizu/core/input_mgr.hpp"
 #include "mizu/core/log.hpp"
+#include "mizu/core/particles.hpp"
 #include "mizu/core/payloads.hpp"
+#include "mizu/core/text.hpp"
+#include "mizu/core/text_grid.hpp"
 #include "mizu/core/window.hpp"
 
 #include "mizu/gui/control.hpp"
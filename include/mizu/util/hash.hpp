@@ -0,0 +1,22 @@
+#ifndef MIZU_HASH_HPP
+#define MIZU_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mizu {
+constexpr std::uint64_t FNV_OFFSET_BASIS = 0xcbf2'9ce4'8422'2325;
+constexpr std::uint64_t FNV_PRIME = 0x0000'0100'0000'01b3;
+
+// 64-bit FNV-1a, chain calls by passing the previous result as hash
+inline std::uint64_t fnv1a(std::uint64_t hash, const void *data, std::size_t size) {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+} // namespace mizu
+
+#endif // MIZU_HASH_HPP
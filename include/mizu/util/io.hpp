@@ -2,11 +2,13 @@
 #define MIZU_IO_HPP
 
 #include <SDL3/SDL_surface.h>
+#include <cstdio>
 #include <filesystem>
 #include <optional>
 #include <png.h>
 #include <pngconf.h>
 #include <string>
+#include <vector>
 #include "mizu/util/class_helpers.hpp"
 
 namespace mizu {
@@ -42,6 +44,40 @@ std::optional<PngData> read_image_data(const std::filesystem::path &path);
 SDL_Surface *read_image_to_sdl_surface(const std::filesystem::path &path);
 
 std::optional<std::string> read_file(const std::filesystem::path &path);
+
+// bytes are 8-bit RGBA rows, flip_y writes them bottom row first (GL readback order)
+bool write_png(
+        const std::filesystem::path &path,
+        const unsigned char *bytes,
+        png_uint_32 width,
+        png_uint_32 height,
+        bool flip_y = false);
+
+// Raw YUV4MPEG2 (4:4:4) frame sequence, readable by ffmpeg/ffplay
+class Y4mWriter {
+public:
+    Y4mWriter() = default;
+    ~Y4mWriter();
+
+    NO_COPY(Y4mWriter)
+    NO_MOVE(Y4mWriter)
+
+    bool open(const std::filesystem::path &path, png_uint_32 width, png_uint_32 height, int fps);
+    void close();
+
+    bool is_open() const;
+    const std::filesystem::path &path() const;
+
+    // Same layout as write_png, frames must match the size given to open()
+    bool write_frame(const unsigned char *rgba, bool flip_y = false);
+
+private:
+    FILE *fp_{nullptr};
+    std::filesystem::path path_{};
+    png_uint_32 width_{0};
+    png_uint_32 height_{0};
+    std::vector<unsigned char> planes_{};
+};
 } // namespace mizu
 
 #endif // MIZU_IO_HPP
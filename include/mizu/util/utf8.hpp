@@ -0,0 +1,158 @@
+#ifndef MIZU_UTF8_HPP
+#define MIZU_UTF8_HPP
+
+#include <cstddef>
+#include <string_view>
+
+namespace mizu {
+constexpr char32_t REPLACEMENT_CHARACTER = 0xfffd;
+
+// Decodes the codepoint starting at text[pos] and moves pos past it. Truncated
+// or malformed sequences, overlong encodings and surrogates decode to U+FFFD
+// and only skip their first byte, so decoding resyncs on the next lead byte.
+constexpr char32_t utf8_next(std::string_view text, std::size_t &pos) {
+    const auto b0 = static_cast<unsigned char>(text[pos]);
+    if (b0 < 0x80) {
+        ++pos;
+        return b0;
+    }
+
+    std::size_t len;
+    char32_t cp;
+    char32_t min;
+    if ((b0 & 0xe0) == 0xc0) {
+        len = 2, cp = b0 & 0x1f, min = 0x80;
+    } else if ((b0 & 0xf0) == 0xe0) {
+        len = 3, cp = b0 & 0x0f, min = 0x800;
+    } else if ((b0 & 0xf8) == 0xf0) {
+        len = 4, cp = b0 & 0x07, min = 0x10000;
+    } else {
+        ++pos;
+        return REPLACEMENT_CHARACTER;
+    }
+
+    if (pos + len > text.size()) {
+        ++pos;
+        return REPLACEMENT_CHARACTER;
+    }
+
+    for (std::size_t i = 1; i < len; ++i) {
+        const auto b = static_cast<unsigned char>(text[pos + i]);
+        if ((b & 0xc0) != 0x80) {
+            ++pos;
+            return REPLACEMENT_CHARACTER;
+        }
+        cp = (cp << 6) | (b & 0x3f);
+    }
+
+    if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) {
+        ++pos;
+        return REPLACEMENT_CHARACTER;
+    }
+
+    pos += len;
+    return cp;
+}
+
+// Encodes cp into out and returns how many bytes were written, surrogates and
+// anything past U+10FFFF encode as U+FFFD
+constexpr std::size_t utf8_encode(char32_t cp, char (&out)[4]) {
+    if (cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff))
+        cp = REPLACEMENT_CHARACTER;
+
+    if (cp < 0x80) {
+        out[0] = static_cast<char>(cp);
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = static_cast<char>(0xc0 | (cp >> 6));
+        out[1] = static_cast<char>(0x80 | (cp & 0x3f));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = static_cast<char>(0xe0 | (cp >> 12));
+        out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out[2] = static_cast<char>(0x80 | (cp & 0x3f));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xf0 | (cp >> 18));
+    out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+    out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+    out[3] = static_cast<char>(0x80 | (cp & 0x3f));
+    return 4;
+}
+
+// Iterates the codepoints of UTF-8 text, for (char32_t cp: Utf8View(text))
+class Utf8View {
+public:
+    struct Sentinel {};
+
+    class Iterator {
+    public:
+        using value_type = char32_t;
+        using difference_type = std::ptrdiff_t;
+
+        constexpr Iterator() = default;
+
+        constexpr explicit Iterator(std::string_view text)
+            : text_(text) {
+            advance_();
+        }
+
+        constexpr char32_t operator*() const {
+            return cp_;
+        }
+
+        // Byte offset of the current codepoint in the text
+        constexpr std::size_t offset() const {
+            return start_;
+        }
+
+        constexpr Iterator &operator++() {
+            advance_();
+            return *this;
+        }
+
+        constexpr void operator++(int) {
+            advance_();
+        }
+
+        constexpr bool operator==(Sentinel) const {
+            return done_;
+        }
+
+    private:
+        std::string_view text_{};
+        std::size_t start_{0};
+        std::size_t pos_{0};
+        char32_t cp_{0};
+        bool done_{false};
+
+        constexpr void advance_() {
+            if (pos_ >= text_.size()) {
+                start_ = text_.size();
+                done_ = true;
+                return;
+            }
+            start_ = pos_;
+            cp_ = utf8_next(text_, pos_);
+        }
+    };
+
+    constexpr explicit Utf8View(std::string_view text)
+        : text_(text) {}
+
+    constexpr Iterator begin() const {
+        return Iterator(text_);
+    }
+
+    constexpr Sentinel end() const {
+        return {};
+    }
+
+private:
+    std::string_view text_;
+};
+} // namespace mizu
+
+#endif // MIZU_UTF8_HPP
@@ -1,17 +1,18 @@
 #include "gloo/buffer.hpp"
 
 namespace gloo {
-Buffer::Buffer(GladGLContext &gl)
+Buffer::Buffer(Context &gl)
     : gl_(gl) {
-    gl_.GenBuffers(1, &id);
-    CHECK_GL_ERROR(gl_, GenBuffers);
+    gl_.ctx.CreateBuffers(1, &id);
+    CHECK_GL_ERROR(gl_.ctx, CreateBuffers);
     MIZU_LOG_TRACE("Created buffer id={}", id);
 }
 
 Buffer::~Buffer() {
     if (id != 0) {
-        gl_.DeleteBuffers(1, &id);
-        CHECK_GL_ERROR(gl_, DeleteBuffers);
+        gl_.ctx.DeleteBuffers(1, &id);
+        CHECK_GL_ERROR(gl_.ctx, DeleteBuffers);
+        gl_.forget_buffer(id);
         MIZU_LOG_TRACE("Deleted buffer id={}", id);
     }
 }
@@ -32,12 +33,10 @@ MOVE_ASSIGN_OP_IMPL(Buffer) {
 }
 
 void Buffer::bind(BufferTarget target) {
-    gl_.BindBuffer(unwrap(target), id);
-    CHECK_GL_ERROR(gl_, BindBuffer);
+    gl_.bind_buffer(unwrap(target), id);
 }
 
 void Buffer::unbind(BufferTarget target) {
-    gl_.BindBuffer(unwrap(target), 0);
-    CHECK_GL_ERROR(gl_, UnbindBuffer);
+    gl_.bind_buffer(unwrap(target), 0);
 }
 } // namespace gloo
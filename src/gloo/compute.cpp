@@ -0,0 +1,76 @@
+#include "gloo/compute.hpp"
+#include "mizu/core/log.hpp"
+
+namespace gloo {
+ComputePipeline::ComputePipeline(Context &gl, std::unique_ptr<Shader> shader)
+    : gl_(gl), shader_(std::move(shader)) {
+    GLint local_size[3];
+    gl_.ctx.GetProgramiv(shader_->id, GL_COMPUTE_WORK_GROUP_SIZE, local_size);
+    CHECK_GL_ERROR(gl_.ctx, GetProgramiv);
+    local_size_ = {local_size[0], local_size[1], local_size[2]};
+
+    for (GLuint i = 0; i < 3; ++i) {
+        GLint max_groups;
+        gl_.ctx.GetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, i, &max_groups);
+        CHECK_GL_ERROR(gl_.ctx, GetIntegeri_v);
+        max_groups_[i] = static_cast<GLuint>(max_groups);
+    }
+
+    MIZU_LOG_TRACE(
+            "Created compute pipeline program={} local_size={}x{}x{}",
+            shader_->id,
+            local_size_.x,
+            local_size_.y,
+            local_size_.z);
+}
+
+std::unique_ptr<ComputePipeline>
+ComputePipeline::from_src(Context &gl, const std::string &src, const ShaderDefines &defines) {
+    auto shader = ShaderBuilder(gl).stage_src(ShaderType::Compute, src).defines(defines).link();
+    if (!shader)
+        return nullptr;
+    return std::make_unique<ComputePipeline>(gl, std::move(shader));
+}
+
+Shader &ComputePipeline::shader() {
+    return *shader_;
+}
+
+glm::uvec3 ComputePipeline::local_size() const {
+    return local_size_;
+}
+
+void ComputePipeline::dispatch(glm::uvec3 groups) {
+    if (groups.x == 0 || groups.y == 0 || groups.z == 0)
+        return;
+
+    if (groups.x > max_groups_.x || groups.y > max_groups_.y || groups.z > max_groups_.z) {
+        MIZU_LOG_ERROR(
+                "Compute dispatch of {}x{}x{} groups exceeds the limit of {}x{}x{}",
+                groups.x,
+                groups.y,
+                groups.z,
+                max_groups_.x,
+                max_groups_.y,
+                max_groups_.z);
+        return;
+    }
+
+    shader_->use();
+    gl_.ctx.DispatchCompute(groups.x, groups.y, groups.z);
+    CHECK_GL_ERROR(gl_.ctx, DispatchCompute);
+    gl_.count_dispatch();
+}
+
+void ComputePipeline::dispatch_covering(glm::uvec3 invocations) {
+    dispatch((invocations + local_size_ - 1u) / local_size_);
+}
+
+void ComputePipeline::dispatch_indirect(const Buffer &args, GLintptr offset) {
+    shader_->use();
+    gl_.bind_buffer(unwrap(BufferTarget::DispatchIndirect), args.id);
+    gl_.ctx.DispatchComputeIndirect(offset);
+    CHECK_GL_ERROR(gl_.ctx, DispatchComputeIndirect);
+    gl_.count_dispatch();
+}
+} // namespace gloo
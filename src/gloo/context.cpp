@@ -6,9 +6,135 @@ std::optional<ContextVersion> Context::load(GLADloadfunc func) {
     auto glad_version = gladLoadGLContext(&ctx, func);
     if (glad_version == 0)
         return std::nullopt;
+
+    // Let the driver pick how many threads to compile with, 0xffffffff means no limit
+    if (ctx.KHR_parallel_shader_compile) {
+        ctx.MaxShaderCompilerThreadsKHR(0xffffffff);
+        CHECK_GL_ERROR(ctx, MaxShaderCompilerThreadsKHR);
+    }
+
     return ContextVersion(GLAD_VERSION_MAJOR(glad_version), GLAD_VERSION_MINOR(glad_version));
 }
 
+bool Context::parallel_shader_compile() const {
+    return ctx.KHR_parallel_shader_compile != 0;
+}
+
+bool Context::compute_shaders() const {
+    return ctx.VERSION_4_3 != 0;
+}
+
+void Context::use_program(GLuint id) {
+    if (update_shadow_(shadow_.program, id)) {
+        ctx.UseProgram(id);
+        CHECK_GL_ERROR(ctx, UseProgram);
+    }
+}
+
+void Context::bind_vertex_array(GLuint id) {
+    if (update_shadow_(shadow_.vertex_array, id)) {
+        ctx.BindVertexArray(id);
+        CHECK_GL_ERROR(ctx, BindVertexArray);
+
+        // The element array binding is part of the VAO
+        if (const auto slot = buffer_target_slot_(GL_ELEMENT_ARRAY_BUFFER); slot)
+            shadow_.buffers[*slot] = UNKNOWN_;
+    }
+}
+
+void Context::bind_buffer(GLenum target, GLuint id) {
+    const auto slot = buffer_target_slot_(target);
+    if (!slot || update_shadow_(shadow_.buffers[*slot], id)) {
+        ctx.BindBuffer(target, id);
+        CHECK_GL_ERROR(ctx, BindBuffer);
+    }
+}
+
+void Context::bind_buffer_base(GLenum target, GLuint index, GLuint id) {
+    ctx.BindBufferBase(target, index, id);
+    CHECK_GL_ERROR(ctx, BindBufferBase);
+    stats_.issued++;
+
+    // Binding to an indexed target also binds the generic one
+    if (const auto slot = buffer_target_slot_(target); slot)
+        shadow_.buffers[*slot] = id;
+}
+
+void Context::bind_texture(GLuint unit, GLuint id) {
+    if (unit >= TEXTURE_UNIT_COUNT_ || update_shadow_(shadow_.textures[unit], id)) {
+        ctx.BindTextureUnit(unit, id);
+        CHECK_GL_ERROR(ctx, BindTextureUnit);
+    }
+}
+
+// Binds both the draw and read targets, 0 is the window's default framebuffer
+void Context::bind_framebuffer(GLuint id) {
+    if (update_shadow_(shadow_.framebuffer, id)) {
+        ctx.BindFramebuffer(GL_FRAMEBUFFER, id);
+        CHECK_GL_ERROR(ctx, BindFramebuffer);
+    }
+}
+
+void Context::forget_program(GLuint id) {
+    if (shadow_.program == id)
+        shadow_.program = UNKNOWN_;
+}
+
+void Context::forget_vertex_array(GLuint id) {
+    if (shadow_.vertex_array == id)
+        shadow_.vertex_array = 0;
+}
+
+void Context::forget_buffer(GLuint id) {
+    for (auto &buffer: shadow_.buffers)
+        if (buffer == id)
+            buffer = 0;
+}
+
+void Context::forget_texture(GLuint id) {
+    for (auto &texture: shadow_.textures)
+        if (texture == id)
+            texture = 0;
+}
+
+void Context::forget_framebuffer(GLuint id) {
+    if (shadow_.framebuffer == id)
+        shadow_.framebuffer = 0;
+}
+
+void Context::invalidate_state() {
+    shadow_ = Shadow();
+}
+
+const StateStats &Context::state_stats() const {
+    return stats_;
+}
+
+void Context::reset_state_stats() {
+    stats_ = StateStats();
+}
+
+void Context::count_draw(std::size_t vertices) {
+    draw_stats_.draw_calls++;
+    draw_stats_.vertices += vertices;
+}
+
+void Context::count_upload(std::size_t bytes) {
+    draw_stats_.bytes_uploaded += bytes;
+}
+
+void Context::count_dispatch() {
+    draw_stats_.dispatches++;
+}
+
+const DrawStats &Context::draw_stats() const {
+    return draw_stats_;
+}
+
+void Context::reset_draw_stats() {
+    draw_stats_ = DrawStats();
+}
+
 void Context::clear_color(const mizu::Color &color) {
     auto gl_color = color.gl_color();
     ctx.ClearColor(gl_color.r, gl_color.g, gl_color.b, gl_color.a);
@@ -21,13 +147,21 @@ void Context::clear(ClearBit mask) {
 }
 
 void Context::enable(Capability cap) {
-    ctx.Enable(static_cast<GLenum>(cap));
-    CHECK_GL_ERROR(ctx, Enable);
+    // Unknown capabilities are seeded with the opposite value so the call goes through
+    auto it = shadow_.capabilities.try_emplace(unwrap(cap), !true).first;
+    if (update_shadow_(it->second, true)) {
+        ctx.Enable(static_cast<GLenum>(cap));
+        CHECK_GL_ERROR(ctx, Enable);
+    }
 }
 
 void Context::disable(Capability cap) {
-    ctx.Disable(static_cast<GLenum>(cap));
-    CHECK_GL_ERROR(ctx, Disable);
+    // Unknown capabilities are seeded with the opposite value so the call goes through
+    auto it = shadow_.capabilities.try_emplace(unwrap(cap), !false).first;
+    if (update_shadow_(it->second, false)) {
+        ctx.Disable(static_cast<GLenum>(cap));
+        CHECK_GL_ERROR(ctx, Disable);
+    }
 }
 
 bool Context::is_enabled(Capability cap) const {
@@ -37,28 +171,71 @@ bool Context::is_enabled(Capability cap) const {
 }
 
 void Context::clear_depth(float depth) {
-    ctx.ClearDepth(depth);
-    CHECK_GL_ERROR(ctx, ClearDepth);
+    if (update_shadow_(shadow_.clear_depth, std::optional(depth))) {
+        ctx.ClearDepth(depth);
+        CHECK_GL_ERROR(ctx, ClearDepth);
+    }
 }
 
 void Context::blend_func(BlendFunc sfactor, BlendFunc dfactor) {
-    ctx.BlendFunc(static_cast<GLenum>(sfactor), static_cast<GLenum>(dfactor));
-    CHECK_GL_ERROR(ctx, BlendFunc);
+    if (update_shadow_(shadow_.blend_func, std::optional(std::pair(sfactor, dfactor)))) {
+        ctx.BlendFunc(static_cast<GLenum>(sfactor), static_cast<GLenum>(dfactor));
+        CHECK_GL_ERROR(ctx, BlendFunc);
+    }
 }
 
 void Context::depth_func(DepthFunc func) {
-    ctx.DepthFunc(static_cast<GLenum>(func));
-    CHECK_GL_ERROR(ctx, DepthFunc);
+    if (update_shadow_(shadow_.depth_func, std::optional(func))) {
+        ctx.DepthFunc(static_cast<GLenum>(func));
+        CHECK_GL_ERROR(ctx, DepthFunc);
+    }
 }
 
 void Context::clip_control(ClipOrigin origin, ClipDepth depth) {
-    ctx.ClipControl(static_cast<GLenum>(origin), static_cast<GLenum>(depth));
-    CHECK_GL_ERROR(ctx, ClipControl);
+    if (update_shadow_(shadow_.clip_control, std::optional(std::pair(origin, depth)))) {
+        ctx.ClipControl(static_cast<GLenum>(origin), static_cast<GLenum>(depth));
+        CHECK_GL_ERROR(ctx, ClipControl);
+    }
 }
 
 void Context::depth_mask(bool enabled) {
-    ctx.DepthMask(enabled ? GL_TRUE : GL_FALSE);
-    CHECK_GL_ERROR(ctx, DepthMask);
+    if (update_shadow_(shadow_.depth_mask, std::optional(enabled))) {
+        ctx.DepthMask(enabled ? GL_TRUE : GL_FALSE);
+        CHECK_GL_ERROR(ctx, DepthMask);
+    }
+}
+
+void Context::scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    if (update_shadow_(shadow_.scissor, std::optional(std::array{x, y, width, height}))) {
+        ctx.Scissor(x, y, width, height);
+        CHECK_GL_ERROR(ctx, Scissor);
+    }
+}
+
+void Context::memory_barrier(BarrierBit bits) {
+    ctx.MemoryBarrier(unwrap(bits));
+    CHECK_GL_ERROR(ctx, MemoryBarrier);
+    stats_.issued++;
+}
+
+std::optional<std::size_t> Context::buffer_target_slot_(GLenum target) {
+    switch (target) {
+    case GL_ARRAY_BUFFER: return 0;
+    case GL_ATOMIC_COUNTER_BUFFER: return 1;
+    case GL_COPY_READ_BUFFER: return 2;
+    case GL_COPY_WRITE_BUFFER: return 3;
+    case GL_DISPATCH_INDIRECT_BUFFER: return 4;
+    case GL_DRAW_INDIRECT_BUFFER: return 5;
+    case GL_ELEMENT_ARRAY_BUFFER: return 6;
+    case GL_PIXEL_PACK_BUFFER: return 7;
+    case GL_PIXEL_UNPACK_BUFFER: return 8;
+    case GL_QUERY_BUFFER: return 9;
+    case GL_SHADER_STORAGE_BUFFER: return 10;
+    case GL_TEXTURE_BUFFER: return 11;
+    case GL_TRANSFORM_FEEDBACK_BUFFER: return 12;
+    case GL_UNIFORM_BUFFER: return 13;
+    default: return std::nullopt;
+    }
 }
 
 void Context::debug_message_callback(GLDEBUGPROC callback, const void *user_param) {
@@ -0,0 +1,79 @@
+#include "gloo/framebuffer.hpp"
+#include "mizu/core/log.hpp"
+
+namespace gloo {
+Framebuffer::Framebuffer(Context &gl, glm::ivec2 size, InternalFormat color_format)
+    : gl_(gl), size_(size) {
+    color_ = std::make_unique<Texture>(
+            gl_,
+            size_,
+            TextureDesc{
+                    .format = color_format,
+                    .mip_levels = 1,
+                    .min_filter = MinFilter::Nearest,
+                    .mag_filter = MagFilter::Nearest,
+            });
+
+    gl_.ctx.CreateRenderbuffers(1, &depth_);
+    CHECK_GL_ERROR(gl_.ctx, CreateRenderbuffers);
+    gl_.ctx.NamedRenderbufferStorage(depth_, GL_DEPTH_COMPONENT32F, size_.x, size_.y);
+    CHECK_GL_ERROR(gl_.ctx, NamedRenderbufferStorage);
+
+    gl_.ctx.CreateFramebuffers(1, &id);
+    CHECK_GL_ERROR(gl_.ctx, CreateFramebuffers);
+    gl_.ctx.NamedFramebufferTexture(id, GL_COLOR_ATTACHMENT0, color_->id, 0);
+    CHECK_GL_ERROR(gl_.ctx, NamedFramebufferTexture);
+    gl_.ctx.NamedFramebufferRenderbuffer(id, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_);
+    CHECK_GL_ERROR(gl_.ctx, NamedFramebufferRenderbuffer);
+    MIZU_LOG_TRACE("Created framebuffer id={} size={}x{}", id, size_.x, size_.y);
+
+    if (!complete())
+        MIZU_LOG_ERROR("Framebuffer id={} is incomplete", id);
+}
+
+Framebuffer::~Framebuffer() {
+    if (id != 0) {
+        gl_.ctx.DeleteFramebuffers(1, &id);
+        CHECK_GL_ERROR(gl_.ctx, DeleteFramebuffers);
+        gl_.forget_framebuffer(id);
+        MIZU_LOG_TRACE("Deleted framebuffer id={}", id);
+    }
+
+    if (depth_ != 0) {
+        gl_.ctx.DeleteRenderbuffers(1, &depth_);
+        CHECK_GL_ERROR(gl_.ctx, DeleteRenderbuffers);
+    }
+}
+
+glm::ivec2 Framebuffer::size() const {
+    return size_;
+}
+
+const Texture &Framebuffer::color() const {
+    return *color_;
+}
+
+bool Framebuffer::complete() const {
+    const auto status = gl_.ctx.CheckNamedFramebufferStatus(id, GL_FRAMEBUFFER);
+    CHECK_GL_ERROR(gl_.ctx, CheckNamedFramebufferStatus);
+    return status == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void Framebuffer::bind() {
+    gl_.bind_framebuffer(id);
+}
+
+void Framebuffer::unbind() {
+    gl_.bind_framebuffer(0);
+}
+
+void Framebuffer::blit_to(GLuint dst_fbo, glm::ivec2 dst_size, BlitFilter filter) const {
+    blit_to(dst_fbo, size_, dst_size, filter);
+}
+
+void Framebuffer::blit_to(GLuint dst_fbo, glm::ivec2 src_size, glm::ivec2 dst_size, BlitFilter filter) const {
+    gl_.ctx.BlitNamedFramebuffer(
+            id, dst_fbo, 0, 0, src_size.x, src_size.y, 0, 0, dst_size.x, dst_size.y, GL_COLOR_BUFFER_BIT, unwrap(filter));
+    CHECK_GL_ERROR(gl_.ctx, BlitNamedFramebuffer);
+}
+} // namespace gloo
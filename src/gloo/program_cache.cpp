@@ -0,0 +1,148 @@
+#include "gloo/program_cache.hpp"
+#include <fstream>
+#include "mizu/core/log.hpp"
+#include "mizu/util/hash.hpp"
+
+namespace gloo {
+// Bump whenever the entry layout changes so stale files are ignored
+constexpr std::uint32_t CACHE_MAGIC = 0x4250'5a4d; // "MZPB"
+constexpr std::uint32_t CACHE_VERSION = 1;
+
+struct CacheHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t key;
+    std::uint32_t format;
+    std::uint32_t reserved;
+    std::uint64_t size;
+};
+
+bool ProgramCache::open(GladGLContext &gl, const std::filesystem::path &dir) {
+    close();
+
+    GLint format_count = 0;
+    gl.GetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    CHECK_GL_ERROR(gl, GetIntegerv);
+    if (format_count == 0) {
+        MIZU_LOG_WARN("Driver exposes no program binary formats, program cache disabled");
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        MIZU_LOG_WARN("Failed to create program cache directory '{}': {}", dir, ec.message());
+        return false;
+    }
+
+    const auto get_string = [&](GLenum name) {
+        const auto s = reinterpret_cast<const char *>(gl.GetString(name));
+        CHECK_GL_ERROR(gl, GetString);
+        return std::string(s ? s : "");
+    };
+    driver_ = get_string(GL_VENDOR) + '\n' + get_string(GL_RENDERER) + '\n' + get_string(GL_VERSION);
+    dir_ = dir;
+
+    MIZU_LOG_DEBUG("Opened program cache at '{}'", dir);
+    return true;
+}
+
+void ProgramCache::close() {
+    dir_ = std::nullopt;
+    driver_.clear();
+}
+
+bool ProgramCache::enabled() const {
+    return dir_.has_value();
+}
+
+std::uint64_t ProgramCache::key(const std::vector<std::pair<GLenum, std::string_view>> &stages) const {
+    auto hash = mizu::fnv1a(mizu::FNV_OFFSET_BASIS, driver_.data(), driver_.size());
+    for (const auto &[type, src]: stages) {
+        hash = mizu::fnv1a(hash, &type, sizeof(type));
+        const std::uint64_t len = src.size();
+        hash = mizu::fnv1a(hash, &len, sizeof(len));
+        hash = mizu::fnv1a(hash, src.data(), src.size());
+    }
+    return hash;
+}
+
+std::optional<ProgramBinary> ProgramCache::load(std::uint64_t key) const {
+    if (!enabled())
+        return std::nullopt;
+
+    const auto path = entry_path_(key);
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        return std::nullopt;
+
+    CacheHeader header{};
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!in || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.key != key) {
+        MIZU_LOG_DEBUG("Ignoring invalid program cache entry '{}'", path);
+        return std::nullopt;
+    }
+
+    // Checked before allocating so a corrupt size can't ask for more than the file holds
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(path, ec);
+    if (ec || file_size < sizeof(header) || header.size > file_size - sizeof(header)) {
+        MIZU_LOG_DEBUG("Ignoring truncated program cache entry '{}'", path);
+        return std::nullopt;
+    }
+
+    ProgramBinary binary{static_cast<GLenum>(header.format), std::vector<std::byte>(header.size)};
+    in.read(reinterpret_cast<char *>(binary.bytes.data()), static_cast<std::streamsize>(header.size));
+    if (!in) {
+        MIZU_LOG_DEBUG("Ignoring truncated program cache entry '{}'", path);
+        return std::nullopt;
+    }
+
+    return binary;
+}
+
+void ProgramCache::store(std::uint64_t key, const ProgramBinary &binary) const {
+    if (!enabled())
+        return;
+
+    const auto path = entry_path_(key);
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            MIZU_LOG_WARN("Failed to open program cache entry '{}' for writing", tmp_path);
+            return;
+        }
+
+        const CacheHeader header{CACHE_MAGIC, CACHE_VERSION, key, binary.format, 0, binary.bytes.size()};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(binary.bytes.data()), static_cast<std::streamsize>(binary.bytes.size()));
+        if (!out) {
+            MIZU_LOG_WARN("Failed to write program cache entry '{}'", tmp_path);
+            return;
+        }
+    }
+
+    // Rename so a crash mid-write never leaves a partial entry under the real name
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+        MIZU_LOG_WARN("Failed to commit program cache entry '{}': {}", path, ec.message());
+    else
+        MIZU_LOG_TRACE("Stored program binary {:016x} ({} bytes)", key, binary.bytes.size());
+}
+
+void ProgramCache::evict(std::uint64_t key) const {
+    if (!enabled())
+        return;
+
+    std::error_code ec;
+    std::filesystem::remove(entry_path_(key), ec);
+}
+
+std::filesystem::path ProgramCache::entry_path_(std::uint64_t key) const {
+    return *dir_ / fmt::format("{:016x}.bin", key);
+}
+} // namespace gloo
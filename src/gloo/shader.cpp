@@ -1,12 +1,15 @@
 #include "gloo/shader.hpp"
+#include <algorithm>
 #include "glm/gtc/type_ptr.hpp"
 #include "mizu/core/log.hpp"
+#include "mizu/util/enum_class_helpers.hpp"
 
 namespace gloo {
 Shader::~Shader() {
     if (id != 0) {
-        gl_.DeleteProgram(id);
-        CHECK_GL_ERROR(gl_, DeleteProgram);
+        gl_.ctx.DeleteProgram(id);
+        CHECK_GL_ERROR(gl_.ctx, DeleteProgram);
+        gl_.forget_program(id);
         MIZU_LOG_TRACE("Deleted shader program id={}", id);
     }
 }
@@ -48,15 +51,14 @@ MOVE_ASSIGN_OP_IMPL(Shader) {
 }
 
 void Shader::use() {
-    gl_.UseProgram(id);
-    CHECK_GL_ERROR(gl_, UseProgram);
+    gl_.use_program(id);
 }
 
 std::optional<GLuint> Shader::attrib_location(const std::string &name) {
     auto it = attrib_locs_.find(name);
     if (it == attrib_locs_.end()) {
-        GLint loc = gl_.GetAttribLocation(id, name.c_str());
-        CHECK_GL_ERROR(gl_, GetAttribLocation);
+        GLint loc = gl_.ctx.GetAttribLocation(id, name.c_str());
+        CHECK_GL_ERROR(gl_.ctx, GetAttribLocation);
         if (loc == -1) {
             if (auto it2 = bad_attrib_locs_.find(name); it2 == bad_attrib_locs_.end()) {
                 MIZU_LOG_ERROR("Attrib \"{}\" not found", name);
@@ -69,245 +71,258 @@ std::optional<GLuint> Shader::attrib_location(const std::string &name) {
     return it->second;
 }
 
+bool Shader::uniform_block_binding(const std::string &name, GLuint binding) {
+    const GLuint index = gl_.ctx.GetUniformBlockIndex(id, name.c_str());
+    CHECK_GL_ERROR(gl_.ctx, GetUniformBlockIndex);
+    if (index == GL_INVALID_INDEX) {
+        MIZU_LOG_ERROR("Uniform block \"{}\" not found", name);
+        return false;
+    }
+
+    gl_.ctx.UniformBlockBinding(id, index, binding);
+    CHECK_GL_ERROR(gl_.ctx, UniformBlockBinding);
+    return true;
+}
+
 void Shader::uniform(const std::string &name, float v0) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform1f(*loc, v0);
-        CHECK_GL_ERROR(gl_, Uniform1f);
+        gl_.ctx.Uniform1f(*loc, v0);
+        CHECK_GL_ERROR(gl_.ctx, Uniform1f);
     }
 }
 
 void Shader::uniform(const std::string &name, float v0, float v1) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform2f(*loc, v0, v1);
-        CHECK_GL_ERROR(gl_, Uniform2f);
+        gl_.ctx.Uniform2f(*loc, v0, v1);
+        CHECK_GL_ERROR(gl_.ctx, Uniform2f);
     }
 }
 
 void Shader::uniform(const std::string &name, float v0, float v1, float v2) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform3f(*loc, v0, v1, v2);
-        CHECK_GL_ERROR(gl_, Uniform3f);
+        gl_.ctx.Uniform3f(*loc, v0, v1, v2);
+        CHECK_GL_ERROR(gl_.ctx, Uniform3f);
     }
 }
 
 void Shader::uniform(const std::string &name, float v0, float v1, float v2, float v3) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform4f(*loc, v0, v1, v2, v3);
-        CHECK_GL_ERROR(gl_, Uniform4f);
+        gl_.ctx.Uniform4f(*loc, v0, v1, v2, v3);
+        CHECK_GL_ERROR(gl_.ctx, Uniform4f);
     }
 }
 
 void Shader::uniform(const std::string &name, int v0) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform1i(*loc, v0);
-        CHECK_GL_ERROR(gl_, Uniform1i);
+        gl_.ctx.Uniform1i(*loc, v0);
+        CHECK_GL_ERROR(gl_.ctx, Uniform1i);
     }
 }
 
 void Shader::uniform(const std::string &name, int v0, int v1) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform2i(*loc, v0, v1);
-        CHECK_GL_ERROR(gl_, Uniform2i);
+        gl_.ctx.Uniform2i(*loc, v0, v1);
+        CHECK_GL_ERROR(gl_.ctx, Uniform2i);
     }
 }
 
 void Shader::uniform(const std::string &name, int v0, int v1, int v2) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform3i(*loc, v0, v1, v2);
-        CHECK_GL_ERROR(gl_, Uniform3i);
+        gl_.ctx.Uniform3i(*loc, v0, v1, v2);
+        CHECK_GL_ERROR(gl_.ctx, Uniform3i);
     }
 }
 
 void Shader::uniform(const std::string &name, int v0, int v1, int v2, int v3) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform4i(*loc, v0, v1, v2, v3);
-        CHECK_GL_ERROR(gl_, Uniform4i);
+        gl_.ctx.Uniform4i(*loc, v0, v1, v2, v3);
+        CHECK_GL_ERROR(gl_.ctx, Uniform4i);
     }
 }
 
 void Shader::uniform(const std::string &name, unsigned int v0) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform1ui(*loc, v0);
-        CHECK_GL_ERROR(gl_, Uniform1ui);
+        gl_.ctx.Uniform1ui(*loc, v0);
+        CHECK_GL_ERROR(gl_.ctx, Uniform1ui);
     }
 }
 
 void Shader::uniform(const std::string &name, unsigned int v0, unsigned int v1) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform2ui(*loc, v0, v1);
-        CHECK_GL_ERROR(gl_, Uniform2ui);
+        gl_.ctx.Uniform2ui(*loc, v0, v1);
+        CHECK_GL_ERROR(gl_.ctx, Uniform2ui);
     }
 }
 
 void Shader::uniform(const std::string &name, unsigned int v0, unsigned int v1, unsigned int v2) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform3ui(*loc, v0, v1, v2);
-        CHECK_GL_ERROR(gl_, Uniform3ui);
+        gl_.ctx.Uniform3ui(*loc, v0, v1, v2);
+        CHECK_GL_ERROR(gl_.ctx, Uniform3ui);
     }
 }
 
 void Shader::uniform(const std::string &name, unsigned int v0, unsigned int v1, unsigned int v2, unsigned int v3) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform4ui(*loc, v0, v1, v2, v3);
-        CHECK_GL_ERROR(gl_, Uniform4ui);
+        gl_.ctx.Uniform4ui(*loc, v0, v1, v2, v3);
+        CHECK_GL_ERROR(gl_.ctx, Uniform4ui);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::vec1 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform1fv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform1fv);
+        gl_.ctx.Uniform1fv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform1fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::vec2 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform2fv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform2fv);
+        gl_.ctx.Uniform2fv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform2fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::vec3 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform3fv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform3fv);
+        gl_.ctx.Uniform3fv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform3fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::vec4 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform4fv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform4fv);
+        gl_.ctx.Uniform4fv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform4fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::ivec1 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform1iv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform1iv);
+        gl_.ctx.Uniform1iv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform1iv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::ivec2 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform2iv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform2iv);
+        gl_.ctx.Uniform2iv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform2iv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::ivec3 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform3iv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform3iv);
+        gl_.ctx.Uniform3iv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform3iv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::ivec4 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform4iv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform4iv);
+        gl_.ctx.Uniform4iv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform4iv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::uvec1 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform1uiv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform1uiv);
+        gl_.ctx.Uniform1uiv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform1uiv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::uvec2 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform2uiv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform2uiv);
+        gl_.ctx.Uniform2uiv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform2uiv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::uvec3 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform3uiv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform3uiv);
+        gl_.ctx.Uniform3uiv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform3uiv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::uvec4 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.Uniform4uiv(*loc, 1, value_ptr(v));
-        CHECK_GL_ERROR(gl_, Uniform4uiv);
+        gl_.ctx.Uniform4uiv(*loc, 1, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, Uniform4uiv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::mat2 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.UniformMatrix2fv(*loc, 1, GL_FALSE, value_ptr(v));
-        CHECK_GL_ERROR(gl_, UniformMatrix2fv);
+        gl_.ctx.UniformMatrix2fv(*loc, 1, GL_FALSE, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, UniformMatrix2fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::mat3 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.UniformMatrix3fv(*loc, 1, GL_FALSE, value_ptr(v));
-        CHECK_GL_ERROR(gl_, UniformMatrix3fv);
+        gl_.ctx.UniformMatrix3fv(*loc, 1, GL_FALSE, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, UniformMatrix3fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::mat4 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.UniformMatrix4fv(*loc, 1, GL_FALSE, value_ptr(v));
-        CHECK_GL_ERROR(gl_, UniformMatrix4fv);
+        gl_.ctx.UniformMatrix4fv(*loc, 1, GL_FALSE, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, UniformMatrix4fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::mat2x3 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.UniformMatrix2x3fv(*loc, 1, GL_FALSE, value_ptr(v));
-        CHECK_GL_ERROR(gl_, UniformMatrix2x3fv);
+        gl_.ctx.UniformMatrix2x3fv(*loc, 1, GL_FALSE, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, UniformMatrix2x3fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::mat3x2 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.UniformMatrix3x2fv(*loc, 1, GL_FALSE, value_ptr(v));
-        CHECK_GL_ERROR(gl_, UniformMatrix3x2fv);
+        gl_.ctx.UniformMatrix3x2fv(*loc, 1, GL_FALSE, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, UniformMatrix3x2fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::mat2x4 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.UniformMatrix2x4fv(*loc, 1, GL_FALSE, value_ptr(v));
-        CHECK_GL_ERROR(gl_, UniformMatrix2x4fv);
+        gl_.ctx.UniformMatrix2x4fv(*loc, 1, GL_FALSE, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, UniformMatrix2x4fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::mat4x2 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.UniformMatrix4x2fv(*loc, 1, GL_FALSE, value_ptr(v));
-        CHECK_GL_ERROR(gl_, UniformMatrix4x2fv);
+        gl_.ctx.UniformMatrix4x2fv(*loc, 1, GL_FALSE, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, UniformMatrix4x2fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::mat3x4 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.UniformMatrix3x4fv(*loc, 1, GL_FALSE, value_ptr(v));
-        CHECK_GL_ERROR(gl_, UniformMatrix3x4fv);
+        gl_.ctx.UniformMatrix3x4fv(*loc, 1, GL_FALSE, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, UniformMatrix3x4fv);
     }
 }
 
 void Shader::uniform(const std::string &name, const glm::mat4x3 &v) {
     if (const auto loc = find_uniform_loc_(name); loc) {
-        gl_.UniformMatrix4x3fv(*loc, 1, GL_FALSE, value_ptr(v));
-        CHECK_GL_ERROR(gl_, UniformMatrix4x3fv);
+        gl_.ctx.UniformMatrix4x3fv(*loc, 1, GL_FALSE, value_ptr(v));
+        CHECK_GL_ERROR(gl_.ctx, UniformMatrix4x3fv);
     }
 }
 
-Shader::Shader(GladGLContext &gl, GLuint id)
+Shader::Shader(Context &gl, GLuint id)
     : id(id), gl_(gl) {}
 
 std::optional<GLint> Shader::find_uniform_loc_(const std::string &name) {
     auto it = uniform_locs_.find(name);
     if (it == uniform_locs_.end()) {
-        GLint loc = gl_.GetUniformLocation(id, name.c_str());
-        CHECK_GL_ERROR(gl_, GetUniformLocation);
+        GLint loc = gl_.ctx.GetUniformLocation(id, name.c_str());
+        CHECK_GL_ERROR(gl_.ctx, GetUniformLocation);
         if (loc == -1) {
             if (auto it2 = bad_uniform_locs_.find(name); it2 == bad_uniform_locs_.end()) {
                 MIZU_LOG_ERROR("Uniform \"{}\" not found", name);
@@ -320,66 +335,106 @@ std::optional<GLint> Shader::find_uniform_loc_(const std::string &name) {
     return it->second;
 }
 
-ShaderBuilder::ShaderBuilder(GladGLContext &gl)
-    : gl_(gl) {}
+PendingShader::~PendingShader() {
+    delete_stages_();
+    delete_program_();
+}
 
-ShaderBuilder &ShaderBuilder::stage_src(ShaderType type, const std::string &src) {
-    GLuint id = gl_.CreateShader(static_cast<GLenum>(type));
-    CHECK_GL_ERROR(gl_, CreateShader);
-    MIZU_LOG_TRACE("Created {} shader id={}", shader_type_str(type), id);
-    stages_.emplace_back(id, type, src);
+MOVE_CONSTRUCTOR_IMPL(PendingShader)
+    : gl_(other.gl_),
+      cache_(other.cache_),
+      key_(other.key_),
+      program_id_(other.program_id_),
+      stages_(std::move(other.stages_)),
+      from_cache_(other.from_cache_) {
+    other.program_id_ = 0;
+    other.stages_.clear();
+}
+
+MOVE_ASSIGN_OP_IMPL(PendingShader) {
+    if (this != &other) {
+        delete_stages_();
+        delete_program_();
+
+        gl_ = other.gl_;
+        cache_ = other.cache_;
+        key_ = other.key_;
+
+        program_id_ = other.program_id_;
+        other.program_id_ = 0;
 
+        std::swap(stages_, other.stages_);
+        other.stages_.clear();
+
+        from_cache_ = other.from_cache_;
+    }
     return *this;
 }
 
-std::unique_ptr<Shader> ShaderBuilder::link() {
-    GLuint program_id = gl_.CreateProgram();
-    CHECK_GL_ERROR(gl_, CreateProgram);
-    MIZU_LOG_TRACE("Created shader program id={}", program_id);
+bool PendingShader::ready() const {
+    if (from_cache_ || !gl_.ctx.KHR_parallel_shader_compile)
+        return true;
+
+    GLint done = GL_FALSE;
+    gl_.ctx.GetProgramiv(program_id_, GL_COMPLETION_STATUS_KHR, &done);
+    CHECK_GL_ERROR(gl_.ctx, GetProgramiv);
+    return done == GL_TRUE;
+}
+
+std::unique_ptr<Shader> PendingShader::finish() {
+    if (program_id_ == 0)
+        return nullptr;
 
-    bool had_compile_error = false;
-    for (auto &[id, type, src]: stages_) {
-        if (try_compile_(id, type, src)) {
-            gl_.AttachShader(program_id, id);
-            CHECK_GL_ERROR(gl_, AttachShader);
-        } else {
-            had_compile_error = true;
-            break;
+    if (!from_cache_) {
+        bool had_compile_error = false;
+        for (const auto &[id, type]: stages_) {
+            if (!check_compile_(id, type)) {
+                had_compile_error = true;
+                break;
+            }
         }
-    }
 
-    if (had_compile_error || !try_link_(program_id)) {
-        delete_stages_();
-        gl_.DeleteProgram(program_id);
-        CHECK_GL_ERROR(gl_, DeleteProgram);
-        MIZU_LOG_TRACE("Deleted shader program id={}", program_id);
+        if (had_compile_error || !check_link_()) {
+            delete_stages_();
+            delete_program_();
+            return nullptr;
+        }
 
-        return nullptr;
+        delete_stages_();
+        store_binary_();
     }
 
-    delete_stages_();
+    const auto program_id = std::exchange(program_id_, 0);
     return std::unique_ptr<Shader>(new Shader(gl_, program_id));
 }
 
-bool ShaderBuilder::try_compile_(GLuint id, ShaderType type, const std::string &src) const {
-    auto src_p = src.c_str();
-    gl_.ShaderSource(id, 1, &src_p, nullptr);
-    CHECK_GL_ERROR(gl_, ShaderSource);
-    gl_.CompileShader(id);
-    CHECK_GL_ERROR(gl_, CompileShader);
-
+PendingShader::PendingShader(
+        Context &gl,
+        const ProgramCache *cache,
+        std::uint64_t key,
+        GLuint program_id,
+        std::vector<std::pair<GLuint, ShaderType>> stages,
+        bool from_cache)
+    : gl_(gl),
+      cache_(cache),
+      key_(key),
+      program_id_(program_id),
+      stages_(std::move(stages)),
+      from_cache_(from_cache) {}
+
+bool PendingShader::check_compile_(GLuint id, ShaderType type) const {
     int success;
-    gl_.GetShaderiv(id, GL_COMPILE_STATUS, &success);
-    CHECK_GL_ERROR(gl_, GetShaderiv);
+    gl_.ctx.GetShaderiv(id, GL_COMPILE_STATUS, &success);
+    CHECK_GL_ERROR(gl_.ctx, GetShaderiv);
 
     if (!success) {
         int info_log_length;
-        gl_.GetShaderiv(id, GL_INFO_LOG_LENGTH, &info_log_length);
-        CHECK_GL_ERROR(gl_, GetShaderiv);
+        gl_.ctx.GetShaderiv(id, GL_INFO_LOG_LENGTH, &info_log_length);
+        CHECK_GL_ERROR(gl_.ctx, GetShaderiv);
 
         std::vector<GLchar> info_log(info_log_length);
-        gl_.GetShaderInfoLog(id, info_log_length, nullptr, &info_log[0]);
-        CHECK_GL_ERROR(gl_, GetShaderInfoLog);
+        gl_.ctx.GetShaderInfoLog(id, info_log_length, nullptr, &info_log[0]);
+        CHECK_GL_ERROR(gl_.ctx, GetShaderInfoLog);
         std::string info_log_str = std::string(&info_log[0]);
 
         MIZU_LOG_ERROR("Failed to compile {} shader id={}: {}", shader_type_str(type), id, info_log_str);
@@ -390,37 +445,305 @@ bool ShaderBuilder::try_compile_(GLuint id, ShaderType type, const std::string &
     return true;
 }
 
-bool ShaderBuilder::try_link_(GLuint id) const {
-    gl_.LinkProgram(id);
-    CHECK_GL_ERROR(gl_, LinkProgram);
-
+bool PendingShader::check_link_() const {
     int success;
-    gl_.GetProgramiv(id, GL_LINK_STATUS, &success);
-    CHECK_GL_ERROR(gl_, GetProgramiv);
+    gl_.ctx.GetProgramiv(program_id_, GL_LINK_STATUS, &success);
+    CHECK_GL_ERROR(gl_.ctx, GetProgramiv);
 
     if (!success) {
         int info_log_length;
-        gl_.GetProgramiv(id, GL_INFO_LOG_LENGTH, &info_log_length);
-        CHECK_GL_ERROR(gl_, GetProgramiv);
+        gl_.ctx.GetProgramiv(program_id_, GL_INFO_LOG_LENGTH, &info_log_length);
+        CHECK_GL_ERROR(gl_.ctx, GetProgramiv);
 
         std::vector<GLchar> info_log(info_log_length);
-        gl_.GetProgramInfoLog(id, info_log_length, nullptr, &info_log[0]);
-        CHECK_GL_ERROR(gl_, GetProgramInfoLog);
+        gl_.ctx.GetProgramInfoLog(program_id_, info_log_length, nullptr, &info_log[0]);
+        CHECK_GL_ERROR(gl_.ctx, GetProgramInfoLog);
         std::string info_log_str = std::string(&info_log[0]);
 
-        MIZU_LOG_ERROR("Failed to link shader program id={}: {}", id, info_log_str);
+        MIZU_LOG_ERROR("Failed to link shader program id={}: {}", program_id_, info_log_str);
         return false;
     }
 
-    MIZU_LOG_TRACE("Successfully linked shader program id={}", id);
+    MIZU_LOG_TRACE("Successfully linked shader program id={}", program_id_);
     return true;
 }
 
-void ShaderBuilder::delete_stages_() {
-    for (auto &[id, type, src]: stages_) {
-        gl_.DeleteShader(id);
-        CHECK_GL_ERROR(gl_, DeleteShader);
+void PendingShader::store_binary_() const {
+    if (!cache_ || !cache_->enabled())
+        return;
+
+    GLint length = 0;
+    gl_.ctx.GetProgramiv(program_id_, GL_PROGRAM_BINARY_LENGTH, &length);
+    CHECK_GL_ERROR(gl_.ctx, GetProgramiv);
+    if (length <= 0)
+        return;
+
+    ProgramBinary binary{0, std::vector<std::byte>(length)};
+    gl_.ctx.GetProgramBinary(program_id_, length, nullptr, &binary.format, binary.bytes.data());
+    CHECK_GL_ERROR(gl_.ctx, GetProgramBinary);
+
+    cache_->store(key_, binary);
+}
+
+void PendingShader::delete_stages_() {
+    for (const auto &[id, type]: stages_) {
+        if (program_id_ != 0) {
+            gl_.ctx.DetachShader(program_id_, id);
+            CHECK_GL_ERROR(gl_.ctx, DetachShader);
+        }
+        gl_.ctx.DeleteShader(id);
+        CHECK_GL_ERROR(gl_.ctx, DeleteShader);
         MIZU_LOG_TRACE("Deleted {} shader id={}", shader_type_str(type), id);
     }
+    stages_.clear();
+}
+
+void PendingShader::delete_program_() {
+    if (program_id_ != 0) {
+        gl_.ctx.DeleteProgram(program_id_);
+        CHECK_GL_ERROR(gl_.ctx, DeleteProgram);
+        MIZU_LOG_TRACE("Deleted shader program id={}", program_id_);
+        program_id_ = 0;
+    }
+}
+
+ShaderBuilder::ShaderBuilder(Context &gl)
+    : gl_(gl), cache_(&gl.program_cache) {}
+
+ShaderBuilder &ShaderBuilder::stage_src(ShaderType type, const std::string &src) {
+    stages_.emplace_back(type, src);
+    return *this;
+}
+
+ShaderBuilder &ShaderBuilder::define(const std::string &name, const std::string &value) {
+    defines_.emplace_back(name, value);
+    return *this;
+}
+
+ShaderBuilder &ShaderBuilder::defines(const ShaderDefines &defines) {
+    defines_.insert(defines_.end(), defines.begin(), defines.end());
+    return *this;
+}
+
+ShaderBuilder &ShaderBuilder::include(const std::string &name, const std::string &src) {
+    includes_[name] = src;
+    return *this;
+}
+
+std::unique_ptr<Shader> ShaderBuilder::link() {
+    return link_async().finish();
+}
+
+PendingShader ShaderBuilder::link_async() {
+    std::vector<std::pair<ShaderType, std::string>> sources{};
+    sources.reserve(stages_.size());
+    for (const auto &[type, src]: stages_)
+        sources.emplace_back(type, preprocess_(src));
+
+    // Keyed on the preprocessed sources so every permutation gets its own entry
+    const bool use_cache = cache_ && cache_->enabled();
+    const auto key = use_cache ? cache_key_(sources) : 0;
+
+    if (use_cache) {
+        if (auto program_id = try_load_binary_(key))
+            return PendingShader(gl_, cache_, key, *program_id, {}, true);
+    }
+
+    GLuint program_id = gl_.ctx.CreateProgram();
+    CHECK_GL_ERROR(gl_.ctx, CreateProgram);
+    MIZU_LOG_TRACE("Created shader program id={}", program_id);
+
+    // Compile and link without querying any status so the driver is free to
+    // work on this program while the caller issues others
+    std::vector<std::pair<GLuint, ShaderType>> stage_ids{};
+    for (const auto &[type, src]: sources) {
+        GLuint id = gl_.ctx.CreateShader(unwrap(type));
+        CHECK_GL_ERROR(gl_.ctx, CreateShader);
+        MIZU_LOG_TRACE("Created {} shader id={}", shader_type_str(type), id);
+
+        auto src_p = src.c_str();
+        gl_.ctx.ShaderSource(id, 1, &src_p, nullptr);
+        CHECK_GL_ERROR(gl_.ctx, ShaderSource);
+        gl_.ctx.CompileShader(id);
+        CHECK_GL_ERROR(gl_.ctx, CompileShader);
+
+        gl_.ctx.AttachShader(program_id, id);
+        CHECK_GL_ERROR(gl_.ctx, AttachShader);
+
+        stage_ids.emplace_back(id, type);
+    }
+
+    if (use_cache) {
+        gl_.ctx.ProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        CHECK_GL_ERROR(gl_.ctx, ProgramParameteri);
+    }
+
+    gl_.ctx.LinkProgram(program_id);
+    CHECK_GL_ERROR(gl_.ctx, LinkProgram);
+
+    return PendingShader(gl_, cache_, key, program_id, std::move(stage_ids), false);
+}
+
+std::string ShaderBuilder::preprocess_(const std::string &src) const {
+    if (defines_.empty() && includes_.empty())
+        return src;
+
+    std::string expanded{};
+    expand_includes_(src, expanded, 0);
+
+    // #version has to stay the first statement, so defines go right after it
+    std::size_t insert_at = 0;
+    if (const auto version = expanded.find("#version"); version != std::string::npos) {
+        const auto eol = expanded.find('\n', version);
+        insert_at = eol == std::string::npos ? expanded.size() : eol + 1;
+    }
+
+    std::string define_block{};
+    for (const auto &[name, value]: defines_)
+        define_block += value.empty() ? fmt::format("#define {}\n", name) : fmt::format("#define {} {}\n", name, value);
+
+    // Keep compiler error line numbers pointing at the original source
+    const auto version_lines = std::ranges::count(expanded.begin(), expanded.begin() + insert_at, '\n');
+    define_block += fmt::format("#line {}\n", version_lines + 1);
+
+    expanded.insert(insert_at, define_block);
+    return expanded;
+}
+
+void ShaderBuilder::expand_includes_(std::string_view src, std::string &out, std::size_t depth) const {
+    constexpr std::size_t MAX_INCLUDE_DEPTH = 16;
+
+    while (!src.empty()) {
+        const auto eol = src.find('\n');
+        const auto line = src.substr(0, eol);
+        src = eol == std::string_view::npos ? std::string_view() : src.substr(eol + 1);
+
+        const auto first = line.find_first_not_of(" \t");
+        if (first == std::string_view::npos || !line.substr(first).starts_with("#include")) {
+            out += line;
+            out += '\n';
+            continue;
+        }
+
+        const auto open = line.find('"', first);
+        const auto close = open == std::string_view::npos ? open : line.find('"', open + 1);
+        if (close == std::string_view::npos) {
+            MIZU_LOG_ERROR("Malformed shader include '{}'", line);
+            continue;
+        }
+
+        const auto name = std::string(line.substr(open + 1, close - open - 1));
+        const auto it = includes_.find(name);
+        if (it == includes_.end()) {
+            MIZU_LOG_ERROR("Unknown shader include '{}'", name);
+            continue;
+        }
+        if (depth >= MAX_INCLUDE_DEPTH) {
+            MIZU_LOG_ERROR("Shader include '{}' nested too deeply, possible include cycle", name);
+            continue;
+        }
+
+        expand_includes_(it->second, out, depth + 1);
+    }
+}
+
+std::uint64_t ShaderBuilder::cache_key_(const std::vector<std::pair<ShaderType, std::string>> &stages) const {
+    std::vector<std::pair<GLenum, std::string_view>> views{};
+    views.reserve(stages.size());
+    for (const auto &[type, src]: stages)
+        views.emplace_back(unwrap(type), src);
+    return cache_->key(views);
+}
+
+std::optional<GLuint> ShaderBuilder::try_load_binary_(std::uint64_t key) const {
+    const auto binary = cache_->load(key);
+    if (!binary)
+        return std::nullopt;
+
+    GLuint program_id = gl_.ctx.CreateProgram();
+    CHECK_GL_ERROR(gl_.ctx, CreateProgram);
+
+    gl_.ctx.ProgramBinary(program_id, binary->format, binary->bytes.data(), static_cast<GLsizei>(binary->bytes.size()));
+    CHECK_GL_ERROR(gl_.ctx, ProgramBinary);
+
+    // Drivers reject binaries from older versions of themselves through the link status
+
+    int success;
+    gl_.ctx.GetProgramiv(program_id, GL_LINK_STATUS, &success);
+    CHECK_GL_ERROR(gl_.ctx, GetProgramiv);
+
+    if (!success) {
+        MIZU_LOG_DEBUG("Rejected cached program binary {:016x}, recompiling", key);
+        gl_.ctx.DeleteProgram(program_id);
+        CHECK_GL_ERROR(gl_.ctx, DeleteProgram);
+        cache_->evict(key);
+        return std::nullopt;
+    }
+
+    MIZU_LOG_TRACE("Loaded shader program id={} from cached binary {:016x}", program_id, key);
+    return program_id;
+}
+
+ShaderPermutations::ShaderPermutations(Context &gl)
+    : gl_(gl) {}
+
+ShaderPermutations &ShaderPermutations::stage_src(ShaderType type, const std::string &src) {
+    stages_.emplace_back(type, src);
+    return *this;
+}
+
+ShaderPermutations &ShaderPermutations::include(const std::string &name, const std::string &src) {
+    includes_[name] = src;
+    return *this;
+}
+
+void ShaderPermutations::prewarm(std::span<const ShaderDefines> permutations) {
+    std::vector<std::pair<std::string, PendingShader>> pending{};
+    for (const auto &defines: permutations) {
+        auto key = key_(defines);
+        if (shaders_.contains(key)
+            || std::ranges::any_of(pending, [&](const auto &p) { return p.first == key; }))
+            continue;
+        pending.emplace_back(std::move(key), link_async_(defines));
+    }
+
+    for (auto &[key, shader]: pending)
+        shaders_[key] = shader.finish();
+}
+
+Shader *ShaderPermutations::get(const ShaderDefines &defines) {
+    auto key = key_(defines);
+    if (auto it = shaders_.find(key); it != shaders_.end())
+        return it->second.get();
+
+    // Failures are cached too so a broken permutation isn't relinked on every call
+    MIZU_LOG_DEBUG("Linking shader permutation '{}'", key);
+    auto &shader = shaders_[std::move(key)];
+    shader = link_async_(defines).finish();
+    return shader.get();
+}
+
+std::size_t ShaderPermutations::size() const {
+    return shaders_.size();
+}
+
+std::string ShaderPermutations::key_(const ShaderDefines &defines) {
+    auto sorted = defines;
+    std::ranges::sort(sorted);
+
+    std::string key{};
+    for (const auto &[name, value]: sorted)
+        key += value.empty() ? fmt::format("{};", name) : fmt::format("{}={};", name, value);
+    return key;
+}
+
+PendingShader ShaderPermutations::link_async_(const ShaderDefines &defines) const {
+    ShaderBuilder builder(gl_);
+    for (const auto &[type, src]: stages_)
+        builder.stage_src(type, src);
+    for (const auto &[name, src]: includes_)
+        builder.include(name, src);
+    builder.defines(defines);
+    return builder.link_async();
 }
 } // namespace gloo
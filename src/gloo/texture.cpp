@@ -1,74 +1,67 @@
 #include "gloo/texture.hpp"
+#include <algorithm>
+#include <bit>
+#include <utility>
 #include "mizu/core/log.hpp"
 
 namespace gloo {
-Texture::Texture(GladGLContext &gl, const mizu::PngData &data, MinFilter min_filter, MagFilter mag_filter)
-    : gl_(gl) {
-    gl_.GenTextures(1, &id);
-    CHECK_GL_ERROR(gl_, GenTextures);
-    MIZU_LOG_TRACE("Created texture id={}", id);
+bool uses_mipmaps(MinFilter filter) {
+    return filter != MinFilter::Nearest && filter != MinFilter::Linear;
+}
 
-    gl_.ActiveTexture(GL_TEXTURE0);
-    CHECK_GL_ERROR(gl_, ActiveTexture);
-    gl_.BindTexture(GL_TEXTURE_2D, id);
-    CHECK_GL_ERROR(gl_, BindTexture);
-
-    gl_.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    CHECK_GL_ERROR(gl_, TexParameteri);
-    gl_.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    CHECK_GL_ERROR(gl_, TexParameteri);
-    gl_.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, unwrap(min_filter));
-    CHECK_GL_ERROR(gl_, TexParameteri);
-    gl_.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, unwrap(mag_filter));
-    CHECK_GL_ERROR(gl_, TexParameteri);
-
-    gl_.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, data.width, data.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.bytes);
-    CHECK_GL_ERROR(gl_, TexImage2D);
-    gl_.GenerateMipmap(GL_TEXTURE_2D);
-    CHECK_GL_ERROR(gl_, GenerateMipmap);
-
-    gl_.BindTexture(GL_TEXTURE_2D, 0);
-    CHECK_GL_ERROR(gl_, BindTexture);
-}
-
-Texture::Texture(GladGLContext &gl, glm::ivec2 size, MinFilter min_filter, MagFilter mag_filter)
-    : gl_(gl) {
-    gl_.GenTextures(1, &id);
-    CHECK_GL_ERROR(gl_, GenTextures);
-    MIZU_LOG_TRACE("Created texture id={}", id);
+GLsizei full_mip_chain_levels(glm::ivec2 size) {
+    const auto largest = static_cast<unsigned int>(std::max({size.x, size.y, 1}));
+    return static_cast<GLsizei>(std::bit_width(largest));
+}
+
+std::size_t bytes_per_texel(InternalFormat format) {
+    switch (format) {
+    case InternalFormat::R8: return 1;
+    case InternalFormat::Rg8: return 2;
+    case InternalFormat::Rgba8: return 4;
+    case InternalFormat::Srgb8Alpha8: return 4;
+    default: std::unreachable();
+    }
+}
 
-    gl_.ActiveTexture(GL_TEXTURE0);
-    CHECK_GL_ERROR(gl_, ActiveTexture);
-    gl_.BindTexture(GL_TEXTURE_2D, id);
-    CHECK_GL_ERROR(gl_, BindTexture);
+static GLenum pixel_format(InternalFormat format) {
+    switch (format) {
+    case InternalFormat::R8: return GL_RED;
+    case InternalFormat::Rg8: return GL_RG;
+    case InternalFormat::Rgba8: return GL_RGBA;
+    case InternalFormat::Srgb8Alpha8: return GL_RGBA;
+    default: std::unreachable();
+    }
+}
 
-    gl_.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    CHECK_GL_ERROR(gl_, TexParameteri);
-    gl_.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    CHECK_GL_ERROR(gl_, TexParameteri);
-    gl_.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, unwrap(min_filter));
-    CHECK_GL_ERROR(gl_, TexParameteri);
-    gl_.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, unwrap(mag_filter));
-    CHECK_GL_ERROR(gl_, TexParameteri);
+Texture::Texture(Context &gl, const mizu::PngData &data, const TextureDesc &desc)
+    : gl_(gl), size_(data.width, data.height), format_(desc.format), mip_levels_(1) {
+    allocate_(desc);
 
-    gl_.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    CHECK_GL_ERROR(gl_, TexImage2D);
+    // PNG data is always expanded to RGBA, GL converts to the storage format on upload
+    upload_({0, 0}, size_, GL_RGBA, 4, data.bytes);
+    if (mip_levels_ > 1)
+        generate_mipmaps();
+}
 
-    gl_.BindTexture(GL_TEXTURE_2D, 0);
-    CHECK_GL_ERROR(gl_, BindTexture);
+Texture::Texture(Context &gl, glm::ivec2 size, const TextureDesc &desc)
+    : gl_(gl), size_(size), format_(desc.format), mip_levels_(1) {
+    allocate_(desc);
 }
 
 Texture::~Texture() {
     if (id != 0) {
-        gl_.DeleteTextures(1, &id);
-        CHECK_GL_ERROR(gl_, DeleteTextures);
+        gl_.ctx.DeleteTextures(1, &id);
+        CHECK_GL_ERROR(gl_.ctx, DeleteTextures);
+        gl_.forget_texture(id);
         MIZU_LOG_TRACE("Deleted texture id={}", id);
     }
 }
 
 MOVE_CONSTRUCTOR_IMPL(Texture)
-    : id(other.id), gl_(other.gl_) {
+    : id(other.id), gl_(other.gl_), size_(other.size_), format_(other.format_), mip_levels_(other.mip_levels_) {
     other.id = 0;
+    other.size_ = {0, 0};
 }
 
 MOVE_ASSIGN_OP_IMPL(Texture) {
@@ -77,18 +70,147 @@ MOVE_ASSIGN_OP_IMPL(Texture) {
         other.id = 0;
 
         gl_ = other.gl_;
+
+        size_ = other.size_;
+        other.size_ = {0, 0};
+
+        format_ = other.format_;
+        mip_levels_ = other.mip_levels_;
     }
     return *this;
 }
 
-void Texture::write_subimage(glm::ivec2 pos, glm::ivec2 size, const unsigned char *bytes) {
-    gl_.BindTexture(GL_TEXTURE_2D, id);
-    CHECK_GL_ERROR(gl_, BindTexture);
+glm::ivec2 Texture::size() const {
+    return size_;
+}
+
+InternalFormat Texture::format() const {
+    return format_;
+}
+
+GLsizei Texture::mip_levels() const {
+    return mip_levels_;
+}
+
+void Texture::write_subimage(glm::ivec2 pos, glm::ivec2 size, const unsigned char *bytes, GLint row_length) {
+    upload_(pos, size, pixel_format(format_), bytes_per_texel(format_), bytes, row_length);
+}
+
+void Texture::copy_subimage_from(const Texture &src, glm::ivec2 src_pos, glm::ivec2 dst_pos, glm::ivec2 size) {
+    if (size.x <= 0 || size.y <= 0)
+        return;
+
+    gl_.ctx.CopyImageSubData(
+            src.id,
+            GL_TEXTURE_2D,
+            0,
+            src_pos.x,
+            src_pos.y,
+            0,
+            id,
+            GL_TEXTURE_2D,
+            0,
+            dst_pos.x,
+            dst_pos.y,
+            0,
+            size.x,
+            size.y,
+            1);
+    CHECK_GL_ERROR(gl_.ctx, CopyImageSubData);
+}
+
+void Texture::generate_mipmaps() {
+    if (mip_levels_ <= 1)
+        return;
+
+    gl_.ctx.GenerateTextureMipmap(id);
+    CHECK_GL_ERROR(gl_.ctx, GenerateTextureMipmap);
+}
+
+void Texture::bind_image(GLuint unit, ImageAccess access, GLint level) const {
+    const GLenum format = format_ == InternalFormat::Srgb8Alpha8 ? GL_RGBA8 : unwrap(format_);
+    gl_.ctx.BindImageTexture(unit, id, level, GL_FALSE, 0, unwrap(access), format);
+    CHECK_GL_ERROR(gl_.ctx, BindImageTexture);
+}
 
-    gl_.TexSubImage2D(GL_TEXTURE_2D, 0, pos.x, pos.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, bytes);
-    CHECK_GL_ERROR(gl_, TexSubImage2D);
+void Texture::allocate_(const TextureDesc &desc) {
+    if (desc.mip_levels > 0)
+        mip_levels_ = std::min(desc.mip_levels, full_mip_chain_levels(size_));
+    else
+        mip_levels_ = uses_mipmaps(desc.min_filter) ? full_mip_chain_levels(size_) : 1;
 
-    gl_.BindTexture(GL_TEXTURE_2D, 0);
-    CHECK_GL_ERROR(gl_, BindTexture);
+    gl_.ctx.CreateTextures(GL_TEXTURE_2D, 1, &id);
+    CHECK_GL_ERROR(gl_.ctx, CreateTextures);
+    MIZU_LOG_TRACE("Created texture id={}", id);
+
+    gl_.ctx.TextureParameteri(id, GL_TEXTURE_WRAP_S, unwrap(desc.wrap_s));
+    CHECK_GL_ERROR(gl_.ctx, TextureParameteri);
+    gl_.ctx.TextureParameteri(id, GL_TEXTURE_WRAP_T, unwrap(desc.wrap_t));
+    CHECK_GL_ERROR(gl_.ctx, TextureParameteri);
+    gl_.ctx.TextureParameteri(id, GL_TEXTURE_MIN_FILTER, unwrap(desc.min_filter));
+    CHECK_GL_ERROR(gl_.ctx, TextureParameteri);
+    gl_.ctx.TextureParameteri(id, GL_TEXTURE_MAG_FILTER, unwrap(desc.mag_filter));
+    CHECK_GL_ERROR(gl_.ctx, TextureParameteri);
+    gl_.ctx.TextureParameteri(id, GL_TEXTURE_MAX_LEVEL, mip_levels_ - 1);
+    CHECK_GL_ERROR(gl_.ctx, TextureParameteri);
+
+    const GLint swizzle[4] = {
+            static_cast<GLint>(unwrap(desc.swizzle.r)),
+            static_cast<GLint>(unwrap(desc.swizzle.g)),
+            static_cast<GLint>(unwrap(desc.swizzle.b)),
+            static_cast<GLint>(unwrap(desc.swizzle.a))};
+    gl_.ctx.TextureParameteriv(id, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    CHECK_GL_ERROR(gl_.ctx, TextureParameteriv);
+
+    // Immutable storage can't be zero sized, leave the texture incomplete instead
+    if (size_.x > 0 && size_.y > 0) {
+        gl_.ctx.TextureStorage2D(id, mip_levels_, unwrap(format_), size_.x, size_.y);
+        CHECK_GL_ERROR(gl_.ctx, TextureStorage2D);
+        MIZU_LOG_TRACE(
+                "Allocated texture storage id={} size={}x{} format={:#x} levels={}",
+                id,
+                size_.x,
+                size_.y,
+                unwrap(format_),
+                mip_levels_);
+    } else
+        MIZU_LOG_ERROR("Texture id={} has empty size {}x{}, storage not allocated", id, size_.x, size_.y);
+}
+
+void Texture::upload_(
+        glm::ivec2 pos,
+        glm::ivec2 size,
+        GLenum pixel_format,
+        std::size_t texel_size,
+        const void *bytes,
+        GLint row_length) {
+    if (size.x <= 0 || size.y <= 0 || bytes == nullptr)
+        return;
+
+    if (row_length != 0) {
+        gl_.ctx.PixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+        CHECK_GL_ERROR(gl_.ctx, PixelStorei);
+    }
+
+    // Rows of narrow single/dual channel data aren't 4-byte aligned
+    const bool unaligned = texel_size % 4 != 0;
+    if (unaligned) {
+        gl_.ctx.PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        CHECK_GL_ERROR(gl_.ctx, PixelStorei);
+    }
+
+    gl_.ctx.TextureSubImage2D(id, 0, pos.x, pos.y, size.x, size.y, pixel_format, GL_UNSIGNED_BYTE, bytes);
+    CHECK_GL_ERROR(gl_.ctx, TextureSubImage2D);
+    gl_.count_upload(static_cast<std::size_t>(size.x) * size.y * texel_size);
+
+    if (unaligned) {
+        gl_.ctx.PixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        CHECK_GL_ERROR(gl_.ctx, PixelStorei);
+    }
+
+    if (row_length != 0) {
+        gl_.ctx.PixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        CHECK_GL_ERROR(gl_.ctx, PixelStorei);
+    }
 }
 } // namespace gloo
@@ -3,15 +3,19 @@
 namespace gloo {
 VertexArray::~VertexArray() {
     if (id != 0) {
-        gl_.DeleteVertexArrays(1, &id);
-        CHECK_GL_ERROR(gl_, DeleteVertexArrays);
+        gl_.ctx.DeleteVertexArrays(1, &id);
+        CHECK_GL_ERROR(gl_.ctx, DeleteVertexArrays);
+        gl_.forget_vertex_array(id);
         MIZU_LOG_TRACE("Deleted vertex array id={}", id);
     }
 }
 
 MOVE_CONSTRUCTOR_IMPL(VertexArray)
-    : id(other.id), gl_(other.gl_) {
+    : id(other.id),
+      gl_(other.gl_),
+      strides_(std::move(other.strides_)) {
     other.id = 0;
+    other.strides_.clear();
 }
 
 MOVE_ASSIGN_OP_IMPL(VertexArray) {
@@ -20,38 +24,51 @@ MOVE_ASSIGN_OP_IMPL(VertexArray) {
         other.id = 0;
 
         gl_ = other.gl_;
+
+        std::swap(strides_, other.strides_);
+        other.strides_.clear();
     }
     return *this;
 }
 
 void VertexArray::bind() {
-    gl_.BindVertexArray(id);
-    CHECK_GL_ERROR(gl_, BindVertexArray);
+    gl_.bind_vertex_array(id);
 }
 
 void VertexArray::unbind() {
-    gl_.BindVertexArray(0);
-    CHECK_GL_ERROR(gl_, BindVertexArray);
+    gl_.bind_vertex_array(0);
+}
+
+// Not cached by buffer name, a deleted buffer's name can be handed straight to a new one
+void VertexArray::vertex_buffer(GLuint binding, const Buffer &buf, GLintptr offset) {
+    assert(binding < strides_.size());
+    gl_.ctx.VertexArrayVertexBuffer(id, binding, buf.id, offset, strides_[binding]);
+    CHECK_GL_ERROR(gl_.ctx, VertexArrayVertexBuffer);
 }
 
+// Leaves the VAO bound, the next draw with the same VAO skips the rebind
 void VertexArray::draw_arrays(DrawMode mode, std::size_t first, std::size_t count) {
     bind();
-    gl_.DrawArrays(unwrap(mode), first, count);
-    CHECK_GL_ERROR(gl_, DrawArrays);
-    unbind();
+    gl_.ctx.DrawArrays(unwrap(mode), first, count);
+    CHECK_GL_ERROR(gl_.ctx, DrawArrays);
+    gl_.count_draw(count);
 }
 
-VertexArray::VertexArray(GladGLContext &gl, GLuint id)
-    : id(id), gl_(gl) {}
+void VertexArray::draw_arrays_instanced(DrawMode mode, std::size_t first, std::size_t count, std::size_t instances) {
+    bind();
+    gl_.ctx.DrawArraysInstanced(unwrap(mode), first, count, instances);
+    CHECK_GL_ERROR(gl_.ctx, DrawArraysInstanced);
+    gl_.count_draw(count * instances);
+}
 
-VertexArrayBuilder::VertexArrayBuilder(GladGLContext &gl)
+VertexArray::VertexArray(Context &gl, GLuint id, std::vector<GLsizei> strides)
+    : id(id), gl_(gl), strides_(std::move(strides)) {}
+
+VertexArrayBuilder::VertexArrayBuilder(Context &gl)
     : gl_(gl) {
-    gl_.GenVertexArrays(1, &id_);
-    CHECK_GL_ERROR(gl_, GenVertexArrays);
+    gl_.ctx.CreateVertexArrays(1, &id_);
+    CHECK_GL_ERROR(gl_.ctx, CreateVertexArrays);
     MIZU_LOG_TRACE("Created vertex array id={}", id_);
-
-    gl_.BindVertexArray(id_);
-    CHECK_GL_ERROR(gl_, BindVertexArray);
 }
 
 VertexArrayBuilder &VertexArrayBuilder::with(Shader *shader) {
@@ -61,9 +78,10 @@ VertexArrayBuilder &VertexArrayBuilder::with(Shader *shader) {
 }
 
 VertexArrayBuilder &VertexArrayBuilder::vec(const std::string &name, GLint size, bool normalized) {
-    GLsizei offset = 0;
-    for (const auto &attrib_info: attrib_info_buf_)
-        offset += attrib_info.size;
+    assert(current_binding_.has_value());
+
+    const GLuint offset = current_offset_;
+    current_offset_ += size;
 
     if (auto loc = attrib_lookup_->attrib_location(name); loc)
         attrib_info_buf_.emplace_back(*loc, size, current_buf_type_, normalized ? GL_TRUE : GL_FALSE, offset);
@@ -73,48 +91,67 @@ VertexArrayBuilder &VertexArrayBuilder::vec(const std::string &name, GLint size,
 
 std::unique_ptr<VertexArray> VertexArrayBuilder::build() {
     flush_();
+    return std::unique_ptr<VertexArray>(new VertexArray(gl_, id_, std::move(strides_)));
+}
 
-    gl_.BindVertexArray(0);
-    CHECK_GL_ERROR(gl_, BindVertexArray);
-    return std::unique_ptr<VertexArray>(new VertexArray(gl_, id_));
+void VertexArrayBuilder::begin_binding_(const Buffer *buf, GLsizei item_size, GLenum type, GLuint divisor) {
+    flush_();
+
+    current_binding_ = current_binding_ ? *current_binding_ + 1 : 0;
+    current_buf_ = buf;
+    current_buf_item_size_ = item_size;
+    current_buf_type_ = type;
+    current_divisor_ = divisor;
 }
 
 void VertexArrayBuilder::flush_() {
-    if (attrib_info_buf_.empty())
+    if (!current_binding_ || strides_.size() > *current_binding_)
         return;
 
-    GLsizei stride = 0;
-    for (const auto &attrib_info: attrib_info_buf_)
-        stride += attrib_info.size;
+    // Every attribute declared with vec() counts towards the stride, even ones the shader optimized out
+    const GLsizei stride = static_cast<GLsizei>(current_offset_) * current_buf_item_size_;
+    strides_.push_back(stride);
 
     for (const auto &attrib_info: attrib_info_buf_) {
         MIZU_LOG_TRACE(
-                "VertexAttribPointer: index={} size={} type={} normalized={} stride={} offset={}",
+                "VertexArrayAttribFormat: binding={} index={} size={} type={} normalized={} stride={} offset={}",
+                *current_binding_,
                 attrib_info.index,
                 attrib_info.size,
                 attrib_info.type,
                 attrib_info.normalized,
-                stride * current_buf_item_size_,
+                stride,
                 attrib_info.offset * current_buf_item_size_
         );
 
-        gl_.VertexAttribPointer(
+        gl_.ctx.EnableVertexArrayAttrib(id_, attrib_info.index);
+        CHECK_GL_ERROR(gl_.ctx, EnableVertexArrayAttrib);
+        gl_.ctx.VertexArrayAttribFormat(
+                id_,
                 attrib_info.index,
                 attrib_info.size,
                 attrib_info.type,
                 attrib_info.normalized,
-                stride * current_buf_item_size_,
-                reinterpret_cast<void *>(static_cast<uintptr_t>(attrib_info.offset * current_buf_item_size_))
+                attrib_info.offset * current_buf_item_size_
         );
-        CHECK_GL_ERROR(gl_, VertexAttribPointer);
-        gl_.EnableVertexAttribArray(attrib_info.index);
-        CHECK_GL_ERROR(gl_, EnableVertexAttribArray);
+        CHECK_GL_ERROR(gl_.ctx, VertexArrayAttribFormat);
+        gl_.ctx.VertexArrayAttribBinding(id_, attrib_info.index, *current_binding_);
+        CHECK_GL_ERROR(gl_.ctx, VertexArrayAttribBinding);
     }
 
-    attrib_info_buf_.clear();
-    if (current_target_) {
-        gl_.BindBuffer(unwrap(*current_target_), 0);
-        CHECK_GL_ERROR(gl_, BindBuffer);
+    if (current_buf_) {
+        gl_.ctx.VertexArrayVertexBuffer(id_, *current_binding_, current_buf_->id, 0, stride);
+        CHECK_GL_ERROR(gl_.ctx, VertexArrayVertexBuffer);
     }
+
+    if (current_divisor_ != 0) {
+        gl_.ctx.VertexArrayBindingDivisor(id_, *current_binding_, current_divisor_);
+        CHECK_GL_ERROR(gl_.ctx, VertexArrayBindingDivisor);
+    }
+
+    attrib_info_buf_.clear();
+    current_buf_ = nullptr;
+    current_offset_ = 0;
+    current_divisor_ = 0;
 }
 } // namespace gloo
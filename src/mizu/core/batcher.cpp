@@ -1,106 +1,70 @@
 #include "mizu/core/batcher.hpp"
+#include <algorithm>
+#include <glm/common.hpp>
+#include <limits>
+#include "mizu/core/draw_recorder.hpp"
 #include "mizu/util/io.hpp"
 
-const auto POINTS_VERT_SRC = R"glsl(
-#version 330 core
-in vec3 pos;
-in vec4 color;
-
-out vec4 out_color;
-
-uniform mat4 proj;
-
-void main() {
-    out_color = color;
-
-    float z = -1.0 / pos.z;
-    gl_Position = proj * vec4(pos.x + 0.5, pos.y + 0.5, z, 1.0);
-}
-)glsl";
-
-const auto POINTS_FRAG_SRC = R"glsl(
-#version 330 core
-in vec4 out_color;
-
-out vec4 FragColor;
-
-void main() {
-    FragColor = out_color;
-}
+const auto FRAME_BLOCK_SRC = R"glsl(
+layout(std140) uniform Frame {
+    mat4 proj;
+    mat4 view;
+    vec4 viewport;
+    float time;
+};
 )glsl";
 
-const auto LINES_VERT_SRC = R"glsl(
-#version 330 core
-in vec3 pos;
-in vec4 color;
-in vec3 rot_params;
-
-out vec4 out_color;
-
-uniform mat4 proj;
-
-void main() {
-    out_color = color;
-
+// rot_params is (pivot x, pivot y, angle in radians)
+const auto ROTATION_SRC = R"glsl(
+mat4 rotation(vec3 rot_params) {
     float c = cos(rot_params.z);
     float s = sin(rot_params.z);
     float xtr = -rot_params.x * c + rot_params.y * s + rot_params.x;
     float ytr = -rot_params.x * s - rot_params.y * c + rot_params.y;
 
-    mat4 rot = mat4(
+    return mat4(
         vec4( c,   s,   0.0, 0.0),
         vec4(-s,   c,   0.0, 0.0),
         vec4( 0.0, 0.0, 1.0, 0.0),
         vec4( xtr, ytr, 0.0, 1.0)
     );
-
-    float z = -1.0 / pos.z;
-    gl_Position = proj * rot * vec4(pos.x + 0.5, pos.y + 0.5, z, 1.0);
 }
 )glsl";
 
-const auto LINES_FRAG_SRC = R"glsl(
-#version 330 core
-in vec4 out_color;
-
-out vec4 FragColor;
-
-void main() {
-    FragColor = out_color;
-}
-)glsl";
-
-const auto TRIS_VERT_SRC = R"glsl(
+// Points, lines and triangles. PIXEL_CENTER offsets to the middle of the pixel
+// so single pixel primitives land where expected, ROTATED adds rot_params.
+const auto PRIM_VERT_SRC = R"glsl(
 #version 330 core
 in vec3 pos;
 in vec4 color;
+#ifdef ROTATED
 in vec3 rot_params;
+#endif
 
 out vec4 out_color;
 
-uniform mat4 proj;
+#include "frame"
+#include "rotation"
 
 void main() {
     out_color = color;
 
-    float c = cos(rot_params.z);
-    float s = sin(rot_params.z);
-    float xtr = -rot_params.x * c + rot_params.y * s + rot_params.x;
-    float ytr = -rot_params.x * s - rot_params.y * c + rot_params.y;
-
-    mat4 rot = mat4(
-        vec4( c,   s,   0.0, 0.0),
-        vec4(-s,   c,   0.0, 0.0),
-        vec4( 0.0, 0.0, 1.0, 0.0),
-        vec4( xtr, ytr, 0.0, 1.0)
-    );
-
     float z = -1.0 / pos.z;
-    gl_Position = proj * rot * vec4(pos.xy, z, 1.0);
+#ifdef PIXEL_CENTER
+    vec4 p = vec4(pos.x + 0.5, pos.y + 0.5, z, 1.0);
+#else
+    vec4 p = vec4(pos.xy, z, 1.0);
+#endif
+
+#ifdef ROTATED
+    gl_Position = proj * view * rotation(rot_params) * p;
+#else
+    gl_Position = proj * view * p;
+#endif
 }
 )glsl";
 
-const auto TRIS_FRAG_SRC = R"glsl(
+const auto PRIM_FRAG_SRC = R"glsl(
 #version 330 core
 in vec4 out_color;
 
@@ -115,32 +79,27 @@ const auto TEX_VERT_SRC = R"glsl(
 #version 330 core
 in vec3 pos;
 in vec4 color;
+#ifdef ROTATED
 in vec3 rot_params;
+#endif
 in vec2 tex_coord;
 
 out vec4 out_color;
 out vec2 out_tex_coord;
 
-uniform mat4 proj;
+#include "frame"
+#include "rotation"
 
 void main() {
     out_color = color;
     out_tex_coord = tex_coord;
 
-    float c = cos(rot_params.z);
-    float s = sin(rot_params.z);
-    float xtr = -rot_params.x * c + rot_params.y * s + rot_params.x;
-    float ytr = -rot_params.x * s - rot_params.y * c + rot_params.y;
-
-    mat4 rot = mat4(
-        vec4(c, s, 0.0, 0.0),
-        vec4(-s, c, 0.0, 0.0),
-        vec4(0.0, 0.0, 1.0, 0.0),
-        vec4(xtr, ytr, 0.0, 1.0)
-    );
-
     float z = -1.0 / pos.z;
-    gl_Position = proj * rot * vec4(pos.xy, z, 1.0);
+#ifdef ROTATED
+    gl_Position = proj * view * rotation(rot_params) * vec4(pos.xy, z, 1.0);
+#else
+    gl_Position = proj * view * vec4(pos.xy, z, 1.0);
+#endif
 }
 )glsl";
 
@@ -154,68 +113,69 @@ out vec4 FragColor;
 uniform sampler2D tex;
 
 void main() {
+#ifdef SDF
+    // Distance is in alpha with 0.5 on the edge, fwidth keeps the ramp about a pixel wide at any scale
+    float d = texture(tex, out_tex_coord).a;
+    float w = max(fwidth(d), 1e-4);
+    FragColor = vec4(out_color.rgb, out_color.a * smoothstep(0.5 - w, 0.5 + w, d));
+#else
     FragColor = out_color * texture(tex, out_tex_coord);
+#endif
 }
 )glsl";
 
 namespace mizu {
-constexpr std::size_t vertex_size_map[4] = {7, 10, 10, 12};
-
-constexpr std::size_t vertices_per_obj_map[4] = {1, 2, 3, 6};
+constexpr std::size_t vertices_per_obj_map[BATCH_TYPE_COUNT] = {1, 2, 3, 6, 2, 3, 6, 6};
 
 constexpr auto MB = static_cast<std::size_t>(8e6);
-constexpr std::size_t batch_capacity_map[4] = {
-        MB / (32 * vertex_size_map[unwrap(BatchType::Points)] * vertices_per_obj_map[unwrap(BatchType::Points)]),
-        MB / (32 * vertex_size_map[unwrap(BatchType::Lines)] * vertices_per_obj_map[unwrap(BatchType::Lines)]),
-        MB / (32 * vertex_size_map[unwrap(BatchType::Triangles)] * vertices_per_obj_map[unwrap(BatchType::Triangles)]),
-        MB / (32 * vertex_size_map[unwrap(BatchType::Tex)] * vertices_per_obj_map[unwrap(BatchType::Tex)])};
+constexpr std::size_t batch_capacity(BatchType type) {
+    return MB / (32 * BATCH_VERTEX_SIZE[unwrap(type)] * vertices_per_obj_map[unwrap(type)]);
+}
 
-constexpr gloo::DrawMode draw_mode_map[4] = {
-        gloo::DrawMode::Points, gloo::DrawMode::Lines, gloo::DrawMode::Triangles, gloo::DrawMode::Triangles};
+constexpr gloo::DrawMode draw_mode_map[BATCH_TYPE_COUNT] = {
+        gloo::DrawMode::Points,
+        gloo::DrawMode::Lines,
+        gloo::DrawMode::Triangles,
+        gloo::DrawMode::Triangles,
+        gloo::DrawMode::Lines,
+        gloo::DrawMode::Triangles,
+        gloo::DrawMode::Triangles,
+        gloo::DrawMode::Triangles};
 
-Batch::Batch(gloo::Context &gl, BatchType type, gloo::Shader *shader, std::size_t capacity, gloo::FillMode fill_mode) {
-    vertex_size = vertex_size_map[unwrap(type)];
-    vbo = std::make_unique<gloo::StaticSizeBuffer<float>>(
-            gl.ctx, vertex_size * vertices_per_obj_map[unwrap(type)] * capacity, fill_mode);
-
-    switch (type) {
-    case BatchType::Points:
-        vao = gloo::VertexArrayBuilder(gl.ctx)
-                      .with(shader)
-                      .with(vbo.get(), gloo::BufferTarget::Array)
-                      .vec("pos", 3)
-                      .vec("color", 4)
-                      .build();
-        break;
-    case BatchType::Lines:
-        vao = gloo::VertexArrayBuilder(gl.ctx)
-                      .with(shader)
-                      .with(vbo.get(), gloo::BufferTarget::Array)
-                      .vec("pos", 3)
-                      .vec("color", 4)
-                      .vec("rot_params", 3)
-                      .build();
-        break;
-    case BatchType::Triangles:
-        vao = gloo::VertexArrayBuilder(gl.ctx)
-                      .with(shader)
-                      .with(vbo.get(), gloo::BufferTarget::Array)
-                      .vec("pos", 3)
-                      .vec("color", 4)
-                      .vec("rot_params", 3)
-                      .build();
-        break;
-    case BatchType::Tex:
-        vao = gloo::VertexArrayBuilder(gl.ctx)
-                      .with(shader)
-                      .with(vbo.get(), gloo::BufferTarget::Array)
-                      .vec("pos", 3)
-                      .vec("color", 4)
-                      .vec("rot_params", 3)
-                      .vec("tex_coord", 2)
-                      .build();
-        break;
+constexpr bool rotated_map[BATCH_TYPE_COUNT] = {false, true, true, true, false, false, false, false};
+
+constexpr bool textured_map[BATCH_TYPE_COUNT] = {false, false, false, true, false, false, true, true};
+
+constexpr bool pixel_center_map[BATCH_TYPE_COUNT] = {true, true, false, false, true, false, false, false};
+
+constexpr bool sdf_map[BATCH_TYPE_COUNT] = {false, false, false, false, false, false, false, true};
+
+enum class ClipTest { Outside, Inside, Straddles };
+
+ClipTest clip_test(std::span<const float> vertex_data, std::size_t vertex_size, const glm::vec4 &clip) {
+    glm::vec2 lo{std::numeric_limits<float>::max()};
+    glm::vec2 hi{std::numeric_limits<float>::lowest()};
+    for (std::size_t i = 0; i + 1 < vertex_data.size(); i += vertex_size) {
+        const glm::vec2 p{vertex_data[i], vertex_data[i + 1]};
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
     }
+
+    // Points and lines are offset half a pixel and rasterize a pixel wide
+    lo -= 1.0f;
+    hi += 1.0f;
+
+    if (hi.x <= clip.x || hi.y <= clip.y || lo.x >= clip.z || lo.y >= clip.w)
+        return ClipTest::Outside;
+    if (lo.x >= clip.x && lo.y >= clip.y && hi.x <= clip.z && hi.y <= clip.w)
+        return ClipTest::Inside;
+    return ClipTest::Straddles;
+}
+
+Batch::Batch(gloo::Context &gl, BatchType type, std::size_t capacity, gloo::FillMode fill_mode) {
+    vertex_size = BATCH_VERTEX_SIZE[unwrap(type)];
+    vbo = std::make_unique<gloo::StaticSizeBuffer<float>>(
+            gl, vertex_size * vertices_per_obj_map[unwrap(type)] * capacity, fill_mode);
 }
 
 void BatchListBase::cleanup_unused_() {
@@ -236,31 +196,31 @@ void BatchListBase::cleanup_unused_() {
     last_batch_count_ = active_idx_ + 1;
 }
 
-void OpaqueBatchList::add(const std::initializer_list<float> vertex_data) {
+void OpaqueBatchList::add(std::span<const float> vertex_data) {
     if (batches_.empty()) {
-        batches_.emplace_back(gl_, type_, shader_, batch_capacity_map[unwrap(type_)], fill_mode_);
+        batches_.emplace_back(gl_, type_, batch_capacity(type_), fill_mode_);
     } else if (!batches_[active_idx_].vbo->has_room_for(vertex_data.size())) {
         active_idx_++;
         if (active_idx_ >= batches_.size())
-            batches_.emplace_back(gl_, type_, shader_, batch_capacity_map[unwrap(type_)], fill_mode_);
+            batches_.emplace_back(gl_, type_, batch_capacity(type_), fill_mode_);
     }
 
     assert(vertex_data.size() % batches_[active_idx_].vertex_size == 0);
     batches_[active_idx_].vbo->push(vertex_data);
 }
 
-void OpaqueBatchList::draw(const glm::mat4 &projection) {
+void OpaqueBatchList::draw() {
     if (batches_.empty())
         return;
 
     shader_->use();
-    shader_->uniform("proj", projection);
 
     for (std::size_t i = active_idx_ + 1; i-- > 0;) {
         auto &batch = batches_[i];
 
-        batch.vbo->sync_gl(gloo::BufferTarget::Array);
-        batch.vao->draw_arrays(
+        batch.vbo->sync_gl();
+        vao_->vertex_buffer(0, *batch.vbo);
+        vao_->draw_arrays(
                 draw_mode_map[unwrap(type_)],
                 batch.vbo->front() / batch.vertex_size,
                 batch.vbo->size() / batch.vertex_size);
@@ -284,37 +244,35 @@ std::vector<TransBatchListDrawParams> TransBatchList::draw_calls() {
     return ret;
 }
 
-void TransBatchList::add(const std::initializer_list<float> vertex_data) {
+void TransBatchList::add(std::span<const float> vertex_data) {
     if (batches_.empty()) {
-        batches_.emplace_back(gl_, type_, shader_, batch_capacity_map[unwrap(type_)], fill_mode_);
-    } else if (batches_[active_idx_].vbo->is_full()) {
+        batches_.emplace_back(gl_, type_, batch_capacity(type_), fill_mode_);
+    } else if (!batches_[active_idx_].vbo->has_room_for(vertex_data.size())) {
         save_draw_call_();
         last_draw_call_offset_ = 0;
 
         active_idx_++;
         if (active_idx_ >= batches_.size())
-            batches_.emplace_back(gl_, type_, shader_, batch_capacity_map[unwrap(type_)], fill_mode_);
+            batches_.emplace_back(gl_, type_, batch_capacity(type_), fill_mode_);
     }
 
     assert(vertex_data.size() % batches_[active_idx_].vertex_size == 0);
     batches_[active_idx_].vbo->push(vertex_data);
 }
 
-void TransBatchList::set_projection_and_sync(const glm::mat4 &projection) {
+void TransBatchList::sync() {
     if (batches_.empty())
         return;
 
-    shader_->use();
-    shader_->uniform("proj", projection);
-
     for (std::size_t i = active_idx_ + 1; i-- > 0;)
-        batches_[i].vbo->sync_gl(gloo::BufferTarget::Array);
+        batches_[i].vbo->sync_gl();
 }
 
 void TransBatchList::draw(std::size_t batch_idx, std::size_t first, std::size_t count) {
     shader_->use();
 
-    batches_[batch_idx].vao->draw_arrays(
+    vao_->vertex_buffer(0, *batches_[batch_idx].vbo);
+    vao_->draw_arrays(
             draw_mode_map[unwrap(type_)],
             first / batches_[batch_idx].vertex_size,
             count / batches_[batch_idx].vertex_size);
@@ -338,75 +296,207 @@ void TransBatchList::save_draw_call_() {
 
 Batcher::Batcher(gloo::Context &ctx)
     : gl_(ctx),
-      shaders_{
-              gloo::ShaderBuilder(gl_.ctx)
-                      .stage_src(gloo::ShaderType::Vertex, POINTS_VERT_SRC)
-                      .stage_src(gloo::ShaderType::Fragment, POINTS_FRAG_SRC)
-                      .link(),
-              gloo::ShaderBuilder(gl_.ctx)
-                      .stage_src(gloo::ShaderType::Vertex, LINES_VERT_SRC)
-                      .stage_src(gloo::ShaderType::Fragment, LINES_FRAG_SRC)
-                      .link(),
-              gloo::ShaderBuilder(gl_.ctx)
-                      .stage_src(gloo::ShaderType::Vertex, TRIS_VERT_SRC)
-                      .stage_src(gloo::ShaderType::Fragment, TRIS_FRAG_SRC)
-                      .link(),
-              gloo::ShaderBuilder(gl_.ctx)
-                      .stage_src(gloo::ShaderType::Vertex, TEX_VERT_SRC)
-                      .stage_src(gloo::ShaderType::Fragment, TEX_FRAG_SRC)
-                      .link(),
-      },
+      prim_shaders_(gl_),
+      tex_shaders_(gl_),
+      shaders_(link_shaders_()),
+      frame_ubo_(gl_),
+      vaos_(build_vertex_arrays_()),
       opaque_batch_lists_{
-              OpaqueBatchList(gl_, BatchType::Points, shaders_[0].get()),
-              OpaqueBatchList(gl_, BatchType::Lines, shaders_[1].get()),
-              OpaqueBatchList(gl_, BatchType::Triangles, shaders_[2].get())},
+              OpaqueBatchList(gl_, BatchType::Points, shaders_[0], vaos_[0].get()),
+              OpaqueBatchList(gl_, BatchType::Lines, shaders_[1], vaos_[1].get()),
+              OpaqueBatchList(gl_, BatchType::Triangles, shaders_[2], vaos_[2].get()),
+              OpaqueBatchList(gl_, BatchType::Tex, shaders_[3], vaos_[3].get()),
+              OpaqueBatchList(gl_, BatchType::LinesUnrotated, shaders_[4], vaos_[4].get()),
+              OpaqueBatchList(gl_, BatchType::TrianglesUnrotated, shaders_[5], vaos_[5].get()),
+              OpaqueBatchList(gl_, BatchType::TexUnrotated, shaders_[6], vaos_[6].get()),
+              OpaqueBatchList(gl_, BatchType::SdfUnrotated, shaders_[7], vaos_[7].get())},
       trans_batch_lists_{
-              TransBatchList(gl_, BatchType::Points, shaders_[0].get()),
-              TransBatchList(gl_, BatchType::Lines, shaders_[1].get()),
-              TransBatchList(gl_, BatchType::Triangles, shaders_[2].get()),
-              TransBatchList(gl_, BatchType::Tex, shaders_[3].get())} {}
+              TransBatchList(gl_, BatchType::Points, shaders_[0], vaos_[0].get()),
+              TransBatchList(gl_, BatchType::Lines, shaders_[1], vaos_[1].get()),
+              TransBatchList(gl_, BatchType::Triangles, shaders_[2], vaos_[2].get()),
+              TransBatchList(gl_, BatchType::Tex, shaders_[3], vaos_[3].get()),
+              TransBatchList(gl_, BatchType::LinesUnrotated, shaders_[4], vaos_[4].get()),
+              TransBatchList(gl_, BatchType::TrianglesUnrotated, shaders_[5], vaos_[5].get()),
+              TransBatchList(gl_, BatchType::TexUnrotated, shaders_[6], vaos_[6].get()),
+              TransBatchList(gl_, BatchType::SdfUnrotated, shaders_[7], vaos_[7].get())} {
+    frame_ubo_.bind_base(FRAME_UNIFORMS_BINDING);
+}
+
+std::array<gloo::Shader *, BATCH_TYPE_COUNT> Batcher::link_shaders_() {
+    prim_shaders_.include("frame", FRAME_BLOCK_SRC)
+            .include("rotation", ROTATION_SRC)
+            .stage_src(gloo::ShaderType::Vertex, PRIM_VERT_SRC)
+            .stage_src(gloo::ShaderType::Fragment, PRIM_FRAG_SRC);
+    tex_shaders_.include("frame", FRAME_BLOCK_SRC)
+            .include("rotation", ROTATION_SRC)
+            .stage_src(gloo::ShaderType::Vertex, TEX_VERT_SRC)
+            .stage_src(gloo::ShaderType::Fragment, TEX_FRAG_SRC);
+
+    std::array<gloo::ShaderDefines, BATCH_TYPE_COUNT> defines{};
+    std::vector<gloo::ShaderDefines> prim_defines{};
+    std::vector<gloo::ShaderDefines> tex_defines{};
+    for (std::size_t i = 0; i < BATCH_TYPE_COUNT; ++i) {
+        if (rotated_map[i])
+            defines[i].emplace_back("ROTATED", "");
+        if (pixel_center_map[i])
+            defines[i].emplace_back("PIXEL_CENTER", "");
+        if (sdf_map[i])
+            defines[i].emplace_back("SDF", "");
+        (textured_map[i] ? tex_defines : prim_defines).push_back(defines[i]);
+    }
+
+    // Types with the same defines share a program, e.g. points and unrotated lines
+    prim_shaders_.prewarm(prim_defines);
+    tex_shaders_.prewarm(tex_defines);
+
+    std::array<gloo::Shader *, BATCH_TYPE_COUNT> shaders{};
+    for (std::size_t i = 0; i < BATCH_TYPE_COUNT; ++i) {
+        shaders[i] = (textured_map[i] ? tex_shaders_ : prim_shaders_).get(defines[i]);
+        if (!shaders[i])
+            continue;
+
+        shaders[i]->uniform_block_binding("Frame", FRAME_UNIFORMS_BINDING);
+        if (textured_map[i])
+            shaders[i]->uniform_handle<int>("tex").set(0);
+    }
+
+    MIZU_LOG_DEBUG(
+            "Linked {} batcher shader permutations for {} batch types",
+            prim_shaders_.size() + tex_shaders_.size(),
+            BATCH_TYPE_COUNT);
+    return shaders;
+}
+
+std::array<std::unique_ptr<gloo::VertexArray>, BATCH_TYPE_COUNT> Batcher::build_vertex_arrays_() {
+    std::array<std::unique_ptr<gloo::VertexArray>, BATCH_TYPE_COUNT> vaos{};
+    for (std::size_t i = 0; i < BATCH_TYPE_COUNT; ++i) {
+        gloo::VertexArrayBuilder builder(gl_);
+        builder.with(shaders_[i]).binding<float>().vec("pos", 3).vec("color", 4);
+        if (rotated_map[i])
+            builder.vec("rot_params", 3);
+        if (textured_map[i])
+            builder.vec("tex_coord", 2);
+        vaos[i] = builder.build();
+    }
+    return vaos;
+}
+
+void Batcher::set_recorder(DrawRecorder *recorder) {
+    recorder_ = recorder;
+}
 
 float Batcher::z() {
     return z_level_++;
 }
 
 void Batcher::add(BatchType type, bool trans, GLuint texture_id, const std::initializer_list<float> vertex_data) {
-    if (trans) {
-        add_trans_(type, texture_id, vertex_data);
+    add(type, trans, texture_id, std::span(vertex_data.begin(), vertex_data.size()));
+}
+
+void Batcher::add(BatchType type, bool trans, GLuint texture_id, std::span<const float> vertex_data) {
+    auto clip_idx = current_clip_idx_();
+    if (clip_idx != NO_CLIP_IDX && !rotated_map[unwrap(type)]) {
+        switch (clip_test(vertex_data, BATCH_VERTEX_SIZE[unwrap(type)], clip_rects_[clip_idx])) {
+        case ClipTest::Outside: culled_++; return;
+        case ClipTest::Inside: clip_idx = NO_CLIP_IDX; break;
+        case ClipTest::Straddles: break;
+        }
+    }
+
+    if (recorder_)
+        recorder_->add(type, trans, texture_id, vertex_data);
+
+    // Opaque lists are drawn in bulk, so clipped adds take the ordered path to carry their scissor
+    if (trans || clip_idx != NO_CLIP_IDX) {
+        add_trans_(type, texture_id, vertex_data, clip_idx);
     } else {
-        assert(type != BatchType::Tex);
+        assert(!textured_map[unwrap(type)]);
         add_opaque_(type, vertex_data);
     }
 }
 
-void Batcher::draw(glm::mat4 projection) {
+void Batcher::push_clip(glm::vec4 rect) {
+    // Nested clips only ever shrink, a disjoint push leaves an empty rect that culls everything
+    if (const auto current = clip()) {
+        rect.x = std::max(rect.x, current->x);
+        rect.y = std::max(rect.y, current->y);
+        rect.z = std::min(rect.z, current->z);
+        rect.w = std::min(rect.w, current->w);
+    }
+    rect.z = std::max(rect.z, rect.x);
+    rect.w = std::max(rect.w, rect.y);
+
+    clip_stack_.push_back(clip_rects_.size());
+    clip_rects_.push_back(rect);
+}
+
+void Batcher::pop_clip() {
+    if (clip_stack_.empty()) {
+        MIZU_LOG_WARN("pop_clip() without a matching push_clip()");
+        return;
+    }
+    clip_stack_.pop_back();
+}
+
+std::optional<glm::vec4> Batcher::clip() const {
+    if (clip_stack_.empty())
+        return std::nullopt;
+    return clip_rects_[clip_stack_.back()];
+}
+
+std::size_t Batcher::culled() const {
+    return culled_;
+}
+
+void Batcher::add_custom(std::function<void()> fn) {
+    flush_trans_draw_calls_();
+    last_trans_batch_list_idx_ = NO_LAST_IDX_;
+
+    saved_trans_draw_calls_.emplace_back(custom_draws_.size(), 0, 0, 0, CUSTOM_LIST_IDX_, current_clip_idx_());
+    custom_draws_.push_back(std::move(fn));
+}
+
+void Batcher::draw(const FrameUniforms &frame) {
+    if (recorder_)
+        recorder_->end_frame(frame);
+
     // Grab any draw calls from the most recent trans batch list
     flush_trans_draw_calls_();
 
+    // Rebound every frame in case another Batcher took the binding point
+    frame_ubo_.bind_base(FRAME_UNIFORMS_BINDING);
+    frame_ubo_.update(frame);
+
     for (auto &list: opaque_batch_lists_)
-        list.draw(projection);
+        list.draw();
 
     gl_.depth_mask(false);
     gl_.enable(gloo::Capability::Blend);
     gl_.blend_func(gloo::BlendFunc::SrcAlpha, gloo::BlendFunc::OneMinusSrcAlpha);
 
     for (auto &list: trans_batch_lists_)
-        list.set_projection_and_sync(projection);
+        list.sync();
 
+    auto applied_clip_idx = NO_CLIP_IDX;
     for (auto &params: saved_trans_draw_calls_) {
-        if (params.texture_id != 0) {
-            gl_.ctx.ActiveTexture(GL_TEXTURE0);
-            CHECK_GL_ERROR(gl_.ctx, ActiveTexture);
-            gl_.ctx.BindTexture(GL_TEXTURE_2D, params.texture_id);
-            CHECK_GL_ERROR(gl_.ctx, ActiveTexture);
+        if (params.clip_idx != applied_clip_idx) {
+            apply_clip_(params.clip_idx, frame);
+            applied_clip_idx = params.clip_idx;
         }
-        trans_batch_lists_[params.list_idx].draw(params.batch_idx, params.first, params.count);
-        if (params.texture_id != 0) {
-            gl_.ctx.BindTexture(GL_TEXTURE_2D, 0);
-            CHECK_GL_ERROR(gl_.ctx, BindTexture);
+
+        if (params.list_idx == CUSTOM_LIST_IDX_) {
+            custom_draws_[params.batch_idx]();
+            continue;
         }
+
+        if (params.texture_id != 0)
+            gl_.bind_texture(0, static_cast<GLuint>(params.texture_id));
+        trans_batch_lists_[params.list_idx].draw(params.batch_idx, params.first, params.count);
     }
 
+    if (applied_clip_idx != NO_CLIP_IDX)
+        gl_.disable(gloo::Capability::ScissorTest);
+
     gl_.depth_mask(true);
     gl_.disable(gloo::Capability::Blend);
 }
@@ -420,22 +510,34 @@ void Batcher::clear() {
     last_trans_batch_list_idx_ = NO_LAST_IDX_;
     last_texture_id_ = NO_LAST_ID_;
     saved_trans_draw_calls_.clear();
+    custom_draws_.clear();
+
+    if (!clip_stack_.empty()) {
+        MIZU_LOG_WARN("{} clip rect(s) still pushed at the end of the frame", clip_stack_.size());
+        clip_stack_.clear();
+    }
+    clip_rects_.clear();
+    last_clip_idx_ = NO_CLIP_IDX;
+    culled_ = 0;
 
     z_level_ = 2.0f;
 }
 
-void Batcher::add_opaque_(BatchType type, const std::initializer_list<float> vertex_data) {
+void Batcher::add_opaque_(BatchType type, std::span<const float> vertex_data) {
     opaque_batch_lists_[unwrap(type)].add(vertex_data);
 }
 
-void Batcher::add_trans_(BatchType type, GLuint texture_id, const std::initializer_list<float> vertex_data) {
+void Batcher::add_trans_(BatchType type, GLuint texture_id, std::span<const float> vertex_data, std::size_t clip_idx) {
     if (last_trans_batch_list_idx_ != unwrap(type))
         flush_trans_draw_calls_();
     else if (last_texture_id_ != NO_LAST_ID_ && last_texture_id_ != texture_id)
         flush_trans_draw_calls_();
+    else if (last_clip_idx_ != clip_idx)
+        flush_trans_draw_calls_();
 
     trans_batch_lists_[unwrap(type)].add(vertex_data);
     last_trans_batch_list_idx_ = unwrap(type);
+    last_clip_idx_ = clip_idx;
 
     if (texture_id != 0)
         last_texture_id_ = texture_id;
@@ -449,9 +551,35 @@ void Batcher::flush_trans_draw_calls_() {
     for (auto &draw_call: new_draw_calls) {
         draw_call.list_idx = last_trans_batch_list_idx_;
         draw_call.texture_id = last_texture_id_;
+        draw_call.clip_idx = last_clip_idx_;
     }
 
     saved_trans_draw_calls_.reserve(saved_trans_draw_calls_.size() + new_draw_calls.size());
     saved_trans_draw_calls_.insert(saved_trans_draw_calls_.end(), new_draw_calls.begin(), new_draw_calls.end());
 }
+
+std::size_t Batcher::current_clip_idx_() const {
+    return clip_stack_.empty() ? NO_CLIP_IDX : clip_stack_.back();
+}
+
+void Batcher::apply_clip_(std::size_t clip_idx, const FrameUniforms &frame) {
+    if (clip_idx == NO_CLIP_IDX) {
+        gl_.disable(gloo::Capability::ScissorTest);
+        return;
+    }
+
+    // Clip rects are in vertex space, the scissor box is in framebuffer pixels
+    const auto &rect = clip_rects_[clip_idx];
+    const auto to_pixels = [&](glm::vec2 p) {
+        const auto ndc = frame.proj * frame.view * glm::vec4(p, 0.0f, 1.0f);
+        return glm::vec2(frame.viewport) + (glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2(frame.viewport.z, frame.viewport.w);
+    };
+    const auto a = to_pixels({rect.x, rect.y});
+    const auto b = to_pixels({rect.z, rect.w});
+    const auto lo = glm::ivec2(glm::floor(glm::min(a, b)));
+    const auto hi = glm::ivec2(glm::ceil(glm::max(a, b)));
+
+    gl_.scissor(lo.x, lo.y, hi.x - lo.x, hi.y - lo.y);
+    gl_.enable(gloo::Capability::ScissorTest);
+}
 } // namespace mizu
@@ -0,0 +1,115 @@
+#include "mizu/core/code_page_437.hpp"
+#include <algorithm>
+#include <array>
+#include "mizu/core/log.hpp"
+#include "mizu/util/utf8.hpp"
+
+namespace mizu {
+// What the bytes outside of printable ASCII show
+constexpr std::array<char16_t, 32> CP437_LOW{
+        0x0000, 0x263a, 0x263b, 0x2665, 0x2666, 0x2663, 0x2660, 0x2022,
+        0x25d8, 0x25cb, 0x25d9, 0x2642, 0x2640, 0x266a, 0x266b, 0x263c,
+        0x25ba, 0x25c4, 0x2195, 0x203c, 0x00b6, 0x00a7, 0x25ac, 0x21a8,
+        0x2191, 0x2193, 0x2192, 0x2190, 0x221f, 0x2194, 0x25b2, 0x25bc,
+};
+constexpr std::array<char16_t, 128> CP437_HIGH{
+        0x00c7, 0x00fc, 0x00e9, 0x00e2, 0x00e4, 0x00e0, 0x00e5, 0x00e7,
+        0x00ea, 0x00eb, 0x00e8, 0x00ef, 0x00ee, 0x00ec, 0x00c4, 0x00c5,
+        0x00c9, 0x00e6, 0x00c6, 0x00f4, 0x00f6, 0x00f2, 0x00fb, 0x00f9,
+        0x00ff, 0x00d6, 0x00dc, 0x00a2, 0x00a3, 0x00a5, 0x20a7, 0x0192,
+        0x00e1, 0x00ed, 0x00f3, 0x00fa, 0x00f1, 0x00d1, 0x00aa, 0x00ba,
+        0x00bf, 0x2310, 0x00ac, 0x00bd, 0x00bc, 0x00a1, 0x00ab, 0x00bb,
+        0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556,
+        0x2555, 0x2563, 0x2551, 0x2557, 0x255d, 0x255c, 0x255b, 0x2510,
+        0x2514, 0x2534, 0x252c, 0x251c, 0x2500, 0x253c, 0x255e, 0x255f,
+        0x255a, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256c, 0x2567,
+        0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256b,
+        0x256a, 0x2518, 0x250c, 0x2588, 0x2584, 0x258c, 0x2590, 0x2580,
+        0x03b1, 0x00df, 0x0393, 0x03c0, 0x03a3, 0x03c3, 0x00b5, 0x03c4,
+        0x03a6, 0x0398, 0x03a9, 0x03b4, 0x221e, 0x03c6, 0x03b5, 0x2229,
+        0x2261, 0x00b1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00f7, 0x2248,
+        0x00b0, 0x2219, 0x00b7, 0x221a, 0x207f, 0x00b2, 0x25a0, 0x00a0,
+};
+// 0x7f, the house
+constexpr char16_t CP437_DEL{0x2302};
+
+CodePage437::CodePage437(G2d &g2d, const Texture &sheet, glm::uvec2 char_size, float scale, std::uint8_t first)
+    : g2d_(g2d), sheet_(sheet), char_size_(char_size), scale_(scale), first_(first), columns_(0), count_(0) {
+    if (char_size.x == 0 || char_size.y == 0) {
+        MIZU_LOG_ERROR("Code page 437 sheet needs a non-zero character size");
+        return;
+    }
+
+    columns_ = static_cast<int>(sheet_.width()) / static_cast<int>(char_size.x);
+    count_ = columns_ * (static_cast<int>(sheet_.height()) / static_cast<int>(char_size.y));
+    if (count_ < 256 - first_)
+        MIZU_LOG_DEBUG("Code page 437 sheet stops at {:#x}", first_ + count_ - 1);
+}
+
+glm::vec2 CodePage437::char_size() const {
+    return char_size_ * scale_;
+}
+
+glm::vec2 CodePage437::calc_size(std::string_view text) const {
+    glm::vec2 size{0.0f, 1.0f};
+    float curr_line_w = 0.0f;
+    for (const auto cp: Utf8View(text)) {
+        if (cp == '\r')
+            continue;
+
+        if (cp == '\n') {
+            size.y += 1.0f;
+            size.x = std::max(size.x, curr_line_w);
+            curr_line_w = 0.0f;
+            continue;
+        }
+
+        curr_line_w += 1.0f;
+    }
+    size.x = std::max(size.x, curr_line_w);
+
+    return text.empty() ? glm::vec2(0.0f) : size * char_size();
+}
+
+void CodePage437::draw(std::string_view text, glm::vec2 pos, const Color &color) {
+    const auto size = char_size();
+
+    glm::vec2 curr_pos = pos;
+    for (const auto cp: Utf8View(text)) {
+        if (cp == '\r')
+            continue;
+
+        if (cp == '\n') {
+            curr_pos = {pos.x, curr_pos.y + size.y};
+            continue;
+        }
+
+        const auto idx = static_cast<int>(encode(cp)) - first_;
+        if (cp != ' ' && idx >= 0 && idx < count_) {
+            const glm::vec4 region{
+                    static_cast<float>(idx % columns_) * char_size_.x,
+                    static_cast<float>(idx / columns_) * char_size_.y,
+                    char_size_.x,
+                    char_size_.y};
+            g2d_.texture(sheet_, curr_pos, size, region, {0, 0, 0}, color);
+        }
+        curr_pos.x += size.x;
+    }
+}
+
+std::uint8_t CodePage437::encode(char32_t cp) {
+    if (cp >= 0x20 && cp < 0x7f)
+        return static_cast<std::uint8_t>(cp);
+    if (cp == CP437_DEL)
+        return 0x7f;
+
+    for (std::size_t i = 1; i < CP437_LOW.size(); ++i)
+        if (CP437_LOW[i] == cp)
+            return static_cast<std::uint8_t>(i);
+    for (std::size_t i = 0; i < CP437_HIGH.size(); ++i)
+        if (CP437_HIGH[i] == cp)
+            return static_cast<std::uint8_t>(0x80 + i);
+
+    return '?';
+}
+} // namespace mizu
@@ -0,0 +1,167 @@
+#include "mizu/core/draw_recorder.hpp"
+#include <cstring>
+#include "mizu/core/log.hpp"
+
+namespace mizu {
+constexpr char RECORDING_MAGIC[4] = {'M', 'Z', 'D', 'R'};
+constexpr std::uint32_t RECORDING_VERSION = 2;
+
+enum class RecordTag : std::uint8_t { Texture = 0, Add = 1, Frame = 2 };
+
+std::unique_ptr<DrawRecorder> DrawRecorder::open(gloo::Context &gl, const std::filesystem::path &path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        MIZU_LOG_ERROR("Failed to open draw recording '{}' for writing", path);
+        return nullptr;
+    }
+
+    auto recorder = std::unique_ptr<DrawRecorder>(new DrawRecorder(gl, path, std::move(out)));
+    recorder->write_bytes_(RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+    recorder->write_(RECORDING_VERSION);
+
+    MIZU_LOG_DEBUG("Recording draws to '{}'", path);
+    return recorder;
+}
+
+DrawRecorder::DrawRecorder(gloo::Context &gl, std::filesystem::path path, std::ofstream out)
+    : gl_(gl), path_(std::move(path)), out_(std::move(out)) {}
+
+DrawRecorder::~DrawRecorder() {
+    out_.flush();
+    MIZU_LOG_DEBUG("Recorded {} frames ({} bytes) to '{}'", frames_, bytes_written(), path_);
+}
+
+void DrawRecorder::add(BatchType type, bool trans, GLuint texture_id, std::span<const float> vertex_data) {
+    if (texture_id != 0 && !seen_textures_.contains(texture_id)) {
+        // Replay only needs something the same size to sample from
+        GLint width = 0, height = 0;
+        gl_.ctx.GetTextureLevelParameteriv(texture_id, 0, GL_TEXTURE_WIDTH, &width);
+        CHECK_GL_ERROR(gl_.ctx, GetTextureLevelParameteriv);
+        gl_.ctx.GetTextureLevelParameteriv(texture_id, 0, GL_TEXTURE_HEIGHT, &height);
+        CHECK_GL_ERROR(gl_.ctx, GetTextureLevelParameteriv);
+
+        write_(RecordTag::Texture);
+        write_(static_cast<std::uint32_t>(texture_id));
+        write_(static_cast<std::int32_t>(width));
+        write_(static_cast<std::int32_t>(height));
+        seen_textures_.insert(texture_id);
+    }
+
+    write_(RecordTag::Add);
+    write_(static_cast<std::uint8_t>(type));
+    write_(static_cast<std::uint8_t>(trans));
+    write_(static_cast<std::uint32_t>(texture_id));
+    write_(static_cast<std::uint32_t>(vertex_data.size()));
+    write_bytes_(vertex_data.data(), vertex_data.size_bytes());
+}
+
+void DrawRecorder::end_frame(const FrameUniforms &frame) {
+    write_(RecordTag::Frame);
+    write_(frame);
+    frames_++;
+}
+
+std::size_t DrawRecorder::frames() const {
+    return frames_;
+}
+
+std::size_t DrawRecorder::bytes_written() const {
+    return bytes_written_;
+}
+
+template<typename T>
+void DrawRecorder::write_(const T &v) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    write_bytes_(&v, sizeof(T));
+}
+
+void DrawRecorder::write_bytes_(const void *data, std::size_t size) {
+    out_.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    bytes_written_ += size;
+}
+
+std::optional<DrawRecording> DrawRecording::load(const std::filesystem::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        MIZU_LOG_ERROR("Failed to open draw recording '{}'", path);
+        return std::nullopt;
+    }
+
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        MIZU_LOG_ERROR("Failed to get size of draw recording '{}': {}", path, ec.message());
+        return std::nullopt;
+    }
+
+    const auto read = [&]<typename T>(T &v) {
+        in.read(reinterpret_cast<char *>(&v), sizeof(T));
+        return static_cast<bool>(in);
+    };
+
+    char magic[4]{};
+    std::uint32_t version = 0;
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, RECORDING_MAGIC, sizeof(magic)) != 0 || !read(version) ||
+        version != RECORDING_VERSION) {
+        MIZU_LOG_ERROR("'{}' is not a version {} draw recording", path, RECORDING_VERSION);
+        return std::nullopt;
+    }
+
+    DrawRecording recording{};
+    Frame frame{};
+
+    RecordTag tag;
+    while (read(tag)) {
+        switch (tag) {
+        case RecordTag::Texture: {
+            std::uint32_t id;
+            std::int32_t width, height;
+            if (!read(id) || !read(width) || !read(height))
+                break;
+            recording.textures.emplace_back(id, glm::ivec2(width, height));
+            continue;
+        }
+        case RecordTag::Add: {
+            std::uint8_t type, trans;
+            std::uint32_t texture_id, count;
+            if (!read(type) || !read(trans) || !read(texture_id) || !read(count))
+                break;
+            if (type >= BATCH_TYPE_COUNT) {
+                MIZU_LOG_ERROR("Unknown batch type {} in draw recording '{}'", type, path);
+                break;
+            }
+            if (count % BATCH_VERTEX_SIZE[type] != 0) {
+                MIZU_LOG_ERROR("Partial vertex in draw recording '{}' ({} floats, type {})", path, count, type);
+                break;
+            }
+            // Checked before allocating so a corrupt count can't ask for more than the file holds
+            if (count * sizeof(float) > file_size - static_cast<std::uintmax_t>(in.tellg()))
+                break;
+
+            const auto offset = frame.vertices.size();
+            frame.vertices.resize(offset + count);
+            in.read(reinterpret_cast<char *>(frame.vertices.data() + offset), count * sizeof(float));
+            if (!in)
+                break;
+
+            frame.adds.emplace_back(static_cast<BatchType>(type), trans != 0, texture_id, offset, count);
+            continue;
+        }
+        case RecordTag::Frame:
+            if (!read(frame.uniforms))
+                break;
+            recording.frames.push_back(std::move(frame));
+            frame = Frame{};
+            continue;
+        default: MIZU_LOG_ERROR("Unknown record tag {} in '{}'", static_cast<int>(tag), path); break;
+        }
+
+        // Truncated recordings (e.g. the process was killed) keep every complete frame
+        MIZU_LOG_WARN("Draw recording '{}' ends mid record, keeping {} frames", path, recording.frames.size());
+        break;
+    }
+
+    return recording;
+}
+} // namespace mizu
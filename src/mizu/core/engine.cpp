@@ -20,6 +20,40 @@ void gl_debug_message_callback(
         const void *userParam);
 
 Engine::Engine(const std::string &window_title, glm::ivec2 window_size, WindowBuildFunc f)
+    : Engine() {
+    if (auto result = init_(window_title, window_size, std::move(f)); !result) {
+        MIZU_LOG_ERROR("{}", result.error());
+        SDL_Quit();
+        std::exit(EXIT_FAILURE);
+    }
+    g2d->set_vsync(1);
+}
+
+Engine::Engine(const std::string &window_title, WindowBuildFunc f)
+    : Engine(window_title, glm::ivec2(0), std::move(f)) {}
+
+std::expected<std::unique_ptr<Engine>, std::string>
+Engine::headless(const std::string &title, const HeadlessConfig &config) {
+    auto engine = std::unique_ptr<Engine>(new Engine());
+    engine->headless_ = true;
+    engine->fixed_dt_ = config.fixed_dt;
+    engine->max_frames_ = config.max_frames;
+
+    if (auto result = engine->init_(title, config.resolution, [](auto &b) { b.hidden(); }); !result)
+        return std::unexpected(result.error());
+
+    engine->g2d->use_offscreen_target(config.resolution, false);
+    if (!engine->g2d->render_target()->complete())
+        return std::unexpected(std::string("Offscreen render target is incomplete"));
+
+    // Nothing is shown, so there's nothing to wait on
+    engine->g2d->set_vsync(0);
+
+    MIZU_LOG_DEBUG("Running headless at {}x{}", config.resolution.x, config.resolution.y);
+    return engine;
+}
+
+Engine::Engine()
     : running_(true), show_fps_(false) {
     // Log levels are controlled through MIZU_SPDLOG_LEVEL, but we don't know what the user
     // has set, so just assume trace logging to catch everything
@@ -30,18 +64,25 @@ Engine::Engine(const std::string &window_title, glm::ivec2 window_size, WindowBu
     log_platform();
 
     register_callbacks_();
+}
 
-    if (!SDL_Init(SDL_INIT_VIDEO)) {
-        MIZU_LOG_ERROR("Failed to initialize SDL: {}", SDL_GetError());
-        std::exit(EXIT_FAILURE);
-    }
+std::expected<void, std::string>
+Engine::init_(const std::string &window_title, glm::ivec2 window_size, WindowBuildFunc f) {
+    // The offscreen driver renders through EGL pbuffers and needs no display server, an
+    // SDL_VIDEO_DRIVER set in the environment still takes precedence over this
+    if (headless_)
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+
+    if (!SDL_Init(SDL_INIT_VIDEO))
+        return std::unexpected(fmt::format("Failed to initialize SDL: {}", SDL_GetError()));
 
     int sdl_version = SDL_GetVersion();
     MIZU_LOG_DEBUG(
-            "Initialized SDL v{}.{}.{}",
+            "Initialized SDL v{}.{}.{} (video driver: {})",
             SDL_VERSIONNUM_MAJOR(sdl_version),
             SDL_VERSIONNUM_MINOR(sdl_version),
-            SDL_VERSIONNUM_MICRO(sdl_version));
+            SDL_VERSIONNUM_MICRO(sdl_version),
+            SDL_GetCurrentVideoDriver());
 
     gloo::sdl3::Attr::set_context_version(gloo::ContextVersion(4, 5));
     gloo::sdl3::Attr::set_context_profile(gloo::sdl3::Profile::Core);
@@ -51,23 +92,20 @@ Engine::Engine(const std::string &window_title, glm::ivec2 window_size, WindowBu
 #endif
 
     auto builder = WindowBuilder(window_title, window_size);
-    f(builder.opengl().high_pixel_density());
+    builder.opengl();
+    if (!headless_)
+        builder.high_pixel_density();
+    f(builder);
 
     auto window_result = builder.build(callbacks);
-    if (!window_result) {
-        MIZU_LOG_ERROR("Failed to build window: {}", window_result.error());
-        SDL_Quit();
-        std::exit(EXIT_FAILURE);
-    }
+    if (!window_result)
+        return std::unexpected(fmt::format("Failed to build window: {}", window_result.error()));
     window = std::make_unique<Window>(std::move(window_result.value()));
 
     window->make_context_current();
     auto glad_version_opt = gl.load(SDL_GL_GetProcAddress);
-    if (!glad_version_opt) {
-        MIZU_LOG_ERROR("Failed to initialize OpenGL context");
-        SDL_Quit();
-        std::exit(EXIT_FAILURE);
-    }
+    if (!glad_version_opt)
+        return std::unexpected(std::string("Failed to initialize OpenGL context"));
 
 #if !defined(NDEBUG)
     gl.enable(gloo::Capability::DebugOutput);
@@ -81,11 +119,17 @@ Engine::Engine(const std::string &window_title, glm::ivec2 window_size, WindowBu
             glad_version_opt->minor,
             reinterpret_cast<const char *>(gl.ctx.GetString(GL_VENDOR)),
             reinterpret_cast<const char *>(gl.ctx.GetString(GL_RENDERER)));
+    MIZU_LOG_DEBUG("Parallel shader compilation: {}", gl.parallel_shader_compile() ? "yes" : "no");
+
+    if (auto pref_path = SDL_GetPrefPath("mizu", "program_cache"); pref_path) {
+        gl.program_cache.open(gl.ctx, pref_path);
+        SDL_free(pref_path);
+    } else
+        MIZU_LOG_WARN("Failed to find a writable program cache directory: {}", SDL_GetError());
 
     input = std::make_unique<InputMgr>(callbacks, window.get());
 
-    g2d = std::make_unique<G2d>(callbacks, gl, window.get());
-    g2d->set_vsync(1);
+    g2d = std::make_unique<G2d>(callbacks, gl, window.get(), frame_counter);
 
     dear = std::make_unique<Dear>(callbacks, window.get());
 
@@ -94,11 +138,9 @@ Engine::Engine(const std::string &window_title, glm::ivec2 window_size, WindowBu
 #endif
 
     frame_counter = FrameCounter();
+    return {};
 }
 
-Engine::Engine(const std::string &window_title, WindowBuildFunc f)
-    : Engine(window_title, glm::ivec2(0), std::move(f)) {}
-
 Engine::~Engine() {
     unregister_callbacks_();
 
@@ -127,6 +169,26 @@ void Engine::set_show_fps(bool v) {
     show_fps_ = v;
 }
 
+bool Engine::is_headless() const {
+    return headless_;
+}
+
+std::optional<double> Engine::fixed_dt() const {
+    return fixed_dt_;
+}
+
+void Engine::set_fixed_dt(std::optional<double> dt) {
+    fixed_dt_ = dt;
+}
+
+void Engine::set_max_frames(std::optional<std::size_t> max_frames) {
+    max_frames_ = max_frames;
+}
+
+std::size_t Engine::frame_count() const {
+    return frame_count_;
+}
+
 void Engine::poll_events_() {
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
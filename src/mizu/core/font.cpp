@@ -1,16 +1,119 @@
 #define STB_RECT_PACK_IMPLEMENTATION
 #include "../../../include/mizu/core/font.hpp"
-#include <bitset>
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <glm/common.hpp>
+#include <thread>
 #include "../../../include/mizu/core/log.hpp"
+#include "../../../include/mizu/util/hash.hpp"
 #include "../../../include/mizu/util/platform.hpp"
+#include "../../../include/mizu/util/utf8.hpp"
 
 namespace mizu {
+// Bump whenever the file layout changes so stale caches are ignored
+constexpr std::uint32_t ATLAS_CACHE_MAGIC = 0x4146'5a4d; // "MZFA"
+constexpr std::uint32_t ATLAS_CACHE_VERSION = 1;
+
+struct AtlasCacheHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t key;
+    std::uint32_t pages;
+    std::uint32_t sizes;
+};
+
+// Followed by the page's pixels, width * height texels
+struct AtlasCachePage {
+    std::int32_t width;
+    std::int32_t height;
+    std::uint64_t used_texels;
+};
+
+// Followed by its glyphs in slot order, then its codepoints
+struct AtlasCacheSize {
+    std::int32_t px_size;
+    float pen_offset;
+    float line_height;
+    std::uint32_t glyphs;
+    std::uint32_t codepoints;
+};
+
+struct AtlasCacheGlyph {
+    std::uint32_t idx;
+    std::uint32_t page;
+    float pos[2];
+    float size[2];
+    float offset[2];
+    float advance[2];
+};
+
+struct AtlasCacheCodepoint {
+    std::uint32_t cp;
+    std::uint32_t slot;
+};
+
+CodepointTable::CodepointTable() {
+    latin1_.fill(NO_SLOT);
+}
+
+void CodepointTable::set(char32_t cp, std::uint32_t slot) {
+    if (cp < 256) {
+        latin1_[cp] = slot;
+        return;
+    }
+
+    const auto page = cp >> 8;
+    if (page >= pages_.size())
+        pages_.resize(page + 1);
+    if (!pages_[page]) {
+        pages_[page] = std::make_unique<Page>();
+        pages_[page]->fill(NO_SLOT);
+    }
+    (*pages_[page])[cp & 0xff] = slot;
+}
+
+// 6 vertices in G2d::texture_vertices' layout, z is stamped when submitted
+static void push_glyph_quad(
+        std::vector<float> &out, const Texture &atlas, glm::vec2 p0, glm::vec2 p1, glm::vec4 region, glm::vec4 color) {
+    const auto s0 = atlas.s(region.x);
+    const auto t0 = atlas.t(region.y);
+    const auto s1 = atlas.s(region.x + region.z);
+    const auto t1 = atlas.t(region.y + region.w);
+
+    // clang-format off
+    out.insert(out.end(), {
+        p0.x, p0.y, 0.0f, color.r, color.g, color.b, color.a, s0, t0,
+        p1.x, p0.y, 0.0f, color.r, color.g, color.b, color.a, s1, t0,
+        p1.x, p1.y, 0.0f, color.r, color.g, color.b, color.a, s1, t1,
+        p0.x, p0.y, 0.0f, color.r, color.g, color.b, color.a, s0, t0,
+        p1.x, p1.y, 0.0f, color.r, color.g, color.b, color.a, s1, t1,
+        p0.x, p1.y, 0.0f, color.r, color.g, color.b, color.a, s0, t1,
+    });
+    // clang-format on
+}
+
+void Font::StagedGlyphs::clear() {
+    glyphs.clear();
+    slots.clear();
+    offsets.clear();
+    pixels.clear();
+}
+
+void Font::StagedGlyphs::append(const StagedGlyphs &other) {
+    glyphs.insert(glyphs.end(), other.glyphs.begin(), other.glyphs.end());
+    slots.insert(slots.end(), other.slots.begin(), other.slots.end());
+    for (const auto offset: other.offsets)
+        offsets.push_back(pixels.size() + offset);
+    pixels.insert(pixels.end(), other.pixels.begin(), other.pixels.end());
+}
+
 std::once_flag Font::initialized_ft_;
 FT_Library Font::ft_library_{nullptr};
 
-Font::Font(G2d &g2d, const std::filesystem::path &path)
-    : g2d_(g2d) {
+Font::Font(G2d &g2d, const std::filesystem::path &path, const FontDesc &desc)
+    : g2d_(g2d), desc_(desc) {
     std::call_once(initialized_ft_, [&] {
         if (const auto err = FT_Init_FreeType(&ft_library_)) {
             MIZU_LOG_ERROR("Failed to initialize FreeType: {}", FT_Error_String(err));
@@ -21,6 +124,8 @@ Font::Font(G2d &g2d, const std::filesystem::path &path)
         }
     });
 
+    pre_flush_hook_id_ = g2d_.add_pre_flush_hook([&] { flush_uploads_(); });
+
     if (!ft_library_)
         return;
 
@@ -52,15 +157,44 @@ Font::Font(G2d &g2d, const std::filesystem::path &path)
     }
     MIZU_LOG_DEBUG("Created FreeType face for '{}'", path);
 
-    atlas_ = g2d_.create_texture(ATLAS_SIZE);
+    if (face_->num_fixed_sizes > 0)
+        default_px_size_ = face_->available_sizes[0].height;
+
+    if (sdf() && !FT_IS_SCALABLE(face_)) {
+        MIZU_LOG_WARN("'{}' has no outlines to build distance fields from, using bitmap glyphs", path);
+        desc_.mode = FontMode::Bitmap;
+    }
+    if (sdf()) {
+        desc_.sdf_px_size = std::max(desc_.sdf_px_size, 1);
+        desc_.sdf_spread = std::clamp(desc_.sdf_spread, 2, 32);
+    }
+
+    if (!desc_.cache_dir.empty()) {
+        FT_Int ft_version[3];
+        FT_Library_Version(ft_library_, &ft_version[0], &ft_version[1], &ft_version[2]);
+        const std::int32_t options[3] = {
+                static_cast<std::int32_t>(desc_.mode),
+                sdf() ? desc_.sdf_px_size : 0,
+                sdf() ? desc_.sdf_spread : 0};
+
+        cache_key_ = fnv1a(FNV_OFFSET_BASIS, face_data_, face_data_size_);
+        cache_key_ = fnv1a(cache_key_, ft_version, sizeof(ft_version));
+        cache_key_ = fnv1a(cache_key_, options, sizeof(options));
+    }
 
-    rp_nodes_ = new stbrp_node[ATLAS_SIZE.x];
-    stbrp_init_target(&rp_ctx_, ATLAS_SIZE.x, ATLAS_SIZE.y, rp_nodes_, ATLAS_SIZE.x);
+    if (!load_cache_())
+        add_page_();
 
-    glyphs_.emplace_back();
+    if (!desc_.charset.empty())
+        prewarm(desc_.charset);
 }
 
 Font::~Font() {
+    g2d_.remove_pre_flush_hook(pre_flush_hook_id_);
+
+    if (cache_dirty_)
+        save_cache();
+
     if (const auto err = FT_Done_Face(face_))
         MIZU_LOG_ERROR("Failed to close FreeType face: {}", FT_Error_String(err));
     free(face_data_);
@@ -71,41 +205,49 @@ Font::~Font() {
     //     MIZU_LOG_ERROR("Failed to close FreeType: {}", FT_Error_String(err));
 }
 
-float Font::pen_offset() const {
-    return pen_offset_;
+bool Font::sdf() const {
+    return desc_.mode == FontMode::Sdf;
+}
+
+int Font::default_px_size() const {
+    return default_px_size_;
 }
 
-float Font::line_height() const {
-    return line_height_;
+float Font::pen_offset(int px_size) const {
+    const auto *cache = find_cache_(px_size);
+    return cache ? cache->pen_offset * scale_(px_size) : 0.0f;
 }
 
-glm::vec2 Font::calc_size(std::string_view text) {
+float Font::line_height(int px_size) const {
+    const auto *cache = find_cache_(px_size);
+    return cache ? cache->line_height * scale_(px_size) : 0.0f;
+}
+
+glm::vec2 Font::calc_size(std::string_view text, int px_size) {
     if (text.empty())
         return glm::vec2(0.0f);
 
-    check_populate_atlas_(text, 0);
+    const auto cache_idx = cache_for_(px_size);
+    check_populate_atlas_(text, cache_idx);
+    const auto scale = scale_(px_size);
+    const auto line_height = glyphs_[cache_idx].line_height * scale;
 
-    glm::vec2 size{0, line_height_};
+    glm::vec2 size{0, line_height};
     float curr_line_w = 0;
 
-    for (const auto &ch: text) {
-        if (ch == '\r')
+    for (const auto cp: Utf8View(text)) {
+        if (cp == '\r')
             continue;
 
-        if (ch == '\n') {
-            size.y += line_height_;
+        if (cp == '\n') {
+            size.y += line_height;
             size.x = std::max(size.x, curr_line_w);
             curr_line_w = 0;
             continue;
         }
 
-        const auto glyph_idx = FT_Get_Char_Index(face_, ch);
-        const auto it = glyphs_[0].find(glyph_idx);
-        if (it == glyphs_[0].end())
-            continue; // can this happen?
-        const auto &gi = it->second;
-
-        curr_line_w += gi.advance.x;
+        if (const auto *gi = glyph_(cp, cache_idx))
+            curr_line_w += gi->advance.x * scale;
     }
 
     size.x = std::max(size.x, curr_line_w);
@@ -113,150 +255,909 @@ glm::vec2 Font::calc_size(std::string_view text) {
     return size;
 }
 
-void Font::draw(const std::string_view text, glm::vec2 pos, const Color &color) {
-    check_populate_atlas_(text, 0);
+void Font::draw(const std::string_view text, glm::vec2 pos, const Color &color, int px_size) {
+    const auto cache_idx = cache_for_(px_size);
+    check_populate_atlas_(text, cache_idx);
+    const auto scale = scale_(px_size);
+    const auto line_height = glyphs_[cache_idx].line_height * scale;
+
+    const auto gl_color = color.gl_color();
+    auto sdf_page = NO_PAGE;
+    auto submit_sdf = [&] {
+        if (sdf_page != NO_PAGE && !sdf_vertices_.empty())
+            g2d_.texture_vertices(*pages_[sdf_page]->texture, sdf_vertices_, true);
+        sdf_vertices_.clear();
+    };
 
     glm::vec2 curr_pos = pos;
-    // TODO: use a UTF-8 library instead of iterating naively over chars
-    for (const auto &ch: text) {
-        if (ch == '\r')
+    for (const auto cp: Utf8View(text)) {
+        if (cp == '\r')
             continue;
 
-        if (ch == '\n') {
-            curr_pos.y += line_height_;
+        if (cp == '\n') {
+            curr_pos.y += line_height;
             curr_pos.x = pos.x;
             continue;
         }
 
-        const auto glyph_idx = FT_Get_Char_Index(face_, ch);
-        const auto it = glyphs_[0].find(glyph_idx);
-        if (it == glyphs_[0].end())
-            continue; // can this happen?
-        const auto &gi = it->second;
+        const auto *gi = glyph_(cp, cache_idx);
+        if (!gi)
+            continue;
 
-        g2d_.texture(
-                *atlas_,
-                {curr_pos.x + gi.offset.x, curr_pos.y - gi.offset.y},
-                {gi.pos.x, gi.pos.y, gi.size.x, gi.size.y},
-                {0, 0, 0},
-                color);
+        // Whitespace and glyphs that failed to load or pack have nothing to draw
+        if (gi->page != NO_PAGE && gi->size.x > 0 && gi->size.y > 0) {
+            auto &page = *pages_[gi->page];
+            page.last_used = g2d_.frame();
+            const glm::vec2 glyph_pos{curr_pos.x + gi->offset.x * scale, curr_pos.y - gi->offset.y * scale};
+            if (sdf()) {
+                if (gi->page != sdf_page) {
+                    submit_sdf();
+                    sdf_page = gi->page;
+                }
+                push_glyph_quad(
+                        sdf_vertices_,
+                        *page.texture,
+                        glyph_pos,
+                        glyph_pos + gi->size * scale,
+                        glm::vec4(gi->pos, gi->size),
+                        gl_color);
+            } else
+                g2d_.texture(
+                        *page.texture, glyph_pos, {gi->pos.x, gi->pos.y, gi->size.x, gi->size.y}, {0, 0, 0}, color);
+        }
 
-        curr_pos.x += gi.advance.x;
-        curr_pos.y += gi.advance.y;
+        curr_pos += gi->advance * scale;
     }
+
+    submit_sdf();
 }
 
-void Font::check_populate_atlas_(const std::string_view text, int pt_size) {
-    auto new_glyphs = std::vector<GlyphInfo>();
-    auto new_glyph_bitmaps = std::vector<unsigned char *>();
+TextLayout Font::layout(std::string_view text, float wrap_width, int px_size) {
+    TextLayout out{};
+    if (text.empty())
+        return out;
 
-    // TODO: use a UTF-8 library instead of iterating naively over chars
-    for (const auto &ch: text) {
-        const auto glyph_idx = FT_Get_Char_Index(face_, ch);
-        if (glyphs_[pt_size].contains(glyph_idx))
+    // Taken before populating, so anything evicted to make room shows up as a stale layout
+    out.generation = atlas_generation_;
+    const auto cache_idx = cache_for_(px_size);
+    check_populate_atlas_(text, cache_idx);
+    const auto scale = scale_(px_size);
+    const auto line_height = glyphs_[cache_idx].line_height * scale;
+
+    out.lines = 1;
+    glm::vec2 pen{0.0f, glyphs_[cache_idx].pen_offset * scale};
+    auto finish_line = [&](float width) {
+        out.size.x = std::max(out.size.x, width);
+        out.lines++;
+        pen = {0.0f, pen.y + line_height};
+    };
+
+    // Where the current line can be broken: the first quad of the word after the
+    // last space, the pen position there, and the line width before the space
+    bool can_break = false;
+    std::size_t word_first_quad = 0;
+    float word_x = 0.0f;
+    float line_w_before_space = 0.0f;
+
+    for (const auto cp: Utf8View(text)) {
+        if (cp == '\r')
             continue;
-        glyphs_[pt_size].emplace(glyph_idx, GlyphInfo{});
 
-        if (const auto err = FT_Load_Glyph(face_, glyph_idx, FT_LOAD_DEFAULT)) {
-            MIZU_LOG_WARN("Failed to load glyph '{}': {}", ch, FT_Error_String(err));
+        if (cp == '\n') {
+            finish_line(pen.x);
+            can_break = false;
             continue;
         }
 
-        if (face_->glyph->format != FT_GLYPH_FORMAT_BITMAP) {
-            if (const auto err = FT_Render_Glyph(face_->glyph, FT_RENDER_MODE_NORMAL)) {
-                MIZU_LOG_WARN("Failed to render glyph '{}': {}", ch, FT_Error_String(err));
-                continue;
-            }
+        const auto *gi = glyph_(cp, cache_idx);
+        if (!gi)
+            continue;
+
+        const auto advance = gi->advance.x * scale;
+        if (cp == ' ') {
+            line_w_before_space = pen.x;
+            pen.x += advance;
+            word_first_quad = out.quads.size();
+            word_x = pen.x;
+            can_break = true;
+            continue;
         }
 
-        switch (face_->glyph->bitmap.pixel_mode) {
-        case FT_PIXEL_MODE_MONO: {
-            if (pen_offset_ == 0)
-                pen_offset_ = face_->glyph->bitmap_top;
-            if (line_height_ == 0)
-                line_height_ = face_->glyph->bitmap.rows;
-
-            new_glyphs.emplace_back(
-                    glyph_idx,
-                    glm::vec2{0, 0},
-                    glm::vec2{face_->glyph->bitmap.width, face_->glyph->bitmap.rows},
-                    glm::vec2{face_->glyph->bitmap_left, face_->glyph->bitmap_top},
-                    glm::vec2{face_->glyph->advance.x >> 6, face_->glyph->advance.y >> 6});
-
-            auto *rgba_bitmap = new unsigned char[face_->glyph->bitmap.width * face_->glyph->bitmap.rows * 4];
-            for (std::size_t y = 0; y < face_->glyph->bitmap.rows; y++) {
-                std::size_t bitmap_x = 0;
-
-                for (std::size_t yo = 0; yo < face_->glyph->bitmap.pitch; yo++) {
-                    const auto bitset =
-                            std::bitset<8>(face_->glyph->bitmap.buffer[(y * face_->glyph->bitmap.pitch) + yo]);
-
-                    for (std::size_t i = 0; i < bitset.size() && bitmap_x < face_->glyph->bitmap.width;
-                         ++i, ++bitmap_x) {
-                        const auto v = static_cast<unsigned char>(bitset[bitset.size() - 1 - i] == 1 ? 255 : 0);
-                        rgba_bitmap[face_->glyph->bitmap.width * 4 * y + bitmap_x * 4] = v;
-                        rgba_bitmap[face_->glyph->bitmap.width * 4 * y + bitmap_x * 4 + 1] = v;
-                        rgba_bitmap[face_->glyph->bitmap.width * 4 * y + bitmap_x * 4 + 2] = v;
-                        rgba_bitmap[face_->glyph->bitmap.width * 4 * y + bitmap_x * 4 + 3] = v;
-                    }
-                }
+        if (wrap_width > 0.0f && pen.x > 0.0f && pen.x + advance > wrap_width) {
+            if (can_break) {
+                // Carry the partial word down to the next line
+                const auto carried_w = pen.x - word_x;
+                finish_line(line_w_before_space);
+                for (auto i = word_first_quad; i < out.quads.size(); ++i)
+                    out.quads[i].pos += glm::vec2(-word_x, line_height);
+                pen.x = carried_w;
+            } else
+                finish_line(pen.x);
+            can_break = false;
+        }
+
+        if (gi->page != NO_PAGE && gi->size.x > 0 && gi->size.y > 0) {
+            pages_[gi->page]->last_used = g2d_.frame();
+            out.quads.emplace_back(
+                    glm::vec2(pen.x + gi->offset.x * scale, pen.y - gi->offset.y * scale),
+                    gi->size * scale,
+                    glm::vec4(gi->pos, gi->size),
+                    gi->page);
+        }
+        pen.x += advance;
+    }
+
+    out.size.x = std::max(out.size.x, pen.x);
+    out.size.y = static_cast<float>(out.lines) * line_height;
+    return out;
+}
+
+std::optional<TextLayout::Quad> Font::glyph_quad(char32_t cp, int px_size) {
+    char bytes[4];
+    const auto len = utf8_encode(cp, bytes);
+    const auto cache_idx = cache_for_(px_size);
+    check_populate_atlas_(std::string_view(bytes, len), cache_idx);
+
+    const auto *gi = glyph_(cp, cache_idx);
+    if (!gi || gi->page == NO_PAGE || gi->size.x <= 0 || gi->size.y <= 0)
+        return std::nullopt;
+
+    pages_[gi->page]->last_used = g2d_.frame();
+    const auto scale = scale_(px_size);
+    return TextLayout::Quad{
+            glm::vec2(gi->offset.x, glyphs_[cache_idx].pen_offset - gi->offset.y) * scale,
+            gi->size * scale,
+            glm::vec4(gi->pos, gi->size),
+            gi->page};
+}
+
+std::size_t Font::atlas_pages() const {
+    return pages_.size();
+}
+
+const Texture *Font::atlas_page(std::uint32_t page) const {
+    return page < pages_.size() ? pages_[page]->texture.get() : nullptr;
+}
+
+std::uint64_t Font::atlas_generation() const {
+    return atlas_generation_;
+}
+
+FontAtlasStats Font::atlas_stats() const {
+    auto stats = stats_;
+    stats.pages = pages_.size();
+    for (const auto &page: pages_) {
+        stats.glyphs += page->glyphs.size();
+        stats.used_texels += page->used_texels;
+        stats.total_texels += static_cast<std::size_t>(page->texture->width() * page->texture->height());
+    }
+    return stats;
+}
+
+void Font::mark_page_used(std::uint32_t page) {
+    if (page < pages_.size())
+        pages_[page]->last_used = g2d_.frame();
+}
+
+void Font::prewarm(std::string_view charset, int px_size) {
+    if (!face_ || charset.empty())
+        return;
+
+    const auto cache_idx = cache_for_(px_size);
+    auto &cache = glyphs_[cache_idx];
+    if (!set_face_size_(cache.px_size))
+        return;
+    init_cache_metrics_(cache, nullptr);
+    set_sdf_spread_(ft_library_);
+
+    std::vector<PrewarmItem> items{};
+    for (const auto cp: Utf8View(charset)) {
+        if (cp == '\r' || cp == '\n')
+            continue;
+        if (const auto slot = queue_glyph_(cp, cache))
+            items.emplace_back(cp, cache.glyphs[*slot].idx, *slot);
+    }
+    if (items.empty())
+        return;
+
+    const auto hw_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    const auto workers = std::clamp<std::size_t>(items.size() / PREWARM_GLYPHS_PER_WORKER, 1, hw_threads);
+    const auto per_worker = (items.size() + workers - 1) / workers;
+
+    std::vector<StagedGlyphs> staged(workers);
+    auto worker_ok = std::make_unique<bool[]>(workers);
+    auto worker_items = [&](std::size_t i) {
+        const auto first = std::min(i * per_worker, items.size());
+        return std::span<const PrewarmItem>(items).subspan(first, std::min(per_worker, items.size() - first));
+    };
+
+    {
+        // The calling thread takes the first chunk with the font's own face
+        std::vector<std::jthread> threads{};
+        for (std::size_t i = 1; i < workers; ++i)
+            threads.emplace_back(
+                    [&, i] { worker_ok[i] = rasterize_on_worker_(cache.px_size, worker_items(i), staged[i]); });
+
+        rasterize_items_(face_, worker_items(0), staged[0]);
+        worker_ok[0] = true;
+    }
+
+    // Chunks from workers that couldn't open their face are done here instead
+    staging_.clear();
+    for (std::size_t i = 0; i < workers; ++i) {
+        if (!worker_ok[i]) {
+            staged[i].clear();
+            rasterize_items_(face_, worker_items(i), staged[i]);
+        }
+        staging_.append(staged[i]);
+    }
+
+    if (!staging_.glyphs.empty())
+        init_cache_metrics_(cache, &staging_.glyphs.front());
+    MIZU_LOG_DEBUG("Prewarmed {} glyphs at {}px on {} thread(s)", staging_.glyphs.size(), cache.px_size, workers);
+
+    pack_staged_(cache_idx);
+    // Everything goes up now rather than with the first frame
+    flush_uploads_();
+}
+
+bool Font::save_cache() {
+    if (desc_.cache_dir.empty() || !face_ || pages_.empty())
+        return false;
+
+    std::error_code ec;
+    std::filesystem::create_directories(desc_.cache_dir, ec);
+    if (ec) {
+        MIZU_LOG_WARN("Failed to create font cache directory '{}': {}", desc_.cache_dir, ec.message());
+        return false;
+    }
+
+    const auto path = cache_path_();
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            MIZU_LOG_WARN("Failed to open font cache '{}' for writing", tmp_path);
+            return false;
+        }
+
+        const auto write = [&](const void *data, std::size_t size) {
+            out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+        };
+
+        const AtlasCacheHeader header{
+                ATLAS_CACHE_MAGIC,
+                ATLAS_CACHE_VERSION,
+                cache_key_,
+                static_cast<std::uint32_t>(pages_.size()),
+                static_cast<std::uint32_t>(glyphs_.size())};
+        write(&header, sizeof(header));
+
+        // The CPU copies are always current, even with uploads still pending
+        for (const auto &page: pages_) {
+            const AtlasCachePage page_header{
+                    static_cast<std::int32_t>(page->texture->width()),
+                    static_cast<std::int32_t>(page->texture->height()),
+                    page->used_texels};
+            write(&page_header, sizeof(page_header));
+            write(page->pixels.data(), page->pixels.size());
+        }
+
+        std::vector<AtlasCacheCodepoint> codepoints{};
+        for (const auto &cache: glyphs_) {
+            codepoints.clear();
+            cache.codepoints.for_each([&](char32_t cp, std::uint32_t slot) {
+                codepoints.emplace_back(static_cast<std::uint32_t>(cp), slot);
+            });
+
+            const AtlasCacheSize size_header{
+                    cache.px_size,
+                    cache.pen_offset,
+                    cache.line_height,
+                    static_cast<std::uint32_t>(cache.glyphs.size()),
+                    static_cast<std::uint32_t>(codepoints.size())};
+            write(&size_header, sizeof(size_header));
+
+            for (const auto &gi: cache.glyphs) {
+                const AtlasCacheGlyph glyph{
+                        gi.idx,
+                        gi.page,
+                        {gi.pos.x, gi.pos.y},
+                        {gi.size.x, gi.size.y},
+                        {gi.offset.x, gi.offset.y},
+                        {gi.advance.x, gi.advance.y}};
+                write(&glyph, sizeof(glyph));
             }
-            new_glyph_bitmaps.emplace_back(rgba_bitmap);
-        } break;
-        // case FT_PIXEL_MODE_GRAY: {
-        //     new_glyphs.emplace_back(
-        //             glyph_idx,
-        //             glm::vec2{0, 0},
-        //             glm::vec2{face_->glyph->bitmap.width, face_->glyph->bitmap.rows},
-        //             glm::vec2{face_->glyph->bitmap_left, face_->glyph->bitmap_top},
-        //             glm::vec2{face_->glyph->advance.x >> 6, face_->glyph->advance.y >> 6});
-        //
-        //     auto *rgba_bitmap = new unsigned char[face_->glyph->bitmap.width * face_->glyph->bitmap.rows * 4];
-        //     for (std::size_t y = 0; y < face_->glyph->bitmap.rows; y++) {
-        //         for (std::size_t x = 0; x < face_->glyph->bitmap.width; x++) {
-        //             const auto v = face_->glyph->bitmap.buffer[face_->glyph->bitmap.width * y + x];
-        //             rgba_bitmap[face_->glyph->bitmap.width * 4 * y + x * 4] = 255;
-        //             rgba_bitmap[face_->glyph->bitmap.width * 4 * y + x * 4 + 1] = 255;
-        //             rgba_bitmap[face_->glyph->bitmap.width * 4 * y + x * 4 + 2] = 255;
-        //             rgba_bitmap[face_->glyph->bitmap.width * 4 * y + x * 4 + 3] = v;
-        //         }
-        //     }
-        //     new_glyph_bitmaps.emplace_back(rgba_bitmap);
-        // } break;
-        default: MIZU_LOG_ERROR("Pixel mode {} not yet implemented", face_->glyph->bitmap.pixel_mode);
+            write(codepoints.data(), codepoints.size() * sizeof(AtlasCacheCodepoint));
+        }
+
+        if (!out) {
+            MIZU_LOG_WARN("Failed to write font cache '{}'", tmp_path);
+            return false;
         }
     }
 
-    // No new glyphs to pack
-    if (new_glyphs.empty())
+    // Rename so a crash mid-write never leaves a partial cache under the real name
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        MIZU_LOG_WARN("Failed to commit font cache '{}': {}", path, ec.message());
+        return false;
+    }
+
+    cache_dirty_ = false;
+    MIZU_LOG_DEBUG("Stored font cache '{}'", path);
+    return true;
+}
+
+float Font::scale_(int px_size) const {
+    if (!sdf())
+        return 1.0f;
+    return static_cast<float>(px_size <= 0 ? default_px_size_ : px_size) / static_cast<float>(desc_.sdf_px_size);
+}
+
+int Font::cache_px_size_(int px_size) const {
+    if (sdf())
+        return desc_.sdf_px_size;
+    return px_size <= 0 ? default_px_size_ : px_size;
+}
+
+std::uint32_t Font::cache_for_(int px_size) {
+    px_size = cache_px_size_(px_size);
+
+    for (std::uint32_t i = 0; i < glyphs_.size(); ++i)
+        if (glyphs_[i].px_size == px_size)
+            return i;
+
+    glyphs_.emplace_back().px_size = px_size;
+    return static_cast<std::uint32_t>(glyphs_.size() - 1);
+}
+
+const Font::GlyphCache *Font::find_cache_(int px_size) const {
+    px_size = cache_px_size_(px_size);
+
+    const auto it = std::ranges::find(glyphs_, px_size, &GlyphCache::px_size);
+    return it == glyphs_.end() ? nullptr : &*it;
+}
+
+bool Font::set_face_size_(int px_size) {
+    if (!face_)
+        return false;
+    if (face_px_size_ == px_size)
+        return true;
+    if (!size_face_(face_, px_size))
+        return false;
+
+    face_px_size_ = px_size;
+    return true;
+}
+
+bool Font::size_face_(FT_Face face, int px_size) {
+    if (const auto err = FT_Set_Pixel_Sizes(face, 0, px_size)) {
+        // Bitmap only faces only have their strikes, settle for the closest one
+        if (face->num_fixed_sizes == 0) {
+            MIZU_LOG_ERROR("Failed to set font size to {}px: {}", px_size, FT_Error_String(err));
+            return false;
+        }
+
+        int closest = 0;
+        for (int i = 1; i < face->num_fixed_sizes; ++i)
+            if (std::abs(face->available_sizes[i].height - px_size) <
+                std::abs(face->available_sizes[closest].height - px_size))
+                closest = i;
+
+        if (const auto select_err = FT_Select_Size(face, closest)) {
+            MIZU_LOG_ERROR("Failed to select font strike {}: {}", closest, FT_Error_String(select_err));
+            return false;
+        }
+        MIZU_LOG_WARN("Font has no {}px strike, using {}px", px_size, face->available_sizes[closest].height);
+    }
+    return true;
+}
+
+void Font::check_populate_atlas_(const std::string_view text, std::uint32_t cache_idx) {
+    // Textures retired by a grow in an earlier frame have been drawn from for the last time
+    std::erase_if(retired_textures_, [&](const auto &r) { return r.first < g2d_.frame(); });
+
+    auto &cache = glyphs_[cache_idx];
+    staging_.clear();
+    bool face_ready = false;
+
+    for (const auto cp: Utf8View(text)) {
+        if (cp == '\r' || cp == '\n')
+            continue;
+
+        const auto slot = queue_glyph_(cp, cache);
+        if (!slot) {
+            // Pages holding the rest of the text can't be evicted to make room for what's packed below
+            if (const auto *gi = glyph_(cp, cache_idx); gi && gi->page != NO_PAGE)
+                pages_[gi->page]->last_used = g2d_.frame();
+            continue;
+        }
+
+        if (!face_ready) {
+            if (!set_face_size_(cache.px_size))
+                continue;
+            init_cache_metrics_(cache, nullptr);
+            set_sdf_spread_(ft_library_);
+            face_ready = true;
+        }
+
+        if (rasterize_(face_, cp, cache.glyphs[*slot].idx, *slot, staging_))
+            init_cache_metrics_(cache, &staging_.glyphs.back());
+    }
+
+    pack_staged_(cache_idx);
+}
+
+std::optional<std::uint32_t> Font::queue_glyph_(char32_t cp, GlyphCache &cache) {
+    std::uint32_t slot = cache.codepoints.get(cp);
+    if (slot == CodepointTable::NO_SLOT) {
+        // Only codepoints seen for the first time reach FreeType
+        const auto glyph_idx = FT_Get_Char_Index(face_, cp);
+        if (const auto it = cache.slots_by_index.find(glyph_idx); it != cache.slots_by_index.end()) {
+            slot = it->second;
+            cache.codepoints.set(cp, slot);
+        } else {
+            // Failed glyphs keep their empty slot so they aren't retried every frame
+            slot = static_cast<std::uint32_t>(cache.glyphs.size());
+            cache.glyphs.push_back(GlyphInfo{glyph_idx});
+            cache.slots_by_index.emplace(glyph_idx, slot);
+            cache.codepoints.set(cp, slot);
+            return slot;
+        }
+    }
+
+    // Resident glyphs are done, evicted or dropped ones go through rasterization again.
+    // Clearing the size marks them as queued so repeats in text aren't rasterized twice.
+    auto &gi = cache.glyphs[slot];
+    if (gi.page != NO_PAGE || gi.size.x == 0 || gi.size.y == 0)
+        return std::nullopt;
+    gi.size = {0, 0};
+    return slot;
+}
+
+// Outline faces have real metrics, bitmap faces take theirs from the first glyph rasterized
+void Font::init_cache_metrics_(GlyphCache &cache, const GlyphInfo *glyph) const {
+    if (FT_IS_SCALABLE(face_)) {
+        if (cache.line_height == 0) {
+            cache.pen_offset = static_cast<float>(face_->size->metrics.ascender >> 6);
+            cache.line_height = static_cast<float>(face_->size->metrics.height >> 6);
+        }
+    } else if (glyph) {
+        if (cache.pen_offset == 0)
+            cache.pen_offset = glyph->offset.y;
+        if (cache.line_height == 0)
+            cache.line_height = glyph->size.y;
+    }
+}
+
+// The spread is a library wide property, another SDF font may have changed it
+void Font::set_sdf_spread_(FT_Library library) const {
+    if (!sdf())
         return;
+    if (const auto err = FT_Property_Set(library, "sdf", "spread", &desc_.sdf_spread))
+        MIZU_LOG_WARN("Failed to set SDF spread to {}: {}", desc_.sdf_spread, FT_Error_String(err));
+}
+
+bool Font::rasterize_(FT_Face face, char32_t cp, FT_UInt glyph_idx, std::uint32_t slot, StagedGlyphs &out) const {
+    // Distance fields are scaled far from the size they're built at, hinting for it would only distort them
+    const auto load_flags = sdf() ? FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP : FT_LOAD_DEFAULT;
+    if (const auto err = FT_Load_Glyph(face, glyph_idx, load_flags)) {
+        MIZU_LOG_WARN("Failed to load glyph U+{:04X}: {}", static_cast<std::uint32_t>(cp), FT_Error_String(err));
+        return false;
+    }
+
+    if (face->glyph->format != FT_GLYPH_FORMAT_BITMAP) {
+        const auto render_mode = sdf() ? FT_RENDER_MODE_SDF : FT_RENDER_MODE_NORMAL;
+        if (const auto err = FT_Render_Glyph(face->glyph, render_mode)) {
+            MIZU_LOG_WARN("Failed to render glyph U+{:04X}: {}", static_cast<std::uint32_t>(cp), FT_Error_String(err));
+            return false;
+        }
+    }
 
-    std::vector<stbrp_rect> new_rects;
-    new_rects.reserve(new_glyphs.size());
-    for (std::size_t i = 0; i < new_glyphs.size(); ++i)
-        new_rects.emplace_back(i, new_glyphs[i].size.x, new_glyphs[i].size.y, 0, 0, 0);
+    const auto &bitmap = face->glyph->bitmap;
+    if (bitmap.pixel_mode != FT_PIXEL_MODE_MONO && bitmap.pixel_mode != FT_PIXEL_MODE_GRAY) {
+        MIZU_LOG_ERROR("Pixel mode {} not yet implemented", bitmap.pixel_mode);
+        return false;
+    }
 
-    bool all_rects_packed = stbrp_pack_rects(&rp_ctx_, &new_rects[0], new_rects.size());
+    out.glyphs.emplace_back(
+            glyph_idx,
+            glm::vec2{0, 0},
+            glm::vec2{bitmap.width, bitmap.rows},
+            glm::vec2{face->glyph->bitmap_left, face->glyph->bitmap_top},
+            glm::vec2{face->glyph->advance.x >> 6, face->glyph->advance.y >> 6});
+    out.slots.push_back(slot);
+    out.offsets.push_back(out.pixels.size());
 
+    out.pixels.resize(out.pixels.size() + bitmap.width * bitmap.rows);
+    auto *coverage = out.pixels.data() + out.offsets.back();
+    for (std::size_t y = 0; y < bitmap.rows; y++) {
+        const auto *row = bitmap.buffer + y * bitmap.pitch;
+        if (bitmap.pixel_mode == FT_PIXEL_MODE_MONO) {
+            // One bit per pixel, MSB first, expanded to full or no coverage
+            for (std::size_t x = 0; x < bitmap.width; x++)
+                coverage[y * bitmap.width + x] =
+                        static_cast<unsigned char>((row[x >> 3] & (0x80 >> (x & 7))) != 0 ? 255 : 0);
+        } else
+            // Antialiased coverage and distance fields are both one byte per pixel, stored as is
+            std::copy_n(row, bitmap.width, coverage + y * bitmap.width);
+    }
+    return true;
+}
+
+void Font::rasterize_items_(FT_Face face, std::span<const PrewarmItem> items, StagedGlyphs &out) const {
+    for (const auto &item: items)
+        rasterize_(face, item.cp, item.glyph_idx, item.slot, out);
+}
+
+bool Font::rasterize_on_worker_(int px_size, std::span<const PrewarmItem> items, StagedGlyphs &out) const {
+    if (items.empty())
+        return true;
+
+    // FreeType objects aren't thread safe, every worker opens the face again over the shared data
+    FT_Library library;
+    if (const auto err = FT_Init_FreeType(&library)) {
+        MIZU_LOG_ERROR("Failed to initialize FreeType for a glyph worker: {}", FT_Error_String(err));
+        return false;
+    }
+
+    FT_Face face;
+    if (const auto err = FT_New_Memory_Face(library, face_data_, face_data_size_, 0, &face)) {
+        MIZU_LOG_ERROR("Failed to create FreeType face for a glyph worker: {}", FT_Error_String(err));
+        FT_Done_FreeType(library);
+        return false;
+    }
+
+    set_sdf_spread_(library);
+    const auto ok = size_face_(face, px_size);
+    if (ok)
+        rasterize_items_(face, items, out);
+
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+    return ok;
+}
+
+void Font::pack_staged_(std::uint32_t cache_idx) {
+    // No new glyphs to pack
+    if (staging_.glyphs.empty())
+        return;
+
+    std::vector<stbrp_rect> pending;
+    pending.reserve(staging_.glyphs.size());
+    for (std::size_t i = 0; i < staging_.glyphs.size(); ++i)
+        pending.emplace_back(i, staging_.glyphs[i].size.x, staging_.glyphs[i].size.y, 0, 0, 0);
+
+    // Older pages can still have gaps that fit small glyphs
     std::size_t rects_packed = 0;
-    for (std::size_t i = 0; i < new_rects.size(); ++i) {
-        if (!new_rects[i].was_packed)
-            continue;
-        rects_packed++;
+    for (std::uint32_t page = 0; page < pages_.size() && !pending.empty(); ++page)
+        rects_packed += pack_into_page_(page, pending, cache_idx);
+
+    while (!pending.empty()) {
+        const auto page = make_room_();
+        if (!page)
+            break;
 
-        const auto new_glyph_idx = new_rects[i].id;
-        new_glyphs[new_glyph_idx].pos = {new_rects[i].x, new_rects[i].y};
-        atlas_->write_subimage(
-                new_glyphs[new_glyph_idx].pos, new_glyphs[new_glyph_idx].size, new_glyph_bitmaps[new_glyph_idx]);
-        glyphs_[pt_size][new_glyphs[new_glyph_idx].idx] = new_glyphs[new_glyph_idx];
+        // A grow can take a few steps to fit a tall glyph, a cleared page that fits nothing never will
+        const auto packed = pack_into_page_(*page, pending, cache_idx);
+        rects_packed += packed;
+        if (packed == 0 && pages_[*page]->glyphs.empty())
+            break;
     }
 
     if (rects_packed > 0)
         MIZU_LOG_TRACE("Packed {} rects", rects_packed);
-    if (!all_rects_packed)
-        MIZU_LOG_WARN("Failed to pack {}", new_rects.size() - rects_packed);
 
-    for (const auto &bmp: new_glyph_bitmaps)
-        delete[] bmp;
+    // Dropped glyphs keep their size without a page so they're retried on their next use
+    if (!pending.empty()) {
+        for (const auto &rect: pending)
+            glyphs_[cache_idx].glyphs[staging_.slots[rect.id]] = staging_.glyphs[rect.id];
+        stats_.dropped += pending.size();
+        MIZU_LOG_WARN("Glyph atlas is full, dropped {} glyph(s)", pending.size());
+    }
+}
+
+std::size_t Font::pack_into_page_(std::uint32_t page, std::vector<stbrp_rect> &pending, std::uint32_t cache_idx) {
+    auto &p = *pages_[page];
+    stbrp_pack_rects(&p.rp_ctx, pending.data(), static_cast<int>(pending.size()));
+
+    const auto packed = std::erase_if(pending, [&](const stbrp_rect &rect) {
+        if (!rect.was_packed)
+            return false;
+
+        auto &glyph = staging_.glyphs[rect.id];
+        glyph.pos = {rect.x, rect.y};
+        glyph.page = page;
+        write_to_page_(p, glyph.pos, glyph.size, staging_.pixels.data() + staging_.offsets[rect.id]);
+
+        const auto slot = staging_.slots[rect.id];
+        glyphs_[cache_idx].glyphs[slot] = glyph;
+        p.glyphs.emplace_back(cache_idx, slot);
+        p.used_texels += static_cast<std::size_t>(glyph.size.x * glyph.size.y);
+        return true;
+    });
+
+    if (packed > 0) {
+        p.last_used = g2d_.frame();
+        cache_dirty_ = true;
+    }
+    return packed;
+}
+
+std::optional<std::uint32_t> Font::make_room_() {
+    if (!pages_.empty() && static_cast<int>(pages_.back()->texture->height()) < ATLAS_MAX_HEIGHT) {
+        grow_page_(*pages_.back());
+        return static_cast<std::uint32_t>(pages_.size() - 1);
+    }
+
+    if (pages_.size() < ATLAS_MAX_PAGES) {
+        add_page_();
+        return static_cast<std::uint32_t>(pages_.size() - 1);
+    }
+
+    return evict_page_();
+}
+
+std::filesystem::path Font::cache_path_() const {
+    return desc_.cache_dir / fmt::format("{:016x}.atlas", cache_key_);
+}
+
+bool Font::load_cache_() {
+    if (desc_.cache_dir.empty())
+        return false;
+
+    const auto path = cache_path_();
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        return false;
+
+    const auto read = [&](void *data, std::size_t size) {
+        in.read(static_cast<char *>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(in);
+    };
+    const auto invalid = [&] {
+        MIZU_LOG_DEBUG("Ignoring invalid font cache '{}'", path);
+        return false;
+    };
+
+    AtlasCacheHeader header{};
+    if (!read(&header, sizeof(header)) || header.magic != ATLAS_CACHE_MAGIC ||
+        header.version != ATLAS_CACHE_VERSION || header.key != cache_key_ || header.pages == 0 ||
+        header.pages > ATLAS_MAX_PAGES)
+        return invalid();
+
+    // Pixels are read straight into the CPU copies, which are uploaded whole below
+    const auto desc = page_texture_desc_();
+    std::vector<std::unique_ptr<AtlasPage>> pages{};
+    for (std::uint32_t i = 0; i < header.pages; ++i) {
+        AtlasCachePage page_header{};
+        if (!read(&page_header, sizeof(page_header)) || page_header.width != ATLAS_SIZE.x ||
+            page_header.height < ATLAS_SIZE.y || page_header.height > ATLAS_MAX_HEIGHT)
+            return invalid();
+
+        auto page = std::make_unique<AtlasPage>();
+        page->pixels.resize(
+                static_cast<std::size_t>(page_header.width) * page_header.height * gloo::bytes_per_texel(desc.format));
+        if (!read(page->pixels.data(), page->pixels.size()))
+            return invalid();
+        page->used_texels = page_header.used_texels;
+        page->dirty = {0, 0, page_header.width, page_header.height};
+        page->rp_nodes.resize(page_header.width);
+        pages.push_back(std::move(page));
+    }
+
+    std::vector<GlyphCache> caches{};
+    for (std::uint32_t i = 0; i < header.sizes; ++i) {
+        AtlasCacheSize size_header{};
+        if (!read(&size_header, sizeof(size_header)))
+            return invalid();
+
+        auto &cache = caches.emplace_back();
+        cache.px_size = size_header.px_size;
+        cache.pen_offset = size_header.pen_offset;
+        cache.line_height = size_header.line_height;
+
+        for (std::uint32_t slot = 0; slot < size_header.glyphs; ++slot) {
+            AtlasCacheGlyph glyph{};
+            if (!read(&glyph, sizeof(glyph)))
+                return invalid();
+
+            const GlyphInfo gi{
+                    glyph.idx,
+                    {glyph.pos[0], glyph.pos[1]},
+                    {glyph.size[0], glyph.size[1]},
+                    {glyph.offset[0], glyph.offset[1]},
+                    {glyph.advance[0], glyph.advance[1]},
+                    glyph.page};
+            if (gi.page != NO_PAGE) {
+                if (gi.page >= pages.size())
+                    return invalid();
+                const auto &bounds = pages[gi.page]->dirty;
+                if (gi.pos.x < 0 || gi.pos.y < 0 || gi.pos.x + gi.size.x > bounds.z || gi.pos.y + gi.size.y > bounds.w)
+                    return invalid();
+                pages[gi.page]->glyphs.emplace_back(static_cast<std::uint32_t>(caches.size() - 1), slot);
+            }
+
+            cache.glyphs.push_back(gi);
+            cache.slots_by_index.emplace(gi.idx, slot);
+        }
+
+        for (std::uint32_t j = 0; j < size_header.codepoints; ++j) {
+            AtlasCacheCodepoint codepoint{};
+            if (!read(&codepoint, sizeof(codepoint)) || codepoint.cp > 0x10ffff ||
+                codepoint.slot >= cache.glyphs.size())
+                return invalid();
+            cache.codepoints.set(static_cast<char32_t>(codepoint.cp), codepoint.slot);
+        }
+    }
+
+    glyphs_ = std::move(caches);
+    pages_ = std::move(pages);
+    for (auto &page: pages_) {
+        const auto size = glm::ivec2(page->dirty.z, page->dirty.w);
+        page->texture = g2d_.create_texture(size, desc);
+        page->last_used = g2d_.frame();
+        restore_skyline_(*page);
+    }
+    flush_uploads_();
+
+    MIZU_LOG_DEBUG("Loaded {} glyph atlas page(s) from font cache '{}'", pages_.size(), path);
+    return true;
+}
+
+// Nothing but the skyline's shape survives in the file, so it's rebuilt from the glyphs:
+// each column's top is the bottom of the lowest glyph covering it
+void Font::restore_skyline_(AtlasPage &page) const {
+    const auto width = static_cast<int>(page.texture->width());
+    const auto height = static_cast<int>(page.texture->height());
+    stbrp_init_target(&page.rp_ctx, width, height, page.rp_nodes.data(), static_cast<int>(page.rp_nodes.size()));
+
+    std::vector<int> tops(width, 0);
+    for (const auto &ref: page.glyphs) {
+        const auto &gi = glyphs_[ref.cache].glyphs[ref.slot];
+        const auto x0 = static_cast<int>(gi.pos.x);
+        const auto bottom = static_cast<int>(gi.pos.y + gi.size.y);
+        for (int x = x0; x < x0 + static_cast<int>(gi.size.x); ++x)
+            tops[x] = std::max(tops[x], bottom);
+    }
+
+    // Runs of equal height become nodes, the first reuses the node init_target made for the full width
+    auto *node = page.rp_ctx.active_head;
+    node->y = tops[0];
+    for (int x = 1; x < width; ++x) {
+        if (tops[x] == tops[x - 1])
+            continue;
+
+        auto *next = page.rp_ctx.free_head;
+        page.rp_ctx.free_head = next->next;
+        next->x = x;
+        next->y = tops[x];
+        next->next = node->next;
+        node->next = next;
+        node = next;
+    }
+}
+
+// Pages hold one byte per texel, sampled as white with the coverage or distance in alpha
+gloo::TextureDesc Font::page_texture_desc_() const {
+    // Blending neighbouring distances still gives a distance, so fields can be sampled linearly
+    return {.format = gloo::InternalFormat::R8,
+            .min_filter = sdf() ? gloo::MinFilter::Linear : gloo::MinFilter::Nearest,
+            .mag_filter = gloo::MagFilter::Linear,
+            .swizzle = gloo::SWIZZLE_COVERAGE};
+}
+
+void Font::add_page_() {
+    const auto desc = page_texture_desc_();
+    auto page = std::make_unique<AtlasPage>();
+    page->texture = g2d_.create_texture(ATLAS_SIZE, desc);
+    page->pixels.resize(static_cast<std::size_t>(ATLAS_SIZE.x) * ATLAS_SIZE.y * gloo::bytes_per_texel(desc.format));
+    page->rp_nodes.resize(ATLAS_SIZE.x);
+    stbrp_init_target(&page->rp_ctx, ATLAS_SIZE.x, ATLAS_SIZE.y, page->rp_nodes.data(), ATLAS_SIZE.x);
+    pages_.push_back(std::move(page));
+
+    MIZU_LOG_DEBUG("Added glyph atlas page {}", pages_.size() - 1);
+}
+
+void Font::grow_page_(AtlasPage &page) {
+    const glm::ivec2 old_size{page.texture->width(), page.texture->height()};
+    const glm::ivec2 new_size{old_size.x, std::min(old_size.y * 2, ATLAS_MAX_HEIGHT)};
+
+    // Glyphs packed earlier this frame may already be batched against the old texture
+    flush_page_(page);
+
+    auto texture = g2d_.create_texture(new_size, page_texture_desc_());
+    texture->copy_subimage_from(*page.texture, {0, 0}, {0, 0}, old_size);
+    page.pixels.resize(static_cast<std::size_t>(new_size.x) * new_size.y * gloo::bytes_per_texel(texture->format()));
+
+    // Draws already batched this frame still sample the old texture
+    retired_textures_.emplace_back(g2d_.frame(), std::move(page.texture));
+    page.texture = std::move(texture);
+
+    // The skyline only checks fits against the height, so everything packed so far stays valid
+    page.rp_ctx.height = new_size.y;
+
+    stats_.grows++;
+    atlas_generation_++;
+    MIZU_LOG_DEBUG("Grew glyph atlas page to {}x{}", new_size.x, new_size.y);
+}
+
+std::optional<std::uint32_t> Font::evict_page_() {
+    // Pages drawn from recently may have draws batched against them that haven't happened yet
+    const auto frame = g2d_.frame();
+    std::optional<std::uint32_t> lru{std::nullopt};
+    for (std::uint32_t i = 0; i < pages_.size(); ++i)
+        if (frame - pages_[i]->last_used >= ATLAS_EVICT_FRAMES &&
+            (!lru || pages_[i]->last_used < pages_[*lru]->last_used))
+            lru = i;
+
+    if (!lru)
+        return std::nullopt;
+
+    auto &page = *pages_[*lru];
+    for (const auto &ref: page.glyphs)
+        glyphs_[ref.cache].glyphs[ref.slot].page = NO_PAGE;
+    page.glyphs.clear();
+    page.used_texels = 0;
+
+    const auto size = glm::ivec2(page.texture->width(), page.texture->height());
+    stbrp_init_target(&page.rp_ctx, size.x, size.y, page.rp_nodes.data(), static_cast<int>(page.rp_nodes.size()));
+
+    stats_.evictions++;
+    atlas_generation_++;
+    MIZU_LOG_DEBUG("Evicted glyph atlas page {}, unused for {} frames", *lru, frame - page.last_used);
+    return lru;
+}
+
+const Font::GlyphInfo *Font::glyph_(char32_t cp, std::uint32_t cache_idx) const {
+    const auto &cache = glyphs_[cache_idx];
+    const auto slot = cache.codepoints.get(cp);
+    return slot == CodepointTable::NO_SLOT ? nullptr : &cache.glyphs[slot];
+}
+
+void Font::write_to_page_(AtlasPage &page, glm::ivec2 pos, glm::ivec2 size, const unsigned char *bytes) {
+    if (size.x <= 0 || size.y <= 0)
+        return;
+
+    const auto page_w = static_cast<std::size_t>(page.texture->width());
+    const auto texel_size = gloo::bytes_per_texel(page.texture->format());
+    const auto row_bytes = static_cast<std::size_t>(size.x) * texel_size;
+    for (int y = 0; y < size.y; ++y)
+        std::copy_n(
+                bytes + y * row_bytes, row_bytes, page.pixels.data() + ((pos.y + y) * page_w + pos.x) * texel_size);
+
+    const glm::ivec4 rect{pos, pos + size};
+    if (page.dirty.z <= page.dirty.x || page.dirty.w <= page.dirty.y)
+        page.dirty = rect;
+    else
+        page.dirty = {glm::min(glm::ivec2(page.dirty), glm::ivec2(rect)),
+                      glm::max(glm::ivec2(page.dirty.z, page.dirty.w), glm::ivec2(rect.z, rect.w))};
+}
+
+void Font::flush_page_(AtlasPage &page) {
+    if (page.dirty.z <= page.dirty.x || page.dirty.w <= page.dirty.y)
+        return;
+
+    const auto page_w = static_cast<int>(page.texture->width());
+    const auto offset = (static_cast<std::size_t>(page.dirty.y) * page_w + page.dirty.x) *
+                        gloo::bytes_per_texel(page.texture->format());
+    page.texture->write_subimage(
+            {page.dirty.x, page.dirty.y},
+            {page.dirty.z - page.dirty.x, page.dirty.w - page.dirty.y},
+            page.pixels.data() + offset,
+            page_w);
+    page.dirty = glm::ivec4(0);
+}
+
+void Font::flush_uploads_() {
+    for (auto &page: pages_)
+        flush_page_(*page);
+}
+
+float FontAtlasStats::occupancy() const {
+    return total_texels == 0 ? 0.0f : static_cast<float>(used_texels) / static_cast<float>(total_texels);
 }
 } // namespace mizu
@@ -0,0 +1,227 @@
+#include "mizu/core/frame_capture.hpp"
+#include <algorithm>
+#include <cstring>
+#include "mizu/core/log.hpp"
+#include "mizu/util/io.hpp"
+
+namespace mizu {
+FrameCapture::FrameCapture(gloo::Context &gl, std::size_t ring_size)
+    : gl_(gl), slots_(std::max<std::size_t>(ring_size, 1)), worker_([&](std::stop_token stop) { worker_loop_(stop); }) {}
+
+FrameCapture::~FrameCapture() {
+    collect_(true);
+    if (recording_path_)
+        push_job_(Job{.kind = JobKind::CloseRecording});
+
+    for (auto &slot: slots_) {
+        if (slot.fence) {
+            gl_.ctx.DeleteSync(slot.fence);
+            CHECK_GL_ERROR(gl_.ctx, DeleteSync);
+        }
+        if (slot.pbo != 0) {
+            gl_.ctx.DeleteBuffers(1, &slot.pbo);
+            CHECK_GL_ERROR(gl_.ctx, DeleteBuffers);
+            gl_.forget_buffer(slot.pbo);
+        }
+    }
+}
+
+void FrameCapture::capture(const std::filesystem::path &path) {
+    requests_.push_back(path);
+}
+
+void FrameCapture::start_recording(const std::filesystem::path &path, int fps) {
+    if (recording_path_)
+        stop_recording();
+
+    recording_path_ = path;
+    recording_fps_ = fps;
+    dropped_frames_ = 0;
+    MIZU_LOG_DEBUG("Started recording to '{}'", path);
+}
+
+void FrameCapture::stop_recording() {
+    if (!recording_path_)
+        return;
+
+    // Frames still in flight belong to this recording, they have to land before the close
+    collect_(true);
+    push_job_(Job{.kind = JobKind::CloseRecording});
+
+    MIZU_LOG_DEBUG("Stopped recording to '{}', dropped {} frames", *recording_path_, dropped_frames_);
+    recording_path_ = std::nullopt;
+}
+
+bool FrameCapture::recording() const {
+    return recording_path_.has_value();
+}
+
+std::size_t FrameCapture::dropped_frames() const {
+    return dropped_frames_;
+}
+
+void FrameCapture::end_frame(glm::ivec2 size) {
+    collect_(false);
+
+    if (size.x <= 0 || size.y <= 0)
+        return;
+
+    while (!requests_.empty()) {
+        auto slot = free_slot_();
+        if (!slot)
+            break; // try again next frame
+
+        read_into_(*slot, size, Job{.kind = JobKind::Png, .path = requests_.front(), .size = size});
+        requests_.pop_front();
+    }
+
+    if (recording_path_) {
+        if (auto slot = free_slot_(); slot) {
+            read_into_(
+                    *slot,
+                    size,
+                    Job{.kind = JobKind::Frame, .path = *recording_path_, .size = size, .fps = recording_fps_});
+        } else
+            dropped_frames_++;
+    }
+}
+
+void FrameCapture::flush() {
+    collect_(true);
+
+    std::unique_lock lock(jobs_mutex_);
+    idle_cv_.wait(lock, [&] { return jobs_.empty() && !worker_busy_; });
+}
+
+FrameCapture::Slot *FrameCapture::free_slot_() {
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        auto &slot = slots_[(next_slot_ + i) % slots_.size()];
+        if (!slot.job) {
+            next_slot_ = (next_slot_ + i + 1) % slots_.size();
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void FrameCapture::read_into_(Slot &slot, glm::ivec2 size, Job job) {
+    const auto bytes = static_cast<std::size_t>(size.x) * size.y * 4;
+    if (slot.capacity < bytes) {
+        if (slot.pbo == 0) {
+            gl_.ctx.CreateBuffers(1, &slot.pbo);
+            CHECK_GL_ERROR(gl_.ctx, CreateBuffers);
+        }
+        gl_.ctx.NamedBufferData(slot.pbo, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_READ);
+        CHECK_GL_ERROR(gl_.ctx, NamedBufferData);
+        slot.capacity = bytes;
+    }
+
+    // RGBA rows are always 4-byte aligned, so the default pack alignment is fine
+    gl_.bind_buffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    gl_.ctx.ReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    CHECK_GL_ERROR(gl_.ctx, ReadPixels);
+    gl_.bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = gl_.ctx.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    CHECK_GL_ERROR(gl_.ctx, FenceSync);
+    slot.seq = next_seq_++;
+    slot.job = std::move(job);
+}
+
+// Fences signal in submission order, so stop at the first one that hasn't
+void FrameCapture::collect_(bool wait) {
+    std::vector<Slot *> in_flight{};
+    for (auto &slot: slots_)
+        if (slot.job)
+            in_flight.push_back(&slot);
+    std::ranges::sort(in_flight, std::ranges::less{}, &Slot::seq);
+
+    for (auto *slot_ptr: in_flight) {
+        auto &slot = *slot_ptr;
+        const auto status = gl_.ctx.ClientWaitSync(
+                slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1'000'000'000 : 0);
+        CHECK_GL_ERROR(gl_.ctx, ClientWaitSync);
+        if (status == GL_TIMEOUT_EXPIRED)
+            break;
+        if (status == GL_WAIT_FAILED)
+            MIZU_LOG_ERROR("Failed to wait on frame capture fence");
+
+        gl_.ctx.DeleteSync(slot.fence);
+        CHECK_GL_ERROR(gl_.ctx, DeleteSync);
+        slot.fence = nullptr;
+
+        auto &job = *slot.job;
+        const auto bytes = static_cast<std::size_t>(job.size.x) * job.size.y * 4;
+        job.pixels.resize(bytes);
+
+        const auto mapped = gl_.ctx.MapNamedBufferRange(slot.pbo, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_READ_BIT);
+        CHECK_GL_ERROR(gl_.ctx, MapNamedBufferRange);
+        if (mapped) {
+            std::memcpy(job.pixels.data(), mapped, bytes);
+            gl_.ctx.UnmapNamedBuffer(slot.pbo);
+            CHECK_GL_ERROR(gl_.ctx, UnmapNamedBuffer);
+            push_job_(std::move(job));
+        } else
+            MIZU_LOG_ERROR("Failed to map frame capture buffer id={}", slot.pbo);
+
+        slot.job = std::nullopt;
+    }
+}
+
+void FrameCapture::push_job_(Job job) {
+    {
+        std::lock_guard lock(jobs_mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    jobs_cv_.notify_one();
+}
+
+void FrameCapture::worker_loop_(std::stop_token stop) {
+    Y4mWriter y4m{};
+    glm::ivec2 y4m_size{0};
+
+    for (;;) {
+        Job job{};
+        {
+            std::unique_lock lock(jobs_mutex_);
+            // Keeps draining after a stop request, only exits once the queue is empty
+            if (!jobs_cv_.wait(lock, stop, [&] { return !jobs_.empty(); }))
+                return;
+
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+            worker_busy_ = true;
+        }
+
+        switch (job.kind) {
+        case JobKind::Png:
+            if (write_png(job.path, job.pixels.data(), job.size.x, job.size.y, true))
+                MIZU_LOG_DEBUG("Wrote capture '{}'", job.path);
+            break;
+        case JobKind::Frame:
+            if (!y4m.is_open() || y4m.path() != job.path) {
+                if (y4m.open(job.path, job.size.x, job.size.y, job.fps))
+                    y4m_size = job.size;
+            }
+            if (job.size != y4m_size)
+                MIZU_LOG_WARN(
+                        "Dropping {}x{} frame, recording '{}' is {}x{}",
+                        job.size.x,
+                        job.size.y,
+                        job.path,
+                        y4m_size.x,
+                        y4m_size.y);
+            else
+                y4m.write_frame(job.pixels.data(), true);
+            break;
+        case JobKind::CloseRecording: y4m.close(); break;
+        }
+
+        {
+            std::lock_guard lock(jobs_mutex_);
+            worker_busy_ = false;
+        }
+        idle_cv_.notify_all();
+    }
+}
+} // namespace mizu
@@ -1,10 +1,19 @@
 #include "mizu/core/g2d.hpp"
 #include <SDL3/SDL_video.h>
+#include <algorithm>
+#include <glm/common.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
 #include "mizu/core/payloads.hpp"
+#include "mizu/core/text_grid.hpp"
 
 namespace mizu {
-G2d::G2d(CallbackMgr &callbacks, gloo::Context &gl, Window *window)
-    : gl_(gl), window_(window), batcher_(gl_), callbacks_(callbacks) {
+G2d::G2d(CallbackMgr &callbacks, gloo::Context &gl, Window *window, const FrameCounter<> &frame_counter)
+    : gl_(gl),
+      window_(window),
+      batcher_(gl_),
+      frame_counter_(frame_counter),
+      start_time_(std::chrono::steady_clock::now()),
+      callbacks_(callbacks) {
     register_callbacks_();
 }
 
@@ -14,11 +23,20 @@ G2d::~G2d() {
 
 std::unique_ptr<Texture>
 G2d::load_texture(const std::filesystem::path &path, gloo::MinFilter min_filter, gloo::MagFilter mag_filter) const {
-    return std::make_unique<Texture>(gl_, path, min_filter, mag_filter);
+    return load_texture(path, gloo::TextureDesc{.min_filter = min_filter, .mag_filter = mag_filter});
 }
+
 std::unique_ptr<Texture>
 G2d::create_texture(glm::ivec2 size, gloo::MinFilter min_filter, gloo::MagFilter mag_filter) const {
-    return std::make_unique<Texture>(gl_, size, min_filter, mag_filter);
+    return create_texture(size, gloo::TextureDesc{.min_filter = min_filter, .mag_filter = mag_filter});
+}
+
+std::unique_ptr<Texture> G2d::load_texture(const std::filesystem::path &path, const gloo::TextureDesc &desc) const {
+    return std::make_unique<Texture>(gl_, path, desc);
+}
+
+std::unique_ptr<Texture> G2d::create_texture(glm::ivec2 size, const gloo::TextureDesc &desc) const {
+    return std::make_unique<Texture>(gl_, size, desc);
 }
 
 bool G2d::vsync() const {
@@ -34,6 +52,110 @@ void G2d::set_vsync(bool enabled) {
         MIZU_LOG_ERROR("Failed to set swap interval: {}", SDL_GetError());
 }
 
+void G2d::use_offscreen_target(glm::ivec2 size, bool present) {
+    target_ = std::make_unique<gloo::Framebuffer>(gl_, size);
+    present_target_ = present;
+}
+
+void G2d::use_window_target() {
+    target_.reset();
+}
+
+const gloo::Framebuffer *G2d::render_target() const {
+    return target_.get();
+}
+
+glm::ivec2 G2d::render_size() const {
+    if (!scaling_())
+        return logical_size();
+
+    const auto scaled = glm::round(glm::vec2(window_->size()) * scale_);
+    return glm::max(glm::ivec2(scaled), glm::ivec2(1));
+}
+
+glm::ivec2 G2d::logical_size() const {
+    return target_ ? target_->size() : window_->size();
+}
+
+std::uint64_t G2d::frame() const {
+    return frame_;
+}
+
+void G2d::enable_dynamic_resolution(const DynamicResolution &config) {
+    dynres_ = config;
+    dynres_->min_scale = std::max(dynres_->min_scale, 0.1f);
+    dynres_->max_scale = std::max(dynres_->max_scale, dynres_->min_scale);
+
+    if (!pinned_scale_) {
+        scale_ = dynres_->max_scale;
+        scale_filter_ = dynres_->filter;
+    }
+    frames_until_adjust_ = dynres_->settle_frames;
+}
+
+void G2d::disable_dynamic_resolution() {
+    dynres_.reset();
+    if (!pinned_scale_) {
+        scale_ = 1.0f;
+        scaled_target_.reset();
+    }
+}
+
+void G2d::pin_resolution_scale(float scale, gloo::BlitFilter filter) {
+    pinned_scale_ = std::clamp(scale, 0.1f, 2.0f);
+    scale_ = *pinned_scale_;
+    scale_filter_ = filter;
+}
+
+void G2d::unpin_resolution_scale() {
+    pinned_scale_.reset();
+    if (dynres_) {
+        scale_ = std::clamp(scale_, dynres_->min_scale, dynres_->max_scale);
+        scale_filter_ = dynres_->filter;
+        frames_until_adjust_ = dynres_->settle_frames;
+    } else {
+        scale_ = 1.0f;
+        scaled_target_.reset();
+    }
+}
+
+float G2d::resolution_scale() const {
+    return scaling_() ? scale_ : 1.0f;
+}
+
+void G2d::capture(const std::filesystem::path &path) {
+    frame_capture().capture(path);
+}
+
+void G2d::start_recording(const std::filesystem::path &path, int fps) {
+    frame_capture().start_recording(path, fps);
+}
+
+void G2d::stop_recording() {
+    if (capture_)
+        capture_->stop_recording();
+}
+
+// Created on first use so the worker thread only exists if something captures
+FrameCapture &G2d::frame_capture() {
+    if (!capture_)
+        capture_ = std::make_unique<FrameCapture>(gl_);
+    return *capture_;
+}
+
+bool G2d::record_draws(const std::filesystem::path &path) {
+    stop_recording_draws();
+
+    draw_recorder_ = DrawRecorder::open(gl_, path);
+    batcher_.set_recorder(draw_recorder_.get());
+    return draw_recorder_ != nullptr;
+}
+
+void G2d::stop_recording_draws() {
+    batcher_.set_recorder(nullptr);
+    draw_recorder_.reset();
+}
+
 void G2d::clear(const Color &color, gloo::ClearBit mask) {
     gl_.clear_color(color);
     gl_.clear(mask);
@@ -50,6 +172,14 @@ void G2d::line(glm::vec2 p0, glm::vec2 p1, glm::vec3 rot, const Color &color) {
     auto gl_color = color.gl_color();
     auto z = batcher_.z();
     // clang-format off
+    if (rot.z == 0.0f) {
+        batcher_.add(BatchType::LinesUnrotated, gl_color.a < 1.0f, 0, {
+            p0.x, p0.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            p1.x, p1.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+        });
+        return;
+    }
+
     batcher_.add(BatchType::Lines, gl_color.a < 1.0f, 0, {
         p0.x, p0.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a, rot.x, rot.y, glm::radians(rot.z),
         p1.x, p1.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a, rot.x, rot.y, glm::radians(rot.z),
@@ -65,6 +195,15 @@ void G2d::fill_tri(glm::vec2 p0, glm::vec2 p1, glm::vec2 p2, glm::vec3 rot, cons
     auto gl_color = color.gl_color();
     auto z = batcher_.z();
     // clang-format off
+    if (rot.z == 0.0f) {
+        batcher_.add(BatchType::TrianglesUnrotated, gl_color.a < 1.0f, 0, {
+            p0.x, p0.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            p1.x, p1.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            p2.x, p2.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+        });
+        return;
+    }
+
     batcher_.add(BatchType::Triangles, gl_color.a < 1.0f, 0, {
         p0.x, p0.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a, rot.x, rot.y, glm::radians(rot.z),
         p1.x, p1.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a, rot.x, rot.y, glm::radians(rot.z),
@@ -81,6 +220,18 @@ void G2d::fill_rect(glm::vec2 pos, glm::vec2 size, glm::vec3 rot, const Color &c
     auto gl_color = color.gl_color();
     auto z = batcher_.z();
     // clang-format off
+    if (rot.z == 0.0f) {
+        batcher_.add(BatchType::TrianglesUnrotated, gl_color.a < 1.0f, 0, {
+            pos.x,          pos.y,          z, gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            pos.x + size.x, pos.y,          z, gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            pos.x + size.x, pos.y + size.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            pos.x,          pos.y,          z, gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            pos.x + size.x, pos.y + size.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            pos.x,          pos.y + size.y, z, gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+        });
+        return;
+    }
+
     batcher_.add(BatchType::Triangles, gl_color.a < 1.0f, 0, {
         pos.x,          pos.y,          z, gl_color.r, gl_color.g, gl_color.b, gl_color.a, rot.x, rot.y, glm::radians(rot.z),
         pos.x + size.x, pos.y,          z, gl_color.r, gl_color.g, gl_color.b, gl_color.a, rot.x, rot.y, glm::radians(rot.z),
@@ -102,6 +253,35 @@ void G2d::texture(
     auto z = batcher_.z();
     // clang-format off
     // TODO: Allow for drawing fully opaque textures as opaque
+    if (rot.z == 0.0f) {
+        batcher_.add(BatchType::TexUnrotated, true, t.id(), {
+            pos.x,          pos.y,          z,
+            gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            t.s(region.x),            t.t(region.y),
+
+            pos.x + size.x, pos.y,          z,
+            gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            t.s(region.x + region.z), t.t(region.y),
+
+            pos.x + size.x, pos.y + size.y, z,
+            gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            t.s(region.x + region.z), t.t(region.y + region.w),
+
+            pos.x,          pos.y,          z,
+            gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            t.s(region.x),            t.t(region.y),
+
+            pos.x + size.x, pos.y + size.y, z,
+            gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            t.s(region.x + region.z), t.t(region.y + region.w),
+
+            pos.x,          pos.y + size.y, z,
+            gl_color.r, gl_color.g, gl_color.b, gl_color.a,
+            t.s(region.x),            t.t(region.y + region.w),
+        });
+        return;
+    }
+
     batcher_.add(BatchType::Tex, true, t.id(), {
         pos.x,          pos.y,          z,
         gl_color.r, gl_color.g, gl_color.b, gl_color.a,
@@ -148,6 +328,53 @@ void G2d::texture(const Texture &t, glm::vec2 pos, glm::vec2 size, glm::vec3 rot
     texture(t, pos, size, {0, 0, t.width(), t.height()}, rot, color);
 }
 
+void G2d::texture_vertices(const Texture &t, std::span<float> vertex_data, bool sdf) {
+    constexpr std::size_t vertex_size = 9;
+    constexpr std::size_t chunk_size = vertex_size * 6 * 256;
+
+    const auto z = batcher_.z();
+    for (std::size_t i = 2; i < vertex_data.size(); i += vertex_size)
+        vertex_data[i] = z;
+
+    // Chunked so a long run of quads never outgrows a single batch
+    for (std::size_t first = 0; first < vertex_data.size(); first += chunk_size)
+        batcher_.add(
+                sdf ? BatchType::SdfUnrotated : BatchType::TexUnrotated,
+                true,
+                t.id(),
+                vertex_data.subspan(first, std::min(chunk_size, vertex_data.size() - first)));
+}
+
+void G2d::particles(ParticleSystem &system) {
+    const auto z = batcher_.z();
+    batcher_.add_custom([&system, z] { system.draw(z); });
+}
+
+void G2d::text_grid(TextGrid &grid, glm::vec2 pos) {
+    // Glyphs are packed now, so the atlas is uploaded by the pre-flush hooks before the grid draws
+    grid.prepare();
+    const auto z = batcher_.z();
+    batcher_.add_custom([&grid, pos, z] { grid.draw(pos, z); });
+}
+
+std::size_t G2d::add_pre_flush_hook(std::function<void()> fn) {
+    const auto id = next_pre_flush_hook_id_++;
+    pre_flush_hooks_.emplace_back(id, std::move(fn));
+    return id;
+}
+
+void G2d::remove_pre_flush_hook(std::size_t id) {
+    std::erase_if(pre_flush_hooks_, [&](const auto &hook) { return hook.first == id; });
+}
+
+void G2d::push_clip(glm::vec2 pos, glm::vec2 size) {
+    batcher_.push_clip({pos.x, pos.y, pos.x + size.x, pos.y + size.y});
+}
+
+void G2d::pop_clip() {
+    batcher_.pop_clip();
+}
+
 void G2d::register_callbacks_() {
     callback_id_ = callbacks_.reg();
     callbacks_.sub<PPreDraw>(callback_id_, [&](const auto &) { pre_draw_(); });
@@ -161,8 +388,64 @@ void G2d::unregister_callbacks_() {
     callback_id_ = 0;
 }
 
+bool G2d::scaling_() const {
+    return !target_ && (dynres_ || pinned_scale_);
+}
+
+gloo::Framebuffer *G2d::active_target_() {
+    if (target_)
+        return target_.get();
+    if (!scaling_())
+        return nullptr;
+
+    // Sized for the largest scale the adjuster can reach so changing scale never reallocates
+    const auto max_scale = std::max(scale_, dynres_ ? dynres_->max_scale : scale_);
+    const auto size = glm::max(glm::ivec2(glm::ceil(glm::vec2(window_->size()) * max_scale)), glm::ivec2(1));
+    if (!scaled_target_ || scaled_target_->size() != size) {
+        scaled_target_ = std::make_unique<gloo::Framebuffer>(gl_, size);
+        MIZU_LOG_DEBUG("Allocated {}x{} dynamic resolution target", size.x, size.y);
+    }
+    return scaled_target_.get();
+}
+
+void G2d::update_resolution_scale_() {
+    if (!dynres_ || pinned_scale_ || target_)
+        return;
+
+    const auto dt_ms = std::chrono::duration<double, std::milli>(frame_counter_.dt()).count();
+    if (dt_ms <= 0.0)
+        return;
+    frame_ms_.update(dt_ms);
+
+    if (frames_until_adjust_ > 0) {
+        frames_until_adjust_--;
+        return;
+    }
+
+    // Drop as soon as the budget is missed but only climb back with clear
+    // headroom, otherwise the scale oscillates around the budget
+    auto next = scale_;
+    if (frame_ms_.value() > dynres_->budget_ms)
+        next -= dynres_->step;
+    else if (frame_ms_.value() < dynres_->budget_ms * 0.8)
+        next += dynres_->step;
+    next = std::clamp(next, dynres_->min_scale, dynres_->max_scale);
+
+    if (next != scale_) {
+        MIZU_LOG_TRACE("Resolution scale {:.2f} -> {:.2f} ({:.2f} ms/frame)", scale_, next, frame_ms_.value());
+        scale_ = next;
+        frames_until_adjust_ = dynres_->settle_frames;
+    }
+}
+
 void G2d::pre_draw_() {
-    gl_.ctx.Viewport(0, 0, window_->size().x, window_->size().y);
+    if (auto *target = active_target_())
+        target->bind();
+    else
+        gl_.bind_framebuffer(0);
+
+    const auto size = render_size();
+    gl_.ctx.Viewport(0, 0, size.x, size.y);
     CHECK_GL_ERROR(gl_.ctx, Viewport);
 
     gl_.enable(gloo::Capability::DepthTest);
@@ -172,12 +455,47 @@ void G2d::pre_draw_() {
 }
 
 void G2d::post_draw_() {
-    batcher_.draw(window_->projection());
+    for (const auto &hook: pre_flush_hooks_)
+        hook.second();
+
+    // Projected over the logical size so drawing code never sees the scale
+    const auto logical = glm::vec2(logical_size());
+    const auto size = render_size();
+    batcher_.draw(FrameUniforms{
+            .proj = glm::orthoZO(0.0f, logical.x, logical.y, 0.0f, 1.0f, 0.0f),
+            .view = glm::mat4(1.0f),
+            .viewport = glm::vec4(0.0f, 0.0f, size.x, size.y),
+            .time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start_time_).count(),
+    });
     batcher_.clear();
+    frame_++;
 
     gl_.disable(gloo::Capability::DepthTest);
     gl_.depth_func(gloo::DepthFunc::Less);
     gl_.clip_control(gloo::ClipOrigin::LowerLeft, gloo::ClipDepth::NegativeOneToOne);
     gl_.clear_depth(1.0f);
+
+    if (capture_)
+        capture_->end_frame(render_size());
+
+    // Overlays draw on top of the window, not the offscreen target
+    if (target_) {
+        if (present_target_) {
+            const auto window_size = window_->size();
+            target_->blit_to(0, window_size, gloo::BlitFilter::Linear);
+            gl_.ctx.Viewport(0, 0, window_size.x, window_size.y);
+            CHECK_GL_ERROR(gl_.ctx, Viewport);
+        }
+        target_->unbind();
+    } else if (scaling_() && scaled_target_) {
+        const auto window_size = window_->size();
+        scaled_target_->blit_to(0, size, window_size, scale_filter_);
+        gl_.ctx.Viewport(0, 0, window_size.x, window_size.y);
+        CHECK_GL_ERROR(gl_.ctx, Viewport);
+        scaled_target_->unbind();
+    }
+
+    // Only after the blit, the size above has to match what pre_draw_ rendered
+    update_resolution_scale_();
 }
 } // namespace mizu
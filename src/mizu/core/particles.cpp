@@ -0,0 +1,337 @@
+#include "mizu/core/particles.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include "mizu/core/batcher.hpp"
+#include "mizu/core/log.hpp"
+#include "mizu/util/rng.hpp"
+
+const auto SIMULATE_SRC = R"glsl(
+#version 430 core
+layout(local_size_x = 64) in;
+
+layout(std430, binding = 0) buffer Positions { vec2 pos[]; };
+layout(std430, binding = 1) buffer Velocities { vec2 vel[]; };
+layout(std430, binding = 2) buffer Lives { vec2 life[]; };
+
+uniform uint count;
+uniform float dt;
+uniform vec2 gravity;
+uniform float drag;
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= count)
+        return;
+
+    vec2 l = life[i];
+    if (l.x >= l.y)
+        return;
+
+    vec2 v = (vel[i] + gravity * dt) * drag;
+    vel[i] = v;
+    pos[i] += v * dt;
+    life[i].x = l.x + dt;
+}
+)glsl";
+
+// One instance per particle, the quad's corners come from gl_VertexID
+const auto PARTICLE_VERT_SRC = R"glsl(
+#version 330 core
+layout(location = 0) in vec2 pos;
+layout(location = 1) in vec2 life;
+
+out vec4 out_color;
+out vec2 out_tex_coord;
+
+layout(std140) uniform Frame {
+    mat4 proj;
+    mat4 view;
+    vec4 viewport;
+    float time;
+};
+
+uniform float z;
+uniform vec2 size_range;
+uniform vec4 color_start;
+uniform vec4 color_end;
+uniform vec4 tex_region;
+
+const vec2 corners[6] = vec2[](
+    vec2(-0.5, -0.5), vec2(0.5, -0.5), vec2(0.5, 0.5),
+    vec2(-0.5, -0.5), vec2(0.5, 0.5), vec2(-0.5, 0.5)
+);
+
+void main() {
+    // Dead particles are pushed outside the clip volume
+    if (life.x >= life.y) {
+        out_color = vec4(0.0);
+        out_tex_coord = vec2(0.0);
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    float t = life.x / life.y;
+    vec2 corner = corners[gl_VertexID];
+
+    out_color = mix(color_start, color_end, t);
+    out_tex_coord = mix(tex_region.xy, tex_region.zw, corner + 0.5);
+
+    vec2 p = pos + corner * mix(size_range.x, size_range.y, t);
+    gl_Position = proj * view * vec4(p, -1.0 / z, 1.0);
+}
+)glsl";
+
+const auto PARTICLE_FRAG_SRC = R"glsl(
+#version 330 core
+in vec4 out_color;
+in vec2 out_tex_coord;
+
+out vec4 FragColor;
+
+#ifdef TEXTURED
+uniform sampler2D tex;
+#endif
+
+void main() {
+#ifdef TEXTURED
+    FragColor = out_color * texture(tex, out_tex_coord);
+#else
+    FragColor = out_color;
+#endif
+}
+)glsl";
+
+namespace mizu {
+void ParticleEmitter::burst(std::size_t count) {
+    pending_burst_ += count;
+}
+
+bool ParticleEmitter::active() const {
+    return alive_for_ > 0.0f || desc.rate > 0.0f || pending_burst_ > 0;
+}
+
+ParticleEmitter::ParticleEmitter(
+        gloo::Context &gl, gloo::Shader *shader, const EmitterDesc &desc, glm::vec2 pos, bool cpu)
+    : desc(desc),
+      pos(pos),
+      pos_buf_(gl, desc.capacity),
+      vel_buf_(gl, desc.capacity),
+      life_buf_(gl, desc.capacity) {
+    vao_ = gloo::VertexArrayBuilder(gl)
+                   .with(shader)
+                   .binding<float>(1)
+                   .vec("pos", 2)
+                   .binding<float>(1)
+                   .vec("life", 2)
+                   .build();
+    vao_->vertex_buffer(0, pos_buf_);
+    vao_->vertex_buffer(1, life_buf_);
+
+    if (cpu) {
+        cpu_pos_.resize(desc.capacity);
+        cpu_vel_.resize(desc.capacity);
+        cpu_life_.resize(desc.capacity);
+    }
+}
+
+ParticleSystem::ParticleSystem(gloo::Context &gl)
+    : gl_(gl), shaders_(gl_) {
+    if (gl_.compute_shaders())
+        simulate_ = gloo::ComputePipeline::from_src(gl_, SIMULATE_SRC);
+    if (simulate_) {
+        auto &sim = simulate_->shader();
+        simulate_uniforms_ = {
+                .count = sim.uniform_handle<unsigned int>("count"),
+                .dt = sim.uniform_handle<float>("dt"),
+                .gravity = sim.uniform_handle<glm::vec2>("gravity"),
+                .drag = sim.uniform_handle<float>("drag")};
+    } else
+        MIZU_LOG_WARN("Compute shaders unavailable, simulating particles on the CPU");
+
+    shaders_.stage_src(gloo::ShaderType::Vertex, PARTICLE_VERT_SRC)
+            .stage_src(gloo::ShaderType::Fragment, PARTICLE_FRAG_SRC);
+    const gloo::ShaderDefines permutations[] = {{{"TEXTURED", ""}}, {}};
+    shaders_.prewarm(permutations);
+
+    tex_shader_ = shaders_.get(permutations[0]);
+    flat_shader_ = shaders_.get(permutations[1]);
+    for (auto *shader: {tex_shader_, flat_shader_})
+        if (shader)
+            shader->uniform_block_binding("Frame", FRAME_UNIFORMS_BINDING);
+    if (tex_shader_) {
+        tex_shader_->uniform_handle<int>("tex").set(0);
+        tex_uniforms_ = draw_uniforms_(*tex_shader_);
+    }
+    if (flat_shader_)
+        flat_uniforms_ = draw_uniforms_(*flat_shader_);
+}
+
+ParticleSystem::~ParticleSystem() = default;
+
+ParticleEmitter *ParticleSystem::add_emitter(const EmitterDesc &desc, glm::vec2 pos) {
+    if (desc.capacity == 0) {
+        MIZU_LOG_ERROR("Particle emitter needs a non-zero capacity");
+        return nullptr;
+    }
+    if (!flat_shader_) {
+        MIZU_LOG_ERROR("Particle shaders failed to link, can't add emitter");
+        return nullptr;
+    }
+
+    emitters_.emplace_back(new ParticleEmitter(gl_, flat_shader_, desc, pos, !gpu_simulation()));
+    return emitters_.back().get();
+}
+
+void ParticleSystem::remove_emitter(ParticleEmitter *emitter) {
+    std::erase_if(emitters_, [&](const auto &e) { return e.get() == emitter; });
+}
+
+bool ParticleSystem::gpu_simulation() const {
+    return simulate_ != nullptr;
+}
+
+void ParticleSystem::update(double dt) {
+    const auto fdt = static_cast<float>(dt);
+
+    bool dispatched = false;
+    for (auto &e: emitters_) {
+        e->spawn_acc_ += e->desc.rate * fdt;
+        const auto from_rate = static_cast<std::size_t>(e->spawn_acc_);
+        e->spawn_acc_ -= static_cast<float>(from_rate);
+
+        const auto count = std::min(from_rate + e->pending_burst_, e->desc.capacity);
+        e->pending_burst_ = 0;
+        if (count > 0)
+            spawn_(*e, count);
+
+        if (e->alive_for_ <= 0.0f)
+            continue;
+
+        if (gpu_simulation()) {
+            simulate_gpu_(*e, fdt);
+            dispatched = true;
+        } else
+            simulate_cpu_(*e, fdt);
+        e->alive_for_ -= fdt;
+    }
+
+    // The next spawn writes and this frame's instanced draws read what the shader wrote
+    if (dispatched)
+        gl_.memory_barrier(gloo::BarrierBit::VertexAttribArray | gloo::BarrierBit::BufferUpdate);
+}
+
+void ParticleSystem::draw(float z) {
+    for (auto &e: emitters_) {
+        if (e->alive_for_ <= 0.0f)
+            continue;
+
+        auto *shader = e->desc.texture ? tex_shader_ : flat_shader_;
+        if (!shader)
+            continue;
+        const auto &uniforms = e->desc.texture ? tex_uniforms_ : flat_uniforms_;
+
+        glm::vec4 tex_region{0.0f, 0.0f, 1.0f, 1.0f};
+        if (const auto *t = e->desc.texture) {
+            auto region = e->desc.region;
+            if (region.z == 0.0f || region.w == 0.0f)
+                region = {0.0f, 0.0f, t->width(), t->height()};
+            tex_region = {t->s(region.x), t->t(region.y), t->s(region.x + region.z), t->t(region.y + region.w)};
+            gl_.bind_texture(0, t->id());
+        }
+
+        uniforms.z.set(z);
+        uniforms.size_range.set(e->desc.size);
+        uniforms.color_start.set(e->desc.color_start.gl_color());
+        uniforms.color_end.set(e->desc.color_end.gl_color());
+        uniforms.tex_region.set(tex_region);
+
+        shader->use();
+        e->vao_->draw_arrays_instanced(gloo::DrawMode::Triangles, 0, 6, e->desc.capacity);
+    }
+}
+
+ParticleSystem::DrawUniforms ParticleSystem::draw_uniforms_(gloo::Shader &shader) {
+    return {.z = shader.uniform_handle<float>("z"),
+            .size_range = shader.uniform_handle<glm::vec2>("size_range"),
+            .color_start = shader.uniform_handle<glm::vec4>("color_start"),
+            .color_end = shader.uniform_handle<glm::vec4>("color_end"),
+            .tex_region = shader.uniform_handle<glm::vec4>("tex_region")};
+}
+
+void ParticleSystem::spawn_(ParticleEmitter &e, std::size_t count) {
+    scratch_.pos.assign(count, e.pos);
+    scratch_.vel.resize(count);
+    scratch_.life.resize(count);
+
+    const auto &d = e.desc;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto angle = glm::radians(d.direction + rng::get<float>(-d.spread / 2.0f, d.spread / 2.0f));
+        const auto speed = rng::get<float>(d.speed.x, d.speed.y);
+        scratch_.vel[i] = glm::vec2(std::cos(angle), std::sin(angle)) * speed;
+        scratch_.life[i] = {0.0f, rng::get<float>(d.lifetime.x, d.lifetime.y)};
+    }
+
+    // Ring writes wrap at most once since count never exceeds the capacity
+    const auto first_part = std::min(count, d.capacity - e.head_);
+    write_spawned_(e, e.head_, 0, first_part);
+    if (first_part < count)
+        write_spawned_(e, 0, first_part, count - first_part);
+
+    e.head_ = (e.head_ + count) % d.capacity;
+    e.alive_for_ = std::max(e.alive_for_, d.lifetime.y);
+}
+
+void ParticleSystem::write_spawned_(ParticleEmitter &e, std::size_t first, std::size_t offset, std::size_t count) {
+    const auto pos = std::span<const glm::vec2>(scratch_.pos).subspan(offset, count);
+    const auto vel = std::span<const glm::vec2>(scratch_.vel).subspan(offset, count);
+    const auto life = std::span<const glm::vec2>(scratch_.life).subspan(offset, count);
+
+    if (gpu_simulation()) {
+        e.pos_buf_.write(first, pos);
+        e.vel_buf_.write(first, vel);
+        e.life_buf_.write(first, life);
+    } else {
+        std::ranges::copy(pos, e.cpu_pos_.begin() + first);
+        std::ranges::copy(vel, e.cpu_vel_.begin() + first);
+        std::ranges::copy(life, e.cpu_life_.begin() + first);
+    }
+}
+
+void ParticleSystem::simulate_gpu_(ParticleEmitter &e, float dt) {
+    simulate_uniforms_.count.set(static_cast<unsigned int>(e.desc.capacity));
+    simulate_uniforms_.dt.set(dt);
+    simulate_uniforms_.gravity.set(e.desc.gravity);
+    simulate_uniforms_.drag.set(std::max(1.0f - e.desc.drag * dt, 0.0f));
+
+    e.pos_buf_.bind_base(0);
+    e.vel_buf_.bind_base(1);
+    e.life_buf_.bind_base(2);
+    simulate_->dispatch_covering({static_cast<unsigned int>(e.desc.capacity), 1u, 1u});
+}
+
+void ParticleSystem::simulate_cpu_(ParticleEmitter &e, float dt) {
+    const auto gravity = e.desc.gravity * dt;
+    const auto drag = std::max(1.0f - e.desc.drag * dt, 0.0f);
+
+    auto *pos = e.cpu_pos_.data();
+    auto *vel = e.cpu_vel_.data();
+    auto *life = e.cpu_life_.data();
+    const auto n = e.cpu_pos_.size();
+
+    // Kept branch free over plain arrays so the compiler can vectorize it,
+    // dead particles are masked out instead of skipped
+    for (std::size_t i = 0; i < n; ++i) {
+        const float alive = life[i].x < life[i].y ? 1.0f : 0.0f;
+        const auto v = (vel[i] + gravity) * drag;
+        vel[i] += (v - vel[i]) * alive;
+        pos[i] += vel[i] * (dt * alive);
+        life[i].x += dt * alive;
+    }
+
+    // Velocity never leaves the CPU, only what the draw reads is uploaded
+    e.pos_buf_.write(0, e.cpu_pos_);
+    e.life_buf_.write(0, e.cpu_life_);
+}
+} // namespace mizu
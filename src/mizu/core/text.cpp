@@ -0,0 +1,120 @@
+#include "mizu/core/text.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace mizu {
+Text::Text(Font &font, std::string str, float wrap_width, int px_size)
+    : font_(&font), str_(std::move(str)), wrap_width_(wrap_width), px_size_(px_size) {}
+
+Font &Text::font() const {
+    return *font_;
+}
+
+void Text::set_font(Font &font) {
+    if (font_ == &font)
+        return;
+    font_ = &font;
+    layout_dirty_ = true;
+}
+
+const std::string &Text::str() const {
+    return str_;
+}
+
+void Text::set_str(std::string_view str) {
+    if (str_ == str)
+        return;
+    str_ = str;
+    layout_dirty_ = true;
+}
+
+float Text::wrap_width() const {
+    return wrap_width_;
+}
+
+void Text::set_wrap_width(float wrap_width) {
+    if (wrap_width_ == wrap_width)
+        return;
+    wrap_width_ = wrap_width;
+    layout_dirty_ = true;
+}
+
+int Text::px_size() const {
+    return px_size_;
+}
+
+void Text::set_px_size(int px_size) {
+    if (px_size_ == px_size)
+        return;
+    px_size_ = px_size;
+    layout_dirty_ = true;
+}
+
+glm::vec2 Text::size() {
+    return layout_if_dirty_().size;
+}
+
+std::size_t Text::lines() {
+    return layout_if_dirty_().lines;
+}
+
+void Text::draw(G2d &g2d, glm::vec2 pos, const Color &color) {
+    const auto &layout = layout_if_dirty_();
+    if (layout.quads.empty())
+        return;
+
+    const auto gl_color = color.gl_color();
+    if (vertices_dirty_ || pos != vertices_pos_ || gl_color != vertices_color_)
+        build_vertices_(pos, gl_color);
+
+    for (auto &run: vertices_) {
+        font_->mark_page_used(run.page);
+        g2d.texture_vertices(*font_->atlas_page(run.page), run.data, font_->sdf());
+    }
+}
+
+const TextLayout &Text::layout_if_dirty_() {
+    if (layout_dirty_ || layout_.generation != font_->atlas_generation()) {
+        layout_ = font_->layout(str_, wrap_width_, px_size_);
+        layout_dirty_ = false;
+        vertices_dirty_ = true;
+    }
+    return layout_;
+}
+
+void Text::build_vertices_(glm::vec2 pos, glm::vec4 color) {
+    vertices_.clear();
+
+    for (const auto &q: layout_.quads) {
+        auto run = std::ranges::find(vertices_, q.page, &PageVertices::page);
+        if (run == vertices_.end()) {
+            vertices_.emplace_back(q.page);
+            run = vertices_.end() - 1;
+        }
+
+        const auto &atlas = *font_->atlas_page(q.page);
+        const auto p0 = pos + q.pos;
+        const auto p1 = p0 + q.size;
+        const auto s0 = atlas.s(q.region.x);
+        const auto t0 = atlas.t(q.region.y);
+        const auto s1 = atlas.s(q.region.x + q.region.z);
+        const auto t1 = atlas.t(q.region.y + q.region.w);
+
+        // z is stamped by G2d::texture_vertices on every draw
+        // clang-format off
+        run->data.insert(run->data.end(), {
+            p0.x, p0.y, 0.0f, color.r, color.g, color.b, color.a, s0, t0,
+            p1.x, p0.y, 0.0f, color.r, color.g, color.b, color.a, s1, t0,
+            p1.x, p1.y, 0.0f, color.r, color.g, color.b, color.a, s1, t1,
+            p0.x, p0.y, 0.0f, color.r, color.g, color.b, color.a, s0, t0,
+            p1.x, p1.y, 0.0f, color.r, color.g, color.b, color.a, s1, t1,
+            p0.x, p1.y, 0.0f, color.r, color.g, color.b, color.a, s0, t1,
+        });
+        // clang-format on
+    }
+
+    vertices_pos_ = pos;
+    vertices_color_ = color;
+    vertices_dirty_ = false;
+}
+} // namespace mizu
@@ -0,0 +1,373 @@
+#include "mizu/core/text_grid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <string>
+#include "mizu/core/batcher.hpp"
+#include "mizu/core/log.hpp"
+#include "mizu/util/utf8.hpp"
+
+// One quad over the whole grid, its corners come from gl_VertexID
+const auto GRID_VERT_SRC = R"glsl(
+#version 330 core
+out vec2 out_grid_pos;
+
+layout(std140) uniform Frame {
+    mat4 proj;
+    mat4 view;
+    vec4 viewport;
+    float time;
+};
+
+uniform float z;
+uniform vec2 origin;
+uniform vec2 size;
+
+const vec2 corners[6] = vec2[](
+    vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+    vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+void main() {
+    out_grid_pos = corners[gl_VertexID] * size;
+    gl_Position = proj * view * vec4(origin + out_grid_pos, -1.0 / z, 1.0);
+}
+)glsl";
+
+const auto GRID_FRAG_SRC = R"glsl(
+#version 330 core
+in vec2 out_grid_pos;
+
+out vec4 FragColor;
+
+layout(std140) uniform GridGlyphs {
+    vec4 region[MAX_GLYPHS];
+    vec4 placement[MAX_GLYPHS];
+};
+
+uniform sampler2D cells;
+uniform sampler2D atlas0;
+uniform sampler2D atlas1;
+uniform sampler2D atlas2;
+uniform sampler2D atlas3;
+uniform ivec2 cell_size;
+uniform int scale;
+
+float coverage(int page, ivec2 p) {
+    if (page == 0)
+        return texelFetch(atlas0, p, 0).a;
+    if (page == 1)
+        return texelFetch(atlas1, p, 0).a;
+    if (page == 2)
+        return texelFetch(atlas2, p, 0).a;
+    return texelFetch(atlas3, p, 0).a;
+}
+
+void main() {
+    ivec2 px = ivec2(floor(out_grid_pos)) / scale;
+    ivec2 cell = px / cell_size;
+    ivec2 in_cell = px - cell * cell_size;
+
+    vec4 glyph = texelFetch(cells, ivec2(cell.x * 3, cell.y), 0);
+    vec4 fg = texelFetch(cells, ivec2(cell.x * 3 + 1, cell.y), 0);
+    vec4 bg = texelFetch(cells, ivec2(cell.x * 3 + 2, cell.y), 0);
+
+    int idx = int(glyph.r * 255.0 + 0.5) | (int(glyph.g * 255.0 + 0.5) << 8);
+    float a = 0.0;
+    if (idx != 0) {
+        vec4 r = region[idx];
+        vec4 p = placement[idx];
+        ivec2 g = in_cell - ivec2(p.xy);
+        if (all(greaterThanEqual(g, ivec2(0))) && all(lessThan(g, ivec2(r.zw))))
+            a = coverage(int(p.z), ivec2(r.xy) + g);
+    }
+
+    // Straight alpha fg over bg
+    float fa = fg.a * a;
+    float out_a = fa + bg.a * (1.0 - fa);
+    vec3 rgb = out_a > 0.0 ? (fg.rgb * fa + bg.rgb * bg.a * (1.0 - fa)) / out_a : vec3(0.0);
+    FragColor = vec4(rgb, out_a);
+}
+)glsl";
+
+namespace mizu {
+static_assert(ATLAS_MAX_PAGES == 4, "the grid shader has a sampler per atlas page");
+
+constexpr int CELL_TEXELS = 3;
+constexpr std::size_t CELL_BYTES = CELL_TEXELS * 4;
+
+static bool same_color(const Rgba &a, const Rgba &b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+TextGrid::TextGrid(gloo::Context &gl, Font &font, glm::ivec2 dims, int px_size, int scale)
+    : gl_(gl),
+      font_(font),
+      dims_(glm::max(dims, glm::ivec2(1))),
+      px_size_(px_size),
+      scale_(std::max(scale, 1)),
+      glyphs_(std::make_unique<GlyphUniforms>()),
+      glyph_ubo_(gl_),
+      shaders_(gl_) {
+    const auto count = static_cast<std::size_t>(dims_.x) * dims_.y;
+    cells_.resize(count);
+    cell_bytes_.resize(count * CELL_BYTES);
+    for (std::size_t i = 0; i < count; ++i)
+        write_cell_(i, 0);
+
+    if (font_.sdf()) {
+        MIZU_LOG_ERROR("TextGrid needs a bitmap font, SDF glyphs can't be fetched per texel");
+        return;
+    }
+
+    // Monospace, so any glyph's advance is the cell width
+    cell_px_ = glm::max(
+            glm::ivec2(
+                    static_cast<int>(std::round(font_.calc_size("M", px_size_).x)),
+                    static_cast<int>(std::round(font_.line_height(px_size_)))),
+            glm::ivec2(1));
+
+    cell_tex_ = std::make_unique<Texture>(
+            gl_,
+            glm::ivec2(dims_.x * CELL_TEXELS, dims_.y),
+            gloo::TextureDesc{.min_filter = gloo::MinFilter::Nearest, .mag_filter = gloo::MagFilter::Nearest});
+    mark_rows_(0, dims_.y);
+
+    shaders_.stage_src(gloo::ShaderType::Vertex, GRID_VERT_SRC).stage_src(gloo::ShaderType::Fragment, GRID_FRAG_SRC);
+    const gloo::ShaderDefines defines{{"MAX_GLYPHS", std::to_string(TEXT_GRID_MAX_GLYPHS)}};
+    shaders_.prewarm(std::span(&defines, 1));
+
+    shader_ = shaders_.get(defines);
+    if (!shader_) {
+        MIZU_LOG_ERROR("Text grid shader failed to link");
+        return;
+    }
+    shader_->uniform_block_binding("Frame", FRAME_UNIFORMS_BINDING);
+    shader_->uniform_block_binding("GridGlyphs", TEXT_GRID_GLYPHS_BINDING);
+    shader_->uniform_handle<int>("cells").set(0);
+    for (std::size_t page = 0; page < ATLAS_MAX_PAGES; ++page)
+        shader_->uniform_handle<int>("atlas" + std::to_string(page)).set(static_cast<int>(page + 1));
+
+    z_uniform_ = shader_->uniform_handle<float>("z");
+    origin_uniform_ = shader_->uniform_handle<glm::vec2>("origin");
+    size_uniform_ = shader_->uniform_handle<glm::vec2>("size");
+    cell_size_uniform_ = shader_->uniform_handle<glm::ivec2>("cell_size");
+    scale_uniform_ = shader_->uniform_handle<int>("scale");
+
+    vao_ = gloo::VertexArrayBuilder(gl_).with(shader_).build();
+}
+
+TextGrid::~TextGrid() = default;
+
+glm::ivec2 TextGrid::dims() const {
+    return dims_;
+}
+
+glm::vec2 TextGrid::cell_size() const {
+    return glm::vec2(cell_px_ * scale_);
+}
+
+glm::vec2 TextGrid::size() const {
+    return glm::vec2(dims_) * cell_size();
+}
+
+const TextGridCell &TextGrid::cell(glm::ivec2 pos) const {
+    static const TextGridCell blank{};
+    if (pos.x < 0 || pos.y < 0 || pos.x >= dims_.x || pos.y >= dims_.y)
+        return blank;
+    return cells_[static_cast<std::size_t>(pos.y) * dims_.x + pos.x];
+}
+
+void TextGrid::set(glm::ivec2 pos, const TextGridCell &cell) {
+    if (pos.x < 0 || pos.y < 0 || pos.x >= dims_.x || pos.y >= dims_.y)
+        return;
+
+    const auto i = static_cast<std::size_t>(pos.y) * dims_.x + pos.x;
+    auto &c = cells_[i];
+    // Redrawing the same text every frame leaves the row clean
+    if (c.cp == cell.cp && same_color(c.fg, cell.fg) && same_color(c.bg, cell.bg))
+        return;
+
+    c = cell;
+    write_cell_(i, glyph_index_(cell.cp));
+    mark_rows_(pos.y, pos.y + 1);
+}
+
+glm::ivec2 TextGrid::print(glm::ivec2 pos, std::string_view text, const Rgba &fg, const Rgba &bg) {
+    auto cursor = pos;
+    for (const auto cp: Utf8View(text)) {
+        if (cp == '\r')
+            continue;
+
+        if (cp == '\n') {
+            cursor = {pos.x, cursor.y + 1};
+            continue;
+        }
+
+        set(cursor, {cp, fg, bg});
+        cursor.x++;
+    }
+    return cursor;
+}
+
+void TextGrid::fill(const TextGridCell &cell) {
+    std::ranges::fill(cells_, cell);
+    const auto glyph = glyph_index_(cell.cp);
+    for (std::size_t i = 0; i < cells_.size(); ++i)
+        write_cell_(i, glyph);
+    mark_rows_(0, dims_.y);
+}
+
+void TextGrid::scroll(int rows, const TextGridCell &blank) {
+    if (rows <= 0)
+        return;
+
+    rows = std::min(rows, dims_.y);
+    const auto shifted = static_cast<std::size_t>(rows) * dims_.x;
+    std::shift_left(cells_.begin(), cells_.end(), static_cast<std::ptrdiff_t>(shifted));
+    std::shift_left(cell_bytes_.begin(), cell_bytes_.end(), static_cast<std::ptrdiff_t>(shifted * CELL_BYTES));
+
+    const auto glyph = glyph_index_(blank.cp);
+    for (auto i = cells_.size() - shifted; i < cells_.size(); ++i) {
+        cells_[i] = blank;
+        write_cell_(i, glyph);
+    }
+    mark_rows_(0, dims_.y);
+}
+
+void TextGrid::prepare() {
+    if (!shader_)
+        return;
+
+    if (palette_dirty_ || palette_generation_ != font_.atlas_generation())
+        resolve_palette_();
+
+    for (std::uint32_t page = 0; page < ATLAS_MAX_PAGES; ++page)
+        if (pages_used_ & (1u << page))
+            font_.mark_page_used(page);
+}
+
+void TextGrid::draw(glm::vec2 pos, float z) {
+    if (!shader_)
+        return;
+
+    if (dirty_rows_.y > dirty_rows_.x) {
+        const auto row_bytes = static_cast<std::size_t>(dims_.x) * CELL_BYTES;
+        cell_tex_->write_subimage(
+                {0, dirty_rows_.x},
+                {dims_.x * CELL_TEXELS, dirty_rows_.y - dirty_rows_.x},
+                cell_bytes_.data() + dirty_rows_.x * row_bytes);
+        dirty_rows_ = glm::ivec2(0);
+    }
+
+    if (glyphs_changed_) {
+        glyph_ubo_.update(*glyphs_);
+        glyphs_changed_ = false;
+    }
+    glyph_ubo_.bind_base(TEXT_GRID_GLYPHS_BINDING);
+
+    gl_.bind_texture(0, cell_tex_->id());
+    for (std::uint32_t page = 0; page < ATLAS_MAX_PAGES; ++page)
+        if (const auto *t = font_.atlas_page(page))
+            gl_.bind_texture(page + 1, t->id());
+
+    z_uniform_.set(z);
+    origin_uniform_.set(pos);
+    size_uniform_.set(size());
+    cell_size_uniform_.set(cell_px_);
+    scale_uniform_.set(scale_);
+
+    shader_->use();
+    vao_->draw_arrays(gloo::DrawMode::Triangles, 0, 6);
+}
+
+std::uint16_t TextGrid::glyph_index_(char32_t cp) {
+    if (cp == ' ' || cp == 0)
+        return 0;
+
+    if (const auto it = palette_.find(cp); it != palette_.end())
+        return it->second;
+
+    // Glyphs no cell shows anymore are only dropped once the palette fills up
+    if (palette_cps_.size() == TEXT_GRID_MAX_GLYPHS) {
+        compact_palette_();
+        if (const auto it = palette_.find(cp); it != palette_.end())
+            return it->second;
+    }
+
+    if (palette_cps_.size() == TEXT_GRID_MAX_GLYPHS) {
+        if (!palette_full_warned_)
+            MIZU_LOG_WARN("Text grid shows more than {} distinct glyphs, the rest are blank", TEXT_GRID_MAX_GLYPHS - 1);
+        palette_full_warned_ = true;
+        return 0;
+    }
+
+    const auto idx = static_cast<std::uint16_t>(palette_cps_.size());
+    palette_cps_.push_back(cp);
+    palette_.emplace(cp, idx);
+    palette_dirty_ = true;
+    return idx;
+}
+
+void TextGrid::compact_palette_() {
+    palette_.clear();
+    palette_cps_.resize(1);
+
+    for (std::size_t i = 0; i < cells_.size(); ++i) {
+        const auto cp = cells_[i].cp;
+        std::uint16_t glyph = 0;
+        if (cp != ' ' && cp != 0) {
+            if (const auto it = palette_.find(cp); it != palette_.end())
+                glyph = it->second;
+            else if (palette_cps_.size() < TEXT_GRID_MAX_GLYPHS) {
+                glyph = static_cast<std::uint16_t>(palette_cps_.size());
+                palette_cps_.push_back(cp);
+                palette_.emplace(cp, glyph);
+            }
+        }
+        write_cell_(i, glyph);
+    }
+
+    mark_rows_(0, dims_.y);
+    palette_dirty_ = true;
+}
+
+void TextGrid::resolve_palette_() {
+    // Packing new glyphs can grow or evict pages, which moves glyphs resolved earlier in the pass
+    do {
+        palette_generation_ = font_.atlas_generation();
+        pages_used_ = 0;
+        for (std::size_t i = 1; i < palette_cps_.size(); ++i) {
+            const auto quad = font_.glyph_quad(palette_cps_[i], px_size_);
+            if (!quad) {
+                glyphs_->region[i] = glm::vec4(0.0f);
+                continue;
+            }
+            glyphs_->region[i] = quad->region;
+            glyphs_->placement[i] = glm::vec4(glm::round(quad->pos), static_cast<float>(quad->page), 0.0f);
+            pages_used_ |= 1u << quad->page;
+        }
+    } while (palette_generation_ != font_.atlas_generation());
+
+    palette_dirty_ = false;
+    glyphs_changed_ = true;
+}
+
+void TextGrid::write_cell_(std::size_t i, std::uint16_t glyph) {
+    const auto &c = cells_[i];
+    auto *b = cell_bytes_.data() + i * CELL_BYTES;
+    b[0] = static_cast<unsigned char>(glyph & 0xff);
+    b[1] = static_cast<unsigned char>(glyph >> 8);
+    b[2] = 0;
+    b[3] = 0xff;
+    b[4] = c.fg.r, b[5] = c.fg.g, b[6] = c.fg.b, b[7] = c.fg.a;
+    b[8] = c.bg.r, b[9] = c.bg.g, b[10] = c.bg.b, b[11] = c.bg.a;
+}
+
+void TextGrid::mark_rows_(int first, int last) {
+    if (dirty_rows_.y <= dirty_rows_.x)
+        dirty_rows_ = {first, last};
+    else
+        dirty_rows_ = {std::min(dirty_rows_.x, first), std::max(dirty_rows_.y, last)};
+}
+} // namespace mizu
@@ -1,24 +1,24 @@
 #include "mizu/core/texture.hpp"
 
 namespace mizu {
-Texture::Texture(
-        gloo::Context &gl, const std::filesystem::path &path, gloo::MinFilter min_filter, gloo::MagFilter mag_filter)
+Texture::Texture(gloo::Context &gl, const std::filesystem::path &path, const gloo::TextureDesc &desc)
     : gl_(gl),
-      data_(read_image_data(path).value_or(PngData(0, 0, 0, 0))),
-      px_x_(1.0f / static_cast<float>(data_.width)),
-      px_y_(1.0f / static_cast<float>(data_.height)),
-      handle_(gl_.ctx, data_, min_filter, mag_filter) {}
+      handle_(gl_, read_image_data(path).value_or(PngData(0, 0, 0, 0)), desc) {
+    size_ = handle_.size();
+    px_x_ = 1.0f / static_cast<float>(size_.x);
+    px_y_ = 1.0f / static_cast<float>(size_.y);
+}
 
-Texture::Texture(gloo::Context &gl, glm::ivec2 size, gloo::MinFilter min_filter, gloo::MagFilter mag_filter)
+Texture::Texture(gloo::Context &gl, glm::ivec2 size, const gloo::TextureDesc &desc)
     : gl_(gl),
-      data_(PngData(size.x, size.y, 4, size.x * 4)),
-      px_x_(1.0f / static_cast<float>(data_.width)),
-      px_y_(1.0f / static_cast<float>(data_.height)),
-      handle_(gl_.ctx, size, min_filter, mag_filter) {}
+      size_(size),
+      px_x_(1.0f / static_cast<float>(size_.x)),
+      px_y_(1.0f / static_cast<float>(size_.y)),
+      handle_(gl_, size, desc) {}
 
 MOVE_CONSTRUCTOR_IMPL(Texture)
     : gl_(other.gl_),
-      data_(std::move(other.data_)),
+      size_(other.size_),
       px_x_(other.px_x_),
       px_y_(other.px_y_),
       handle_(std::move(other.handle_)) {}
@@ -27,7 +27,8 @@ MOVE_ASSIGN_OP_IMPL(Texture) {
     if (this != &other) {
         gl_ = other.gl_;
 
-        data_ = std::move(other.data_);
+        size_ = other.size_;
+        other.size_ = {0, 0};
 
         px_x_ = other.px_x_;
         other.px_x_ = 0;
@@ -44,12 +45,16 @@ GLuint Texture::id() const {
     return handle_.id;
 }
 
+gloo::InternalFormat Texture::format() const {
+    return handle_.format();
+}
+
 float Texture::width() const {
-    return static_cast<float>(data_.width);
+    return static_cast<float>(size_.x);
 }
 
 float Texture::height() const {
-    return static_cast<float>(data_.height);
+    return static_cast<float>(size_.y);
 }
 
 float Texture::s(float x) const {
@@ -60,8 +65,11 @@ float Texture::t(float y) const {
     return y * px_y_;
 }
 
-void Texture::write_subimage(glm::ivec2 pos, glm::ivec2 size, const unsigned char *bytes) {
-    // TODO: Make data_ reflect the change
-    handle_.write_subimage(pos, size, bytes);
+void Texture::write_subimage(glm::ivec2 pos, glm::ivec2 size, const unsigned char *bytes, GLint row_length) {
+    handle_.write_subimage(pos, size, bytes, row_length);
+}
+
+void Texture::copy_subimage_from(const Texture &src, glm::ivec2 src_pos, glm::ivec2 dst_pos, glm::ivec2 size) {
+    handle_.copy_subimage_from(src.handle_, src_pos, dst_pos, size);
 }
 } // namespace mizu
@@ -127,16 +127,9 @@ void Window::set_icon_dir(const std::filesystem::path &path) {
         set_icon(icon);
 }
 
-Window::Window(SDL_Window *sdl_window, CallbackMgr &callbacks)
-    : callbacks_(callbacks), sdl_window_(sdl_window) {
+Window::Window(SDL_Window *sdl_window, SDL_GLContext gl_context, CallbackMgr &callbacks)
+    : callbacks_(callbacks), sdl_window_(sdl_window), gl_context_(gl_context) {
     register_callbacks_();
-
-    gl_context_ = SDL_GL_CreateContext(sdl_window);
-    if (!gl_context_) {
-        MIZU_LOG_ERROR("Failed to create GL context: {}", SDL_GetError());
-        std::exit(EXIT_FAILURE);
-    }
-    MIZU_LOG_DEBUG("Created GL context");
 }
 
 void Window::register_callbacks_() {
@@ -309,7 +302,16 @@ std::expected<Window, std::string> WindowBuilder::build(CallbackMgr &callbacks)
     }
     MIZU_LOG_DEBUG("Created SDL window");
 
-    return Window(sdl_window, callbacks);
+    auto gl_context = SDL_GL_CreateContext(sdl_window);
+    if (!gl_context) {
+        MIZU_LOG_ERROR("Failed to create GL context: {}", SDL_GetError());
+        auto err = std::string(SDL_GetError());
+        SDL_DestroyWindow(sdl_window);
+        return std::unexpected(err);
+    }
+    MIZU_LOG_DEBUG("Created GL context");
+
+    return Window(sdl_window, gl_context, callbacks);
 }
 
 std::expected<SDL_DisplayID, std::string> WindowBuilder::get_display_id() {
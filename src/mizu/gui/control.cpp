@@ -9,10 +9,11 @@ Button::Button(const ButtonParams &params)
       bg_color(params.bg_color),
       fg_color(params.fg_color),
       border(params.border),
-      onclick(params.onclick) {}
+      onclick(params.onclick),
+      label_(*font, text) {}
 
 void Button::resize(const glm::vec2 &max_size_hint) {
-    const auto text_size = font->calc_size(text);
+    const auto text_size = label_synced_().size();
 
     switch (grow) {
     case Grow::Hori: {
@@ -88,11 +89,11 @@ void Button::draw(G2d &g2d) const {
         }
     }
 
-    const auto text_size = font->calc_size(text);
-    font->draw(
-            text,
-            {std::round(bbox.x + (size.x - text_size.x) / 2),
-             std::round(bbox.y + (size.y - text_size.y) / 2) + font->pen_offset()},
+    auto &label = label_synced_();
+    const auto text_size = label.size();
+    label.draw(
+            g2d,
+            {std::round(bbox.x + (size.x - text_size.x) / 2), std::round(bbox.y + (size.y - text_size.y) / 2)},
             fg_color);
 }
 
@@ -104,4 +105,10 @@ float Button::border_size_() const {
     }
     return 0.0f;
 }
+
+Text &Button::label_synced_() const {
+    label_.set_font(*font);
+    label_.set_str(text);
+    return label_;
+}
 } // namespace mizu::gui
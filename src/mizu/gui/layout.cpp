@@ -1,8 +1,24 @@
 #include "mizu/gui/layout.hpp"
 
 namespace mizu::gui {
+static bool bbox_intersects(const glm::vec4 &a, const glm::vec4 &b) {
+    return a.x < b.z && b.x < a.z && a.y < b.w && b.y < a.w;
+}
+
+static void draw_clipped(G2d &g2d, const glm::vec4 &clip_bbox, const std::vector<std::unique_ptr<NodeI>> &children) {
+    g2d.push_clip({clip_bbox.x, clip_bbox.y}, {clip_bbox.z - clip_bbox.x, clip_bbox.w - clip_bbox.y});
+    for (const auto &child: children)
+        if (bbox_intersects(child->bbox, clip_bbox))
+            child->draw(g2d);
+    g2d.pop_clip();
+}
+
 VStack::VStack(const VStackParams &params)
-    : Node(params.grow), border(params.border), outer_pad(params.outer_pad), inner_pad(params.inner_pad) {}
+    : Node(params.grow),
+      border(params.border),
+      outer_pad(params.outer_pad),
+      inner_pad(params.inner_pad),
+      clip(params.clip) {}
 
 void VStack::resize(const glm::vec2 &max_size_hint) {
     switch (grow) {
@@ -115,8 +131,19 @@ void VStack::draw(G2d &g2d) const {
         }
     }
 
-    for (const auto &child: children)
-        child->draw(g2d);
+    draw_children_(g2d);
+}
+
+void VStack::draw_children_(G2d &g2d) const {
+    if (!clip) {
+        for (const auto &child: children)
+            child->draw(g2d);
+        return;
+    }
+
+    // Children entirely outside the clip are skipped rather than culled one draw at a time
+    const auto bs = border_size_();
+    draw_clipped(g2d, {bbox.x + bs, bbox.y + bs, bbox.z - bs, bbox.w - bs}, children);
 }
 
 float VStack::border_size_() const {
@@ -129,7 +156,11 @@ float VStack::border_size_() const {
 }
 
 HStack::HStack(const HStackParams &params)
-    : Node(params.grow), border(params.border), outer_pad(params.outer_pad), inner_pad(params.inner_pad) {}
+    : Node(params.grow),
+      border(params.border),
+      outer_pad(params.outer_pad),
+      inner_pad(params.inner_pad),
+      clip(params.clip) {}
 
 void HStack::resize(const glm::vec2 &max_size_hint) {
     switch (grow) {
@@ -242,8 +273,19 @@ void HStack::draw(G2d &g2d) const {
         }
     }
 
-    for (const auto &child: children)
-        child->draw(g2d);
+    draw_children_(g2d);
+}
+
+void HStack::draw_children_(G2d &g2d) const {
+    if (!clip) {
+        for (const auto &child: children)
+            child->draw(g2d);
+        return;
+    }
+
+    // Children entirely outside the clip are skipped rather than culled one draw at a time
+    const auto bs = border_size_();
+    draw_clipped(g2d, {bbox.x + bs, bbox.y + bs, bbox.z - bs, bbox.w - bs}, children);
 }
 
 float HStack::border_size_() const {
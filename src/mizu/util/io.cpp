@@ -208,4 +208,144 @@ std::optional<std::string> read_file(const std::filesystem::path &path) {
 
     return content;
 }
+
+bool write_png(
+        const std::filesystem::path &path, const unsigned char *bytes, png_uint_32 width, png_uint_32 height, bool flip_y) {
+    FILE *fp = nullptr;
+#if defined(MIZU_PLATFORM_WINDOWS)
+    if (fopen_s(&fp, path.string().c_str(), "wb") != 0) {
+#else
+    fp = fopen(path.string().c_str(), "wb");
+    if (!fp) {
+#endif
+        MIZU_LOG_ERROR("Failed to open file for writing: '{}'", path);
+        return false;
+    }
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (!png) {
+        MIZU_LOG_ERROR("Failed to create png write struct");
+        fclose(fp);
+        return false;
+    }
+
+    png_infop info = png_create_info_struct(png);
+    if (!info) {
+        MIZU_LOG_ERROR("Failed to create png info struct");
+        png_destroy_write_struct(&png, nullptr);
+        fclose(fp);
+        return false;
+    }
+
+    if (setjmp(png_jmpbuf(png))) {
+        MIZU_LOG_ERROR("Failed to write png: '{}'", path);
+        png_destroy_write_struct(&png, &info);
+        fclose(fp);
+        return false;
+    }
+
+    png_init_io(png, fp);
+    png_set_IHDR(
+            png,
+            info,
+            width,
+            height,
+            8,
+            PNG_COLOR_TYPE_RGBA,
+            PNG_INTERLACE_NONE,
+            PNG_COMPRESSION_TYPE_DEFAULT,
+            PNG_FILTER_TYPE_DEFAULT);
+    // Captures are written far more often than they're read, favor speed over size
+    png_set_compression_level(png, 3);
+    png_write_info(png, info);
+
+    const std::size_t stride = static_cast<std::size_t>(width) * 4;
+    std::vector<png_bytep> row_pointers(height);
+    for (std::size_t y = 0; y < height; y++) {
+        const auto src_y = flip_y ? height - 1 - y : y;
+        row_pointers[y] = const_cast<png_bytep>(bytes + src_y * stride);
+    }
+    png_write_image(png, row_pointers.data());
+    png_write_end(png, nullptr);
+
+    png_destroy_write_struct(&png, &info);
+    fclose(fp);
+
+    return true;
+}
+
+Y4mWriter::~Y4mWriter() {
+    close();
+}
+
+bool Y4mWriter::open(const std::filesystem::path &path, png_uint_32 width, png_uint_32 height, int fps) {
+    close();
+
+#if defined(MIZU_PLATFORM_WINDOWS)
+    if (fopen_s(&fp_, path.string().c_str(), "wb") != 0) {
+#else
+    fp_ = fopen(path.string().c_str(), "wb");
+    if (!fp_) {
+#endif
+        MIZU_LOG_ERROR("Failed to open file for writing: '{}'", path);
+        fp_ = nullptr;
+        return false;
+    }
+
+    path_ = path;
+    width_ = width;
+    height_ = height;
+    planes_.resize(static_cast<std::size_t>(width) * height * 3);
+
+    const auto header = fmt::format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C444\n", width, height, fps);
+    fwrite(header.data(), 1, header.size(), fp_);
+
+    return true;
+}
+
+void Y4mWriter::close() {
+    if (fp_) {
+        fclose(fp_);
+        fp_ = nullptr;
+    }
+}
+
+bool Y4mWriter::is_open() const {
+    return fp_ != nullptr;
+}
+
+const std::filesystem::path &Y4mWriter::path() const {
+    return path_;
+}
+
+bool Y4mWriter::write_frame(const unsigned char *rgba, bool flip_y) {
+    if (!fp_)
+        return false;
+
+    // BT.601 limited range
+    const std::size_t plane_size = static_cast<std::size_t>(width_) * height_;
+    auto *y_plane = planes_.data();
+    auto *u_plane = y_plane + plane_size;
+    auto *v_plane = u_plane + plane_size;
+    for (std::size_t y = 0; y < height_; y++) {
+        const auto *row = rgba + (flip_y ? height_ - 1 - y : y) * width_ * 4;
+        for (std::size_t x = 0; x < width_; x++) {
+            const int r = row[x * 4 + 0];
+            const int g = row[x * 4 + 1];
+            const int b = row[x * 4 + 2];
+
+            const auto i = y * width_ + x;
+            y_plane[i] = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            u_plane[i] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v_plane[i] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+
+    fwrite("FRAME\n", 1, 6, fp_);
+    if (fwrite(planes_.data(), 1, planes_.size(), fp_) != planes_.size()) {
+        MIZU_LOG_ERROR("Failed to write frame to '{}'", path_);
+        return false;
+    }
+    return true;
+}
 } // namespace mizu